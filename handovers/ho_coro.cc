@@ -0,0 +1,199 @@
+//
+// MME handover benchmark: the txs of ho_trans.c as coroutines (see tx_shim_coro.h), which ho --in-flight N
+//  interleaves on the ctx of each worker
+//
+// e.g. g++ -std=c++20 -O3 -I. -c handovers/ho_coro.cc -o ho_coro.o
+//      gcc -O3 -pthread -DHO_CORO -I. handovers/ho_*.c tx_shim.c ... tx_trace.c ho_coro.o -lstdc++ -o ho
+//
+
+#include "../tx_shim_coro.h"
+#include "ho_schema.h"
+#include "ho_driver.h"
+
+using tx_coro::task;
+
+static inline auto ho_get_session(tx_trans_t* trans, ho_key_t* key, mme_session_t** s)
+{
+    return tx_coro::kv_get_range(trans, key->bytes, key->len, 0, HO_SESSION_FIELDS_LEN, (void**) s);
+}
+static inline auto ho_set_session(tx_trans_t* trans, ho_key_t* key, mme_session_t* s)
+{
+    return tx_coro::kv_update_range(trans, key->bytes, key->len, 0, s, HO_SESSION_FIELDS_LEN);
+}
+
+// (tasks, as the key and value must outlive the suspension of the access)
+static task<> ho_insert_ue_ctx(tx_trans_t* trans, uint32_t enb_id, uint32_t ue_id)
+{
+    mme_enodeb_ue_context_t ue_ctx = { .tx_mme_session = ue_id };
+    ho_key_t c_key;
+    ho_ue_ctx_key(&c_key, enb_id, ue_id);
+    co_await tx_coro::kv_set(trans, c_key.bytes, c_key.len, &ue_ctx, sizeof(ue_ctx));
+}
+
+static task<> ho_delete_ue_ctx(tx_trans_t* trans, mme_s1ap_context_t* s1ap)
+{
+    ho_key_t c_key;
+    ho_ue_ctx_key(&c_key, s1ap->sctp_idx, s1ap->enb.id);
+    co_await tx_coro::kv_del(trans, c_key.bytes, c_key.len);
+}
+
+//////////////////////////////
+/// Transactions (as mme_* of ho_trans.c)
+//////////////////////////////
+
+static task<int> ho_session_activate(tx_ctx_t* tx_ctx, uint32_t ue_id, uint32_t enb_id)
+{
+    tx_trans_t* trans = ho_trans_create(tx_ctx);
+    ho_key_t s_key;
+    ho_session_key(&s_key, ue_id);
+    mme_session_t* s;
+    int len = co_await ho_get_session(trans, &s_key, &s);
+    if (len < 0 || s->active != HO_UE_INACTIVE) co_return ho_reject(trans);
+
+    co_await ho_insert_ue_ctx(trans, enb_id, ue_id);
+    ho_s1ap_context(&s->s1ap.primary, enb_id, ue_id);
+    memset(&s->s1ap.secondary, 0, sizeof(s->s1ap.secondary));
+    s->active = HO_UE_ACTIVE;
+    co_await ho_set_session(trans, &s_key, s);
+    co_return tx_trans_commit(trans);
+}
+
+static task<int> ho_session_deactivate(tx_ctx_t* tx_ctx, uint32_t ue_id)
+{
+    tx_trans_t* trans = ho_trans_create(tx_ctx);
+    ho_key_t s_key;
+    ho_session_key(&s_key, ue_id);
+    mme_session_t* s;
+    int len = co_await ho_get_session(trans, &s_key, &s);
+    if (len < 0 || s->active == HO_UE_INACTIVE) co_return ho_reject(trans);
+
+    co_await ho_delete_ue_ctx(trans, &s->s1ap.primary);
+    if (s->active == HO_UE_HANDOVER) co_await ho_delete_ue_ctx(trans, &s->s1ap.secondary);
+    memset(&s->s1ap, 0, sizeof(s->s1ap));
+    s->active = HO_UE_INACTIVE;
+    co_await ho_set_session(trans, &s_key, s);
+    co_return tx_trans_commit(trans);
+}
+
+static task<int> ho_handover_start(tx_ctx_t* tx_ctx, uint32_t ue_id, uint32_t dst_enb_id)
+{
+    tx_trans_t* trans = ho_trans_create(tx_ctx);
+    ho_key_t s_key, enb_key;
+    ho_session_key(&s_key, ue_id);
+    mme_session_t* s;
+    int len = co_await ho_get_session(trans, &s_key, &s);
+    if (len < 0 || s->active != HO_UE_ACTIVE || s->s1ap.primary.sctp_idx == dst_enb_id) co_return ho_reject(trans);
+
+    mme_enodeb_t* dst_enb;
+    ho_enodeb_key(&enb_key, dst_enb_id);
+    len = co_await tx_coro::kv_get(trans, enb_key.bytes, enb_key.len, (void**) &dst_enb);
+    if (len < 0) co_return ho_reject(trans);
+
+    co_await ho_insert_ue_ctx(trans, dst_enb->sctp.sctp_idx, ue_id);
+    ho_s1ap_context(&s->s1ap.secondary, dst_enb->sctp.sctp_idx, ue_id);
+    s->active = HO_UE_HANDOVER;
+    co_await ho_set_session(trans, &s_key, s);
+    co_return tx_trans_commit(trans);
+}
+
+static task<int> ho_handover_finish(tx_ctx_t* tx_ctx, uint32_t sgw_ue_id)
+{
+    tx_trans_t* trans = ho_trans_create(tx_ctx);
+    ho_key_t s_key, sgw_key;
+    uint32_t* mme_index;
+    ho_sgw_key(&sgw_key, sgw_ue_id);
+    int len = co_await tx_coro::kv_get(trans, sgw_key.bytes, sgw_key.len, (void**) &mme_index);
+    if (len < 0) co_return ho_reject(trans);
+
+    ho_session_key(&s_key, *mme_index);
+    mme_session_t* s;
+    len = co_await ho_get_session(trans, &s_key, &s);
+    if (len < 0 || s->active != HO_UE_HANDOVER) co_return ho_reject(trans);
+
+    co_await ho_delete_ue_ctx(trans, &s->s1ap.primary);
+    s->s1ap.primary = s->s1ap.secondary;
+    memset(&s->s1ap.secondary, 0, sizeof(s->s1ap.secondary));
+    s->active = HO_UE_ACTIVE;
+    co_await ho_set_session(trans, &s_key, s);
+    co_return tx_trans_commit(trans);
+}
+
+//////////////////////////////
+/// Replay
+//////////////////////////////
+
+// the UEs w/ a tx in flight (+1: the UE of the next tx is marked before it waits for a slot)
+typedef struct
+{
+    uint32_t ue_ids[MAX_CONCUR_TX + 1];
+    uint32_t num;
+} ho_busy_ues_t;
+
+static int ho_ue_busy(const ho_busy_ues_t* busy, uint32_t ue_id)
+{
+    for (uint32_t i = 0; i < busy->num; i++)
+        if (busy->ue_ids[i] == ue_id) return 1;
+    return 0;
+}
+
+static void ho_ue_done(ho_busy_ues_t* busy, uint32_t ue_id)
+{
+    for (uint32_t i = 0; i < busy->num; i++)
+        if (busy->ue_ids[i] == ue_id)
+        {
+            busy->ue_ids[i] = busy->ue_ids[--busy->num];
+            return;
+        }
+    assert(0);
+}
+
+static task<int> ho_txn_exec(tx_ctx_t* ctx, ho_txn_type_t type, const ho_txn_t* txn)
+{
+    switch (type)
+    {
+        case HO_ACTIVATE:       return ho_session_activate(ctx, txn->ue_id, txn->enb_id);
+        case HO_DEACTIVATE:     return ho_session_deactivate(ctx, txn->ue_id);
+        case HO_HANDOVER_START: return ho_handover_start(ctx, txn->ue_id, txn->enb_id);
+        default: assert(type == HO_HANDOVER_FINISH); return ho_handover_finish(ctx, txn->ue_id);
+    }
+}
+
+// (as txn_run of ho_driver.c -- i.e., the latency includes the time the tx was suspended)
+static task<int> ho_txn_run(tx_ctx_t* ctx, ho_stats_t* stats, ho_txn_type_t type, const ho_txn_t* txn)
+{
+    uint64_t start = __tx_rdtsc();
+    int res;
+    for (;;)
+    {
+        res = co_await ho_txn_exec(ctx, type, txn);
+        if (res != failed) break;
+        stats->failed[type]++;
+    }
+    __tx_hist_record(&stats->latency[type], __tx_rdtsc() - start);
+    if (res == committed) stats->committed[type]++;
+    else stats->rejected[type]++;
+    co_return res;
+}
+
+// a tx of the trace (and the finish of a committed handover start)
+static task<> ho_trace_txn(tx_ctx_t* ctx, ho_stats_t* stats, const ho_txn_t* txn, ho_busy_ues_t* busy)
+{
+    ho_txn_type_t type = (ho_txn_type_t) txn->type;
+    int res = co_await ho_txn_run(ctx, stats, type, txn);
+    if (res == committed && type == HO_HANDOVER_START) co_await ho_txn_run(ctx, stats, HO_HANDOVER_FINISH, txn);
+    ho_ue_done(busy, txn->ue_id);
+}
+
+extern "C" void ho_coro_replay(tx_ctx_t* ctx, const ho_txn_t* txns, uint64_t n_txns, uint32_t in_flight,
+                               ho_stats_t* stats)
+{
+    tx_coro::executor ex(ctx, in_flight);
+    ho_busy_ues_t busy = { };
+    for (uint64_t i = 0; i < n_txns; i++)
+    {
+        while (ho_ue_busy(&busy, txns[i].ue_id)) ex.step();
+        busy.ue_ids[busy.num++] = txns[i].ue_id;
+        ex.spawn(ho_trace_txn(ctx, stats, &txns[i], &busy));
+    }
+    ex.drain();
+}
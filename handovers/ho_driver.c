@@ -0,0 +1,481 @@
+//
+// MME handover driver: replays the tx_threadNN.csv (or .bin) traces of ho_generator.py w/ one pinned worker thread
+//  per trace
+//
+// usage: ./ho [--backend ht] [--stats stats.json] [--in-flight 8 | --partitioned] tx_thread00.csv [tx_thread01.csv ...]
+//        ./ho --convert tx_thread00.csv [tx_thread01.csv ...]  (writes tx_thread00.bin ...)
+// e.g. gcc -O3 -pthread -I. handovers/ho_*.c tx_shim.c tx_shim_single.c tx_shim_trans.c tx_shim_slab.c tx_shim_kvs.c
+//          tx_shim_kvs_skiplist.c tx_shim_stats.c tx_shim_part.c tx_trace.c -o ho
+//  (add -DTX_STATS for --stats, which dumps the latency percentiles, abort causes and hot keys of the shim as JSON)
+//  (and -DHO_CORO w/ ho_coro.cc for --in-flight n, which interleaves up to n txs of a trace on its worker as
+//   coroutines -- see tx_shim_coro.h and ho_coro.cc)
+//
+// Binary traces (ho_generator.py --binary, or --convert; see tx_trace.h) are mmaped and their records replayed in
+// place, text traces are parsed before the run.
+//
+// All the UEs (inactive) and eNodeBs of the traces are populated before the traces are replayed. The generator emits
+// no handover finishes, so every (start) handover of a trace is replayed as a start followed by a finish.
+// Failed commits are retried and the latency of a tx is that of all its attempts.
+//
+// --partitioned: instead of OCC, worker i owns a partition -- the sessions (and sgw entries) of the UEs and the
+//  eNodeBs (and the UE contexts on them) of the ranges of trace i -- and the txs run deterministically (see
+//  tx_shim_part.h): those of its own partition serially and w/o locks or validation, the others (i.e., the remote
+//  handovers, p_remote of ho_generator.py) after the sequencer has ordered them. The eNodeBs of the UE contexts that
+//  deactivate / finish delete are those of the session, which is read before the tx is submitted and, if the tx is
+//  sequenced, checked once it runs (it is resubmitted if they moved in the meantime).
+//
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+#include "tx_shim.h"
+#include "tx_shim_slab.h"
+#include "tx_shim_stats.h"
+#include "tx_shim_part.h"
+#include "tx_trace.h"
+#include "ho_schema.h"
+#include "ho_driver.h"
+#define new(T) tx_slab_alloc(sizeof(T))
+
+static const char* ho_txn_names[HO_NUM_TXN_TYPES] = {
+    [HO_ACTIVATE]        = "activate",
+    [HO_DEACTIVATE]      = "deactivate",
+    [HO_HANDOVER_START]  = "handover-start",
+    [HO_HANDOVER_FINISH] = "handover-finish"
+};
+
+_Static_assert(sizeof(ho_txn_t) == TX_TRACE_REC_LEN(sizeof(ho_txn_t)), "ho_txn_t is not a trace record");
+
+#define HO_TRACE_WORKLOAD "ho"
+// header of a trace: "<ue_tot>, <enb_tot>, ..." and "<ue_min>, <ue_max>, <enb_min>, <enb_max>" (of the thread)
+typedef enum { HO_UE_TOT, HO_ENB_TOT, HO_UE_MIN, HO_UE_MAX, HO_ENB_MIN, HO_ENB_MAX, HO_TRACE_PARAMS } ho_trace_param_t;
+
+typedef struct
+{
+    int thread_id;
+    const ho_txn_t* txns;
+    uint64_t n_txns;
+    tx_trace_t trace;  // (hdr: NULL --> txns parsed from a text trace)
+    const tx_kvs_ops_t* kvs_ops;
+    void* kvs;
+    uint32_t in_flight;  // txs interleaved on the ctx (see ho_coro_replay)
+    tx_part_sched_t* sched;  // --partitioned (the partition of the worker is its thread_id)
+    pthread_barrier_t* start;
+    ho_stats_t stats;
+} ho_worker_t;
+
+#ifdef TX_STATS
+static tx_stats_t* run_stats;  // of all the ctxs of the run (merged before they are destroyed)
+static pthread_mutex_t run_stats_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void merge_ctx_stats(tx_ctx_t* ctx)
+{
+    pthread_mutex_lock(&run_stats_lock);
+    tx_stats_merge(run_stats, ctx->stats);
+    pthread_mutex_unlock(&run_stats_lock);
+}
+#endif
+
+static inline double elapsed_secs(struct timespec* start)
+{
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (end.tv_sec - start->tv_sec) + (end.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+// reads the header of a text trace and its txs
+static ho_txn_t* read_trace(const char* path, uint64_t* n_txns, uint32_t params[HO_TRACE_PARAMS])
+{
+    FILE* trace = fopen(path, "r");
+    if (trace == NULL) { perror(path); return NULL; }
+
+    char line[256], range_line[256];
+    if (fgets(line, sizeof(line), trace) == NULL || sscanf(line, "%u, %u", &params[HO_UE_TOT], &params[HO_ENB_TOT]) != 2 ||
+        fgets(range_line, sizeof(range_line), trace) == NULL ||
+        sscanf(range_line, "%u, %u, %u, %u", &params[HO_UE_MIN], &params[HO_UE_MAX], &params[HO_ENB_MIN],
+               &params[HO_ENB_MAX]) != 4)
+    {
+        printf("%s: no trace header!\n", path);
+        fclose(trace);
+        return NULL;
+    }
+
+    uint64_t max_txns = 1024;
+    ho_txn_t* txns = malloc(max_txns * sizeof(ho_txn_t));
+    *n_txns = 0;
+    while (fgets(line, sizeof(line), trace) != NULL)
+    {
+        int type;
+        uint32_t ue_id, enb_id = 0;
+        int n = sscanf(line, "%d, %u, %u", &type, &ue_id, &enb_id);
+        if (n < 2 || type < HO_ACTIVATE || type > HO_HANDOVER_START || (n < 3 && type != HO_DEACTIVATE))
+            continue;  // (blank lines)
+        if (*n_txns == max_txns) txns = realloc(txns, (max_txns *= 2) * sizeof(ho_txn_t));
+        txns[(*n_txns)++] = (ho_txn_t) { .type = (uint8_t) type, .ue_id = ue_id, .enb_id = enb_id };
+    }
+    fclose(trace);
+    return txns;
+}
+
+// the trace of a worker: mapped if binary, otherwise parsed
+static int load_trace(ho_worker_t* wk, const char* path, uint32_t params[HO_TRACE_PARAMS])
+{
+    if (tx_trace_open(&wk->trace, path, HO_TRACE_WORKLOAD) == 0)
+    {
+        wk->txns = (const ho_txn_t*) wk->trace.records;
+        wk->n_txns = wk->trace.hdr->n_records;
+        memcpy(params, wk->trace.hdr->params, HO_TRACE_PARAMS * sizeof(uint32_t));
+        return 0;
+    }
+    wk->txns = read_trace(path, &wk->n_txns, params);
+    return wk->txns == NULL ? -1 : 0;
+}
+
+// writes the binary trace of each text trace (tx_thread00.csv --> tx_thread00.bin)
+static int convert_traces(char* paths[], int n_paths)
+{
+    for (int i = 0; i < n_paths; i++)
+    {
+        uint32_t params[HO_TRACE_PARAMS];
+        uint64_t n_txns;
+        ho_txn_t* txns = read_trace(paths[i], &n_txns, params);
+        if (txns == NULL) return 1;
+
+        char out_path[strlen(paths[i]) + sizeof(".bin")];
+        strcpy(out_path, paths[i]);
+        char* ext = strrchr(out_path, '.');
+        strcpy(ext != NULL && strchr(ext, '/') == NULL ? ext : out_path + strlen(out_path), ".bin");
+
+        tx_trace_writer_t out;
+        if (tx_trace_writer_open(&out, out_path, HO_TRACE_WORKLOAD, params, HO_TRACE_PARAMS) < 0)
+            { perror(out_path); return 1; }
+        for (uint64_t t = 0; t < n_txns; t++) tx_trace_writer_append(&out, &txns[t], sizeof(ho_txn_t));
+        if (tx_trace_writer_close(&out) < 0) { perror(out_path); return 1; }
+        printf("Converted %lu txs to %s\n", n_txns, out_path);
+        free(txns);
+    }
+    return 0;
+}
+
+static int txn_exec(tx_ctx_t* ctx, ho_txn_type_t type, const ho_txn_t* txn)
+{
+    switch (type)
+    {
+        case HO_ACTIVATE:        return mme_session_activate(ctx, txn->ue_id, txn->enb_id);
+        case HO_DEACTIVATE:      return mme_session_deactivate(ctx, txn->ue_id);
+        case HO_HANDOVER_START:  return mme_handover_start(ctx, txn->ue_id, txn->enb_id);
+        case HO_HANDOVER_FINISH: return mme_handover_finish(ctx, txn->ue_id);  // (sgw ue id == ue id)
+        default: assert(0); return HO_REJECTED;
+    }
+}
+
+static int txn_run(tx_ctx_t* ctx, ho_stats_t* stats, ho_txn_type_t type, const ho_txn_t* txn)
+{
+    uint64_t start = __tx_rdtsc();
+    int res;
+    while ((res = txn_exec(ctx, type, txn)) == failed) stats->failed[type]++;
+    __tx_hist_record(&stats->latency[type], __tx_rdtsc() - start);
+    if (res == committed) stats->committed[type]++;
+    else stats->rejected[type]++;
+    return res;
+}
+
+//////////////////////////////
+/// --partitioned
+//////////////////////////////
+#define HO_PART_MOVED -2  // (the footprint of the tx changed before it ran)
+
+// partitions of ue_per_part UEs and enb_per_part eNodeBs (the ranges of the traces)
+static uint32_t n_parts, ue_per_part, enb_per_part;
+
+static inline uint32_t ue_part(uint32_t ue_id)
+{
+    uint32_t part = ue_id / ue_per_part;
+    return part < n_parts ? part : n_parts - 1;
+}
+
+static inline uint32_t enb_part(uint32_t enb_id)
+{
+    uint32_t part = enb_id / enb_per_part;
+    return part < n_parts ? part : n_parts - 1;
+}
+
+// the partitions of a tx: of its UE, of the eNodeB of its input or else of those in the session of the UE (a
+//  reconnaissance read, i.e., the session may change until the tx holds the partition of the UE)
+static void txn_parts(tx_ctx_t* ctx, ho_txn_type_t type, const ho_txn_t* txn, tx_part_set_t* parts)
+{
+    tx_part_set_clear(parts);
+    tx_part_set_add(parts, ue_part(txn->ue_id));
+    if (type == HO_ACTIVATE || type == HO_HANDOVER_START)
+    {
+        tx_part_set_add(parts, enb_part(txn->enb_id));
+        return;
+    }
+
+    mme_session_t s;
+    uint32_t len = sizeof(s);
+    ho_key_t s_key;
+    ho_session_key(&s_key, txn->ue_id);
+    if (tx_single_kv_get(ctx, s_key.bytes, s_key.len, &s, &len) != successful || s.active == HO_UE_INACTIVE) return;
+    tx_part_set_add(parts, enb_part(s.s1ap.primary.sctp_idx));
+    if (s.active == HO_UE_HANDOVER) tx_part_set_add(parts, enb_part(s.s1ap.secondary.sctp_idx));
+}
+
+typedef struct
+{
+    ho_stats_t* stats;  // (of the submitter)
+    ho_txn_type_t type;
+    const ho_txn_t* txn;
+    tx_part_set_t parts;
+    int sequenced;      // (a local tx runs right after its reconnaissance, i.e., its partitions are unchanged)
+} ho_part_txn_t;
+
+// (on the ctx of one of the partitions of the tx, w/ all of them held)
+static int part_txn_run(tx_ctx_t* ctx, void* arg)
+{
+    ho_part_txn_t* pt = (ho_part_txn_t *) arg;
+    if (pt->sequenced && (pt->type == HO_DEACTIVATE || pt->type == HO_HANDOVER_FINISH))
+    {
+        tx_part_set_t parts;
+        txn_parts(ctx, pt->type, pt->txn, &parts);
+        if (memcmp(&parts, &pt->parts, sizeof(parts)) != 0) return HO_PART_MOVED;
+    }
+    return txn_run(ctx, pt->stats, pt->type, pt->txn);
+}
+
+static int part_txn_exec(tx_ctx_t* ctx, ho_worker_t* wk, ho_txn_type_t type, const ho_txn_t* txn)
+{
+    ho_part_txn_t pt = { .stats = &wk->stats, .type = type, .txn = txn };
+    int res;
+    do
+    {
+        tx_part_poll(wk->sched, wk->thread_id);  // (the txs of others that wait for the partition go first)
+        txn_parts(ctx, type, txn, &pt.parts);
+        pt.sequenced = !tx_part_set_is_local(&pt.parts, wk->thread_id);
+        res = tx_part_exec(wk->sched, wk->thread_id, &pt.parts, part_txn_run, &pt);
+    } while (res == HO_PART_MOVED);
+    return res;
+}
+
+static void replay_partitioned(tx_ctx_t* ctx, ho_worker_t* wk)
+{
+    for (uint64_t i = 0; i < wk->n_txns; i++)
+    {
+        const ho_txn_t* txn = &wk->txns[i];
+        if (part_txn_exec(ctx, wk, txn->type, txn) == committed && txn->type == HO_HANDOVER_START)
+            part_txn_exec(ctx, wk, HO_HANDOVER_FINISH, txn);
+    }
+    tx_part_finish(wk->sched, wk->thread_id);
+}
+
+static void replay(tx_ctx_t* ctx, ho_worker_t* wk)
+{
+    if (wk->sched != NULL) { replay_partitioned(ctx, wk); return; }
+#ifdef HO_CORO
+    if (wk->in_flight > 1) { ho_coro_replay(ctx, wk->txns, wk->n_txns, wk->in_flight, &wk->stats); return; }
+#endif
+    for (uint64_t i = 0; i < wk->n_txns; i++)
+    {
+        const ho_txn_t* txn = &wk->txns[i];
+        if (txn_run(ctx, &wk->stats, txn->type, txn) == committed && txn->type == HO_HANDOVER_START)
+            txn_run(ctx, &wk->stats, HO_HANDOVER_FINISH, txn);
+    }
+}
+
+static void* ho_worker(void* arg)
+{
+    ho_worker_t* wk = (ho_worker_t *) arg;
+
+    cpu_set_t cpuset;
+    CPU_ZERO(&cpuset);
+    CPU_SET(wk->thread_id % sysconf(_SC_NPROCESSORS_ONLN), &cpuset);
+    pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset);
+
+    tx_ctx_t* ctx = new(tx_ctx_t);
+    tx_ctx_init(ctx, wk->kvs_ops, wk->kvs);
+    if (wk->sched != NULL) tx_part_attach(wk->sched, wk->thread_id, ctx);
+
+    pthread_barrier_wait(wk->start);
+    replay(ctx, wk);
+
+#ifdef TX_STATS
+    merge_ctx_stats(ctx);
+#endif
+    tx_ctx_destroy(ctx);
+    tx_slab_free(ctx);
+    return NULL;
+}
+
+static void report_row(const char* name, uint64_t c, uint64_t r, uint64_t f, const tx_hist_t* l, double elapsed)
+{
+    double cpu = tx_stats_cycles_per_ns() * 1e3;  // cycles per us
+    printf("%-16s %10lu %9lu %10.2f%% %12.1f %9.2f %9.2f %9.2f\n", name, c, r, 100.0 * f / (c + r + f + (c + r + f == 0)),
+           c / elapsed, tx_hist_percentile(l, 50) / cpu, tx_hist_percentile(l, 99) / cpu,
+           tx_hist_percentile(l, 99.9) / cpu);
+}
+
+static void report(const ho_stats_t* stats, double elapsed)
+{
+    uint64_t tot_committed = 0, tot_rejected = 0, tot_failed = 0;
+    tx_hist_t* tot_latency = calloc(1, sizeof(tx_hist_t));
+    printf("%-16s %10s %9s %11s %12s %9s %9s %9s\n", "tx", "committed", "rejected", "abort rate", "tx/s",
+           "p50 us", "p99 us", "p999 us");
+    for (int type = HO_ACTIVATE; type < HO_NUM_TXN_TYPES; type++)
+    {
+        report_row(ho_txn_names[type], stats->committed[type], stats->rejected[type], stats->failed[type],
+                   &stats->latency[type], elapsed);
+        tot_committed += stats->committed[type];
+        tot_rejected += stats->rejected[type];
+        tot_failed += stats->failed[type];
+        tx_hist_merge(tot_latency, &stats->latency[type]);
+    }
+    report_row("total", tot_committed, tot_rejected, tot_failed, tot_latency, elapsed);
+    free(tot_latency);
+}
+
+static void usage(const char* prog)
+{
+    printf("usage: %s [--backend name] [--stats file] [--in-flight n | --partitioned]"
+           " tx_thread00.csv|.bin [tx_thread01.csv|.bin ...]\n"
+           "       %s --convert tx_thread00.csv [tx_thread01.csv ...]\n", prog, prog);
+}
+
+int main(int argc, char* argv[])
+{
+    const char* backend = "ht";
+    const char* stats_file = NULL;
+    int convert = 0, partitioned = 0;
+    uint32_t in_flight = 1;
+
+    static const struct option opts[] = {
+        { "backend", required_argument, NULL, 'b' },
+        { "stats",   required_argument, NULL, 's' },
+        { "convert", no_argument,       NULL, 'c' },
+        { "in-flight", required_argument, NULL, 'i' },
+        { "partitioned", no_argument,     NULL, 'p' },
+        { NULL, 0, NULL, 0 }
+    };
+    int opt;
+    while ((opt = getopt_long(argc, argv, "b:s:ci:p", opts, NULL)) != -1)
+        switch (opt)
+        {
+            case 'b': backend = optarg; break;
+            case 's': stats_file = optarg; break;
+            case 'c': convert = 1; break;
+            case 'i': in_flight = atoi(optarg); break;
+            case 'p': partitioned = 1; break;
+            default: usage(argv[0]); return 1;
+        }
+    int n_threads = argc - optind;
+    if (n_threads < 1 || n_threads > TX_MAX_THREADS - 1) { usage(argv[0]); return 1; }
+    if (convert) return convert_traces(&argv[optind], n_threads);
+
+    const tx_kvs_ops_t* kvs_ops = tx_kvs_ops_by_name(backend);
+    if (kvs_ops == NULL) { puts("Unknown backend!"); return 1; }
+#ifdef TX_STATS
+    run_stats = tx_stats_create();
+#else
+    if (stats_file != NULL) { puts("--stats needs a build w/ -DTX_STATS!"); return 1; }
+#endif
+#ifndef HO_CORO
+    if (in_flight != 1) { puts("--in-flight needs a build w/ -DHO_CORO (and ho_coro.cc)!"); return 1; }
+#endif
+    if (in_flight < 1 || in_flight > MAX_CONCUR_TX) { printf("--in-flight must be in [1, %d]!\n", MAX_CONCUR_TX); return 1; }
+    if (partitioned && in_flight != 1) { puts("--partitioned runs one tx at a time per worker (no --in-flight)!"); return 1; }
+
+    ho_worker_t* workers = calloc(n_threads, sizeof(ho_worker_t));
+    uint32_t ue_tot = 0, enb_tot = 0;
+    uint64_t n_txns = 0;
+    for (int i = 0; i < n_threads; i++)
+    {
+        uint32_t params[HO_TRACE_PARAMS];
+        if (load_trace(&workers[i], argv[optind + i], params) < 0) return 1;
+        if (params[HO_UE_TOT] > ue_tot) ue_tot = params[HO_UE_TOT];
+        if (params[HO_ENB_TOT] > enb_tot) enb_tot = params[HO_ENB_TOT];
+        n_txns += workers[i].n_txns;
+    }
+
+    // sessions are in two tables and an active UE has up to two contexts on eNodeBs
+    void* kvs = kvs_ops->create(enb_tot + 4 * (uint64_t) ue_tot);
+    tx_ctx_t* ctx = new(tx_ctx_t);
+    tx_ctx_init(ctx, kvs_ops, kvs);
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (uint32_t enb_id = 0; enb_id < enb_tot; enb_id++) mme_create_enodeb(ctx, enb_id);
+    for (uint32_t ue_id = 0; ue_id < ue_tot; ue_id++) mme_create_session(ctx, ue_id);
+    printf("Populated %u UEs and %u eNodeBs in %.2f s (%s)\n", ue_tot, enb_tot, elapsed_secs(&start), kvs_ops->name);
+
+    tx_part_sched_t sched;
+    if (partitioned)
+    {
+        n_parts = n_threads;
+        ue_per_part = ue_tot / n_threads > 0 ? ue_tot / n_threads : 1;
+        enb_per_part = enb_tot / n_threads > 0 ? enb_tot / n_threads : 1;
+        tx_part_sched_init(&sched, n_parts);
+    }
+
+    pthread_barrier_t start_barrier;
+    pthread_barrier_init(&start_barrier, NULL, n_threads + 1);
+    pthread_t threads[n_threads];
+    for (int i = 0; i < n_threads; i++)
+    {
+        workers[i].thread_id = i;
+        workers[i].kvs_ops = kvs_ops;
+        workers[i].kvs = kvs;
+        workers[i].in_flight = in_flight;
+        workers[i].sched = partitioned ? &sched : NULL;
+        workers[i].start = &start_barrier;
+        pthread_create(&threads[i], NULL, ho_worker, &workers[i]);
+    }
+    pthread_barrier_wait(&start_barrier);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    ho_stats_t* stats = calloc(1, sizeof(ho_stats_t));
+    for (int i = 0; i < n_threads; i++)
+    {
+        pthread_join(threads[i], NULL);
+        for (int type = HO_ACTIVATE; type < HO_NUM_TXN_TYPES; type++)
+        {
+            stats->committed[type] += workers[i].stats.committed[type];
+            stats->rejected[type] += workers[i].stats.rejected[type];
+            stats->failed[type] += workers[i].stats.failed[type];
+            tx_hist_merge(&stats->latency[type], &workers[i].stats.latency[type]);
+        }
+        if (workers[i].trace.hdr != NULL) tx_trace_close(&workers[i].trace);
+        else free((void*) workers[i].txns);
+    }
+    double elapsed = elapsed_secs(&start);
+    if (partitioned)
+    {
+        printf("%d partition(s), %lu trace txs in %.2f s (%lu txs sequenced)\n", n_threads, n_txns, elapsed,
+               sched.num_sequenced);
+        tx_part_sched_destroy(&sched);
+    }
+    else printf("%d thread(s) x %u in-flight tx(s), %lu trace txs in %.2f s\n", n_threads, in_flight, n_txns, elapsed);
+    report(stats, elapsed);
+
+#ifdef TX_STATS
+    if (stats_file != NULL)
+    {
+        FILE* out = fopen(stats_file, "w");
+        if (out == NULL) { perror(stats_file); return 1; }
+        tx_stats_dump_json(out, run_stats, ho_key_str);
+        fclose(out);
+    }
+    tx_stats_free(run_stats);
+#endif
+    pthread_barrier_destroy(&start_barrier);
+    free(stats);
+    free(workers);
+    tx_ctx_destroy(ctx);
+    tx_slab_free(ctx);
+    kvs_ops->destroy(kvs);
+    return 0;
+}
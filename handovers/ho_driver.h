@@ -0,0 +1,45 @@
+//
+// MME handover driver: the txs of a trace and their stats (shared by ho_driver.c and the coroutine replay of ho_coro.cc)
+//
+
+#pragma once
+
+#include "../tx_shim_stats.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum
+{
+    HO_ACTIVATE,         // "0, <ue_id>, <enb_id>"
+    HO_DEACTIVATE,       // "1, <ue_id>"
+    HO_HANDOVER_START,   // "2, <ue_id>, <dst_enb_id>"
+    HO_HANDOVER_FINISH,  // (after each start)
+    HO_NUM_TXN_TYPES
+} ho_txn_type_t;
+
+// (also the record of a binary trace, i.e., of all its txs)
+typedef struct
+{
+    uint8_t  type;
+    uint32_t ue_id;
+    uint32_t enb_id;
+    uint32_t unused;
+} ho_txn_t;
+
+typedef struct
+{
+    uint64_t committed[HO_NUM_TXN_TYPES];
+    uint64_t rejected[HO_NUM_TXN_TYPES];
+    uint64_t failed[HO_NUM_TXN_TYPES];    // commits (retried)
+    tx_hist_t latency[HO_NUM_TXN_TYPES];  // cycles
+} ho_stats_t;
+
+// replays the txs w/ up to in_flight of them interleaved on the ctx (see tx_shim_coro.h) -- the txs of a UE are
+//  still run one after the other, in the order of the trace
+void ho_coro_replay(tx_ctx_t* ctx, const ho_txn_t* txns, uint64_t n_txns, uint32_t in_flight, ho_stats_t* stats);
+
+#ifdef __cplusplus
+}
+#endif
@@ -1,6 +1,7 @@
 import random
 import argparse
 import math
+import struct
 from queue import Queue as queue
 
 
@@ -25,9 +26,54 @@ def parse_args():  # node_tot, ue_tot, enb_tot, p_handovers, p_remote, p_ue_movi
         help='ratio of movable UEs in all UEs')  # movable UE: see below
     parser.add_argument('tx_tot', type=int,
         help='total number of transactions in generated trace')
+    parser.add_argument('--binary', action='store_true',
+        help='emit binary traces (tx_threadXX.bin, see tx_trace.h) that the driver mmaps instead of parsing')
     ARGS = parser.parse_args()
 
 
+class TextTrace:  # tx_threadXX.csv: "<tx type>, <ue_id>[, <enb_id>]" per tx
+    def __init__(self, thread_id, params, ranges):
+        self.fp = open("tx_thread%02d.csv" % thread_id, "w")
+        print(*params, sep=', ', file=self.fp)
+        print(*ranges, sep=', ', file=self.fp)
+        print(file=self.fp)
+        # a blank line between first 2 lines of parameters and following txs to ensure readability
+
+    def tx(self, tx_type, ue_id, enb_id=None):
+        if enb_id is None:
+            self.fp.write('%d, %d\n' % (tx_type, ue_id))
+        else:
+            self.fp.write('%d, %d, %d\n' % (tx_type, ue_id, enb_id))
+
+    def close(self):
+        self.fp.close()
+
+
+class BinaryTrace:  # tx_threadXX.bin: a tx_trace_hdr_t and a ho_txn_t (of ho_driver.c) per tx
+    HDR = struct.Struct('=IHH8sQQ8I')
+    TXN = struct.Struct('=B3xIII')
+    MAGIC, VERSION = 0x52545854, 1
+
+    def __init__(self, thread_id, params, ranges):
+        self.fp = open("tx_thread%02d.bin" % thread_id, "wb")
+        self.params = [params[0], params[1]] + list(ranges)  # (ue_tot, enb_tot, ue/enb min/max)
+        self.n_txs = 0
+        self.write_header()
+
+    def write_header(self):
+        self.fp.write(self.HDR.pack(self.MAGIC, self.VERSION, self.HDR.size, b'ho', self.n_txs,
+                                    self.n_txs * self.TXN.size, *(self.params + [0] * (8 - len(self.params)))))
+
+    def tx(self, tx_type, ue_id, enb_id=0):
+        self.fp.write(self.TXN.pack(tx_type, ue_id, enb_id, 0))
+        self.n_txs += 1
+
+    def close(self):  # (the header w/ the final counts)
+        self.fp.seek(0)
+        self.write_header()
+        self.fp.close()
+
+
 def main():
     ## read in user-specified arguments and calculate derived arguments
     parse_args()
@@ -112,7 +158,10 @@ def main():
     # 2 * thread_tot * ue_moving_per_thread: number of txs taken by activation and deactivation of moving UEs
 
     ## generate trace
-    fp = [open("tx_thread%02d.csv" % i, "w") for i in range(thread_tot)]
+    trace = BinaryTrace if ARGS.binary else TextTrace
+    fp = [trace(i, (ue_tot, enb_tot, p_handovers, p_remote, p_ue_moving),
+                (i * ue_per_thread, (i+1) * ue_per_thread - 1, i * enb_per_thread, (i+1) * enb_per_thread - 1))
+          for i in range(thread_tot)]
     fp_params = open("tx_params.csv", "w")  # file pointer that parameters print to
     remote_handovers_lim = math.floor(tx_tot * p_handovers * p_remote + 1e-6)
     # remaining number of remote handovers
@@ -120,14 +169,6 @@ def main():
 
     print(ue_tot, enb_tot, p_handovers, p_remote, p_ue_moving, tx_tot,
             sep=', ', file=fp_params)
-    for cur_thread in range(thread_tot):
-        print(ue_tot, enb_tot, p_handovers, p_remote, p_ue_moving,
-            sep=', ', file=fp[cur_thread])
-        print(cur_thread * ue_per_thread, (cur_thread+1) * ue_per_thread - 1,
-            cur_thread * enb_per_thread, (cur_thread+1) * enb_per_thread - 1,
-            sep=', ', file=fp[cur_thread])
-        print(file=fp[cur_thread])
-        # a blank line between first 2 lines of parameters and following txs to ensure readability
     # First 2 lines of each trace:
     # - <UEs-overall-total>, <ENodeB-overall-total> .. (+ every variable parameter)
     # - <UEs-min>, <UEs-max>, <ENodeB-min>, <ENodeB-max> (in current thread)
@@ -139,7 +180,7 @@ def main():
             enb_id = ue_home_enb_table[ue_id]
             # first time activating this UE: home_enb is preset
             # fp[thread_id].write('a, %d, %d\n' % (ue_id, enb_id))
-            fp[thread_id].write('0, %d, %d\n' % (ue_id, enb_id))
+            fp[thread_id].tx(0, ue_id, enb_id)
 
     # Phase 2: Normal generate
     for tx_no in range(thread_tot * ue_moving_per_thread, tx_tot):
@@ -176,7 +217,7 @@ def main():
             ue_home_enb_table[ue_id] = dst_enb_id
             ue_home_thread_table[ue_id] = thread_id
             # fp[thread_id].write('h, %d, %d\n' % (ue_id, dst_enb_id))
-            fp[thread_id].write('2, %d, %d\n' % (ue_id, dst_enb_id))
+            fp[thread_id].tx(2, ue_id, dst_enb_id)
             # h: (start-)handover
             # For now we don't consider finish handover
 
@@ -186,7 +227,7 @@ def main():
                         else 0
 
             if tx_type == 1: # local handover
-                ue_id = random.sample(ue_active_set, 1)[0]
+                ue_id = random.choice(tuple(ue_active_set))
                 ue_home_enb = ue_home_enb_table[ue_id]
                 ue_home_thread = ue_home_enb // enb_per_thread
 
@@ -197,7 +238,7 @@ def main():
 
                 ue_home_enb_table[ue_id] = dst_enb_id
                 # fp[ue_home_thread].write('h, %d, %d\n' % (ue_id, dst_enb_id))
-                fp[ue_home_thread].write('2, %d, %d\n' % (ue_id, dst_enb_id))
+                fp[ue_home_thread].tx(2, ue_id, dst_enb_id)
 
             else:  # activate/deactivate UE
                 act_type = 1 if bool(ue_inactive_set) == False \
@@ -207,7 +248,7 @@ def main():
                 #  and less in the end
 
                 if act_type == 1:  # deactivate UE
-                    ue_id = random.sample(ue_active_set, 1)[0]
+                    ue_id = random.choice(tuple(ue_active_set))
                     ue_active_set.remove(ue_id)
                     # ue_id = ue_active_set.pop() is much faster, but it pops elements
                     #  in numerical order on my computer which is absurd
@@ -219,10 +260,10 @@ def main():
 
                     ue_home_thread = ue_home_thread_table[ue_id]
                     # fp[ue_home_thread].write('d, %d\n' % ue_id)
-                    fp[ue_home_thread].write('1, %d\n' % ue_id)
+                    fp[ue_home_thread].tx(1, ue_id)
 
                 else:  # activate UE
-                    ue_id = random.sample(ue_inactive_set, 1)[0]  # ue_id = ue_inactive_set.pop()
+                    ue_id = random.choice(tuple(ue_inactive_set))  # ue_id = ue_inactive_set.pop()
                     ue_inactive_set.remove(ue_id)
                     ue_active_set.add(ue_id)
 
@@ -233,7 +274,7 @@ def main():
 
                     ue_home_enb_table[ue_id] = enb_id
                     # fp[ue_home_thread].write('a, %d, %d\n' % (ue_id, enb_id))
-                    fp[ue_home_thread].write('0, %d, %d\n' % (ue_id, enb_id))
+                    fp[ue_home_thread].tx(0, ue_id, enb_id)
 
     # Because in the last part (1~5%) of phase 2, all UEs tend to be deactivated,
     #  this part of the trace is composed of 'a; d; a; d', and local handovers
@@ -258,20 +299,20 @@ def main():
             ue_home_enb_table[ue_id] = dst_enb_id
             ue_home_thread_table[ue_id] = thread_id
             # fp[thread_id].write('h, %d, %d\n' % (ue_id, dst_enb_id))
-            fp[thread_id].write('2, %d, %d\n' % (ue_id, dst_enb_id))
+            fp[thread_id].tx(2, ue_id, dst_enb_id)
 
     for thread_id in range(0, thread_tot):
         for ue_id in range((thread_id+1) * ue_per_thread - ue_moving_per_thread, \
                             (thread_id+1) * ue_per_thread):
             # fp[thread_id].write('d, %d\n' % ue_id)
-            fp[thread_id].write('1, %d\n' % ue_id)
+            fp[thread_id].tx(1, ue_id)
 
     while bool(ue_active_set) == True:
-        ue_id = random.sample(ue_active_set, 1)[0]  # ue_id = ue_active_set.pop()
+        ue_id = random.choice(tuple(ue_active_set))  # ue_id = ue_active_set.pop()
         ue_active_set.remove(ue_id)
         ue_home_thread = ue_home_thread_table[ue_id]
         # fp[ue_home_thread].write('d, %d\n' % ue_id)
-        fp[ue_home_thread].write('1, %d\n' % ue_id)
+        fp[ue_home_thread].tx(1, ue_id)
 
     fp_params.close()
     for each_fp in fp:
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <stddef.h>
 #include "../tx_shim.h"
 
 // fields containing *data* in their name are essentially unused by the benchmark
@@ -94,6 +95,62 @@ typedef struct {
 
 
 
+// mme_session_t.active
+#define HO_UE_INACTIVE 0
+#define HO_UE_ACTIVE   1
+#define HO_UE_HANDOVER 2 // active w/ a started (but not finished) handover to the secondary eNodeB
+
+// Keys are the (NUL-terminated) name of the table followed by the bytes of the key of the table
+#define HO_KEY_MAX_LEN 32
+
+// writes the table and ids of a key, e.g., "mme_table_t(7)" (as snprintf -- a tx_stats_key_fmt)
+int ho_key_str(const uint8_t* key, uint32_t key_len, char* out, uint32_t out_len);
+
+typedef struct
+{
+    uint8_t len;
+    uint8_t bytes[HO_KEY_MAX_LEN];
+} ho_key_t;
+
+static inline void ho_key(ho_key_t* key, const char* table, const void* id, uint32_t id_len)
+{
+    uint32_t table_len = strlen(table) + 1;
+    assert(table_len + id_len <= HO_KEY_MAX_LEN);
+    memcpy(key->bytes, table, table_len);
+    memcpy(key->bytes + table_len, id, id_len);
+    key->len = (uint8_t) (table_len + id_len);
+}
+
+static inline void ho_enodeb_key(ho_key_t* key, uint32_t sctp_idx)
+{
+    ho_key(key, MME_ENB_MAP_SCTP_TABLE, &sctp_idx, sizeof(sctp_idx));
+}
+static inline void ho_ue_ctx_key(ho_key_t* key, uint32_t enodeb_idx, uint32_t enodeb_s1ap_id)
+{
+    mme_enodeb_ue_context_id_t id = { .enodeb_idx = enodeb_idx, .enodeb_s1ap_id = enodeb_s1ap_id };
+    ho_key(key, MME_ENB_UE_CONTEXT_TABLE, &id, sizeof(id));
+}
+static inline void ho_session_key(ho_key_t* key, uint32_t mme_index)
+{
+    ho_key(key, MME_SESSION_MAP_MS1APID_TABLE, &mme_index, sizeof(mme_index));
+}
+static inline void ho_sgw_key(ho_key_t* key, uint32_t mme_id)  // (value: the mme_index of the session)
+{
+    ho_key(key, MME_SESSION_TABLE, &mme_id, sizeof(mme_id));
+}
+
+// only the fields before the (unused) data of a session are read / written (see tx_trans_kv_get_range)
+#define HO_SESSION_FIELDS_LEN offsetof(mme_session_t, data1)
+
+// the eNodeB knows a UE by the MME s1ap id of the UE (i.e., its ue_id)
+static inline void ho_s1ap_context(mme_s1ap_context_t* s1ap, uint32_t enb_id, uint32_t ue_id)
+{
+    memset(s1ap, 0, sizeof(*s1ap));
+    s1ap->sctp_idx = enb_id;
+    s1ap->mme.id = ue_id;
+    s1ap->enb.id = ue_id;
+}
+
 /////////////////////////
 /// only for population/destruction
 //////////////////////////////
@@ -107,6 +164,24 @@ void mme_delete_session(tx_ctx_t *tx_ctx, uint32_t ue_idx);
 //////////////////////////////
 /// main txs of the benchmark
 //////////////////////////////
+// Each tx returns committed or failed (i.e., its commit failed and it may be retried) as tx_trans_result
+// or HO_REJECTED if (a consistent snapshot shows that) the UE / eNodeB is not in the state it expects
+// (e.g., the handover of an inactive UE -- which the traces of other threads may not have activated yet)
+#define HO_REJECTED -1
+
+// The UE / eNodeB is not in the expected state: rejected if that is what the db looks like (i.e., the tx, which
+//  has written nothing yet, commits), otherwise the tx read an inconsistent state and is to be retried
+static inline int ho_reject(tx_trans_t* trans)
+{
+    return tx_trans_commit(trans) == committed ? HO_REJECTED : failed;
+}
+
+static inline tx_trans_t* ho_trans_create(tx_ctx_t* tx_ctx)
+{
+    tx_trans_t* trans = tx_trans_create(tx_ctx);
+    assert(trans != NULL);
+    return trans;
+}
 
 
 //////////////////////////////
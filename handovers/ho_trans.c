@@ -0,0 +1,190 @@
+//
+// MME handover benchmark: population and transactions of ho_schema.h over the tx_trans_kv_* API
+//
+
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include "ho_schema.h"
+
+int ho_key_str(const uint8_t* key, uint32_t key_len, char* out, uint32_t out_len)
+{
+    const uint8_t* end = memchr(key, 0, key_len);
+    if (end == NULL) return snprintf(out, out_len, "?(%u bytes)", key_len);
+
+    int len = snprintf(out, out_len, "%s(", (const char*) key);
+    for (const uint8_t* p = end + 1; p + sizeof(uint32_t) <= key + key_len; p += sizeof(uint32_t))
+    {
+        uint32_t id;
+        memcpy(&id, p, sizeof(id));
+        int at = len < (int) out_len ? len : (int) out_len;  // (truncated)
+        len += snprintf(out + at, out_len - at, "%s%u", p > end + 1 ? "," : "", id);
+    }
+    int at = len < (int) out_len ? len : (int) out_len;
+    return len + snprintf(out + at, out_len - at, ")");
+}
+
+static inline mme_session_t* ho_get_session(tx_trans_t* trans, ho_key_t* key)
+{
+    mme_session_t* s;
+    if (tx_trans_kv_get_range(trans, key->bytes, key->len, 0, HO_SESSION_FIELDS_LEN, (void**) &s) < 0) return NULL;
+    return s;
+}
+static inline void ho_set_session(tx_trans_t* trans, ho_key_t* key, mme_session_t* s)
+{
+    tx_trans_kv_update_range(trans, key->bytes, key->len, 0, s, HO_SESSION_FIELDS_LEN);
+}
+
+//////////////////////////////
+/// Population / destruction (w/o concurrent txs)
+//////////////////////////////
+
+void mme_create_enodeb(tx_ctx_t* tx_ctx, uint32_t enb_id)
+{
+    mme_enodeb_t enb = { .sctp = { .sctp_idx = enb_id }, .enb_id = enb_id };
+    ho_key_t key;
+    ho_enodeb_key(&key, enb_id);
+
+    tx_trans_t* trans = ho_trans_create(tx_ctx);
+    tx_trans_kv_set(trans, key.bytes, key.len, &enb, sizeof(enb));
+    tx_trans_commit(trans);
+}
+
+void mme_delete_enodeb(tx_ctx_t* tx_ctx, uint32_t enb_id)
+{
+    ho_key_t key;
+    ho_enodeb_key(&key, enb_id);
+
+    tx_trans_t* trans = ho_trans_create(tx_ctx);
+    tx_trans_kv_del(trans, key.bytes, key.len);
+    tx_trans_commit(trans);
+}
+
+// an inactive UE w/ mme_index (and MME s1ap id) ue_idx
+void mme_create_session(tx_ctx_t* tx_ctx, uint32_t ue_idx)
+{
+    mme_session_t s = { .mme_index = ue_idx, .active = HO_UE_INACTIVE };
+    ho_key_t s_key, sgw_key;
+    ho_session_key(&s_key, ue_idx);
+    ho_sgw_key(&sgw_key, ue_idx);
+
+    tx_trans_t* trans = ho_trans_create(tx_ctx);
+    tx_trans_kv_set(trans, s_key.bytes, s_key.len, &s, sizeof(s));
+    tx_trans_kv_set(trans, sgw_key.bytes, sgw_key.len, &s.mme_index, sizeof(s.mme_index));
+    tx_trans_commit(trans);
+}
+
+void mme_delete_session(tx_ctx_t* tx_ctx, uint32_t ue_idx)
+{
+    ho_key_t s_key, sgw_key, c_key;
+    ho_session_key(&s_key, ue_idx);
+    ho_sgw_key(&sgw_key, ue_idx);
+
+    tx_trans_t* trans = ho_trans_create(tx_ctx);
+    mme_session_t* s = ho_get_session(trans, &s_key);
+    if (s != NULL && s->active != HO_UE_INACTIVE)  // (and its contexts on eNodeBs)
+    {
+        ho_ue_ctx_key(&c_key, s->s1ap.primary.sctp_idx, s->s1ap.primary.enb.id);
+        tx_trans_kv_del(trans, c_key.bytes, c_key.len);
+        if (s->active == HO_UE_HANDOVER)
+        {
+            ho_ue_ctx_key(&c_key, s->s1ap.secondary.sctp_idx, s->s1ap.secondary.enb.id);
+            tx_trans_kv_del(trans, c_key.bytes, c_key.len);
+        }
+    }
+    tx_trans_kv_del(trans, s_key.bytes, s_key.len);
+    tx_trans_kv_del(trans, sgw_key.bytes, sgw_key.len);
+    tx_trans_commit(trans);
+}
+
+//////////////////////////////
+/// Transactions
+//////////////////////////////
+
+static inline void ho_insert_ue_ctx(tx_trans_t* trans, uint32_t enb_id, uint32_t ue_id)
+{
+    mme_enodeb_ue_context_t ue_ctx = { .tx_mme_session = ue_id };
+    ho_key_t c_key;
+    ho_ue_ctx_key(&c_key, enb_id, ue_id);
+    tx_trans_kv_set(trans, c_key.bytes, c_key.len, &ue_ctx, sizeof(ue_ctx));
+}
+
+static inline void ho_delete_ue_ctx(tx_trans_t* trans, mme_s1ap_context_t* s1ap)
+{
+    ho_key_t c_key;
+    ho_ue_ctx_key(&c_key, s1ap->sctp_idx, s1ap->enb.id);
+    tx_trans_kv_del(trans, c_key.bytes, c_key.len);
+}
+
+int mme_session_activate(tx_ctx_t* tx_ctx, uint32_t ue_id, uint32_t enb_id)
+{
+    tx_trans_t* trans = ho_trans_create(tx_ctx);
+    ho_key_t s_key;
+    ho_session_key(&s_key, ue_id);
+    mme_session_t* s = ho_get_session(trans, &s_key);
+    if (s == NULL || s->active != HO_UE_INACTIVE) return ho_reject(trans);
+
+    ho_insert_ue_ctx(trans, enb_id, ue_id);
+    ho_s1ap_context(&s->s1ap.primary, enb_id, ue_id);
+    memset(&s->s1ap.secondary, 0, sizeof(s->s1ap.secondary));
+    s->active = HO_UE_ACTIVE;
+    ho_set_session(trans, &s_key, s);
+    return tx_trans_commit(trans);
+}
+
+int mme_session_deactivate(tx_ctx_t* tx_ctx, uint32_t ue_id)
+{
+    tx_trans_t* trans = ho_trans_create(tx_ctx);
+    ho_key_t s_key;
+    ho_session_key(&s_key, ue_id);
+    mme_session_t* s = ho_get_session(trans, &s_key);
+    if (s == NULL || s->active == HO_UE_INACTIVE) return ho_reject(trans);
+
+    ho_delete_ue_ctx(trans, &s->s1ap.primary);
+    if (s->active == HO_UE_HANDOVER) ho_delete_ue_ctx(trans, &s->s1ap.secondary);  // (the handover is abandoned)
+    memset(&s->s1ap, 0, sizeof(s->s1ap));
+    s->active = HO_UE_INACTIVE;
+    ho_set_session(trans, &s_key, s);
+    return tx_trans_commit(trans);
+}
+
+int mme_handover_start(tx_ctx_t* tx_ctx, uint32_t ue_id, uint32_t dst_enb_id)
+{
+    tx_trans_t* trans = ho_trans_create(tx_ctx);
+    ho_key_t s_key, enb_key;
+    ho_session_key(&s_key, ue_id);
+    mme_session_t* s = ho_get_session(trans, &s_key);
+    if (s == NULL || s->active != HO_UE_ACTIVE || s->s1ap.primary.sctp_idx == dst_enb_id) return ho_reject(trans);
+
+    mme_enodeb_t* dst_enb;
+    ho_enodeb_key(&enb_key, dst_enb_id);
+    if (tx_trans_kv_get(trans, enb_key.bytes, enb_key.len, (void**) &dst_enb) < 0) return ho_reject(trans);
+
+    ho_insert_ue_ctx(trans, dst_enb->sctp.sctp_idx, ue_id);
+    ho_s1ap_context(&s->s1ap.secondary, dst_enb->sctp.sctp_idx, ue_id);
+    s->active = HO_UE_HANDOVER;
+    ho_set_session(trans, &s_key, s);
+    return tx_trans_commit(trans);
+}
+
+int mme_handover_finish(tx_ctx_t* tx_ctx, uint32_t sgw_ue_id)
+{
+    tx_trans_t* trans = ho_trans_create(tx_ctx);
+    ho_key_t s_key, sgw_key;
+    uint32_t* mme_index;
+    ho_sgw_key(&sgw_key, sgw_ue_id);
+    if (tx_trans_kv_get(trans, sgw_key.bytes, sgw_key.len, (void**) &mme_index) < 0) return ho_reject(trans);
+
+    ho_session_key(&s_key, *mme_index);
+    mme_session_t* s = ho_get_session(trans, &s_key);
+    if (s == NULL || s->active != HO_UE_HANDOVER) return ho_reject(trans);
+
+    // (a single MME --> the MME s1ap id of the UE stays the same)
+    ho_delete_ue_ctx(trans, &s->s1ap.primary);
+    s->s1ap.primary = s->s1ap.secondary;
+    memset(&s->s1ap.secondary, 0, sizeof(s->s1ap.secondary));
+    s->active = HO_UE_ACTIVE;
+    ho_set_session(trans, &s_key, s);
+    return tx_trans_commit(trans);
+}
@@ -2,6 +2,8 @@
 #include <stdlib.h>
 #include <time.h>  // struct tm 
 #include <string.h>
+#include <stddef.h>  // offsetof
+#include <stdio.h>  // FILE
 
 //////////////////////
 // Schema Definition
@@ -44,7 +46,8 @@ typedef struct district_t
     char d_zip[10];
     float d_tax;  // numeric(4, 4) signed
     float d_ytd;  // numeric(12, 2) signed
-    int d_next_o_id;  // Next available Order number
+    int d_next_o_id;  // Next available Order number (as populated, see d_o_id_seq)
+    tx_seq_t* d_o_id_seq;  // allocates the order numbers of the district (w/o touching the row, i.e., w/ gaps)
     // primary key (D_W_ID, D_ID),
     // foreign key (D_W_ID) references WAREHOUSE(W_ID)
 } __attribute__((packed)) district_t;
@@ -167,25 +170,50 @@ void gen_rand_lastname(char* lastname, int x);
 void gen_rand_datafield(char* data);
 void gen_rand_zip(char* zipcode);
 
-void init_db_population(const int n_warehouse);
+// upper bound of kv items (incl. aux tables) of the populated db and the orders inserted during a run
+#define TPCC_KVS_KEYS_PER_WAREHOUSE 1000000
+#define TPCC_KVS_KEYS(n_warehouse) (100000 + (n_warehouse) * TPCC_KVS_KEYS_PER_WAREHOUSE)
 
+// populates the db w/ n_threads loaders (items and warehouses are partitioned across them) -- returns the number of kv items
+// Rows are put directly into the backend (no txs, i.e., no OCC), so it must not run concurrently w/ txs.
+uint64_t init_db_population(const tx_kvs_ops_t* kvs_ops, void* kvs, const int n_warehouse, const int n_threads);
+
+// Store of the db on a backend: an ordered backend (e.g., skiplist) stores every table, while an unordered one
+//  (e.g., ht) stores only the tables accessed by primary key and the tables that are scanned (the secondary indexes
+//  c2 / o2, neworder and orderline) are put into a skiplist next to it (routed by the table tag of the key)
+typedef struct
+{
+    const tx_kvs_ops_t* point_ops;
+    void* point;
+    void* ordered;  // (skiplist)
+} tpcc_kvs_t;
+extern const tx_kvs_ops_t tpcc_kvs_ops;  // (of a tpcc_kvs_t)
+const tx_kvs_ops_t* tpcc_kvs_ops_of(const tx_kvs_ops_t* point_ops);  // the ops of the store of tpcc_kvs_create
+void* tpcc_kvs_create(const tx_kvs_ops_t* point_ops, uint64_t max_keys);
+
+// per-thread random generator (xorshift64*) -- seeded w/ tpcc_srand by every thread that generates data / txs
+extern __thread uint64_t tpcc_rand_state;
+static inline void tpcc_srand(uint64_t seed)
+{
+    tpcc_rand_state = seed * 0x9E3779B97F4A7C15ULL + 1;  // never 0
+}
+static inline uint64_t tpcc_rand(void)
+{
+    uint64_t x = tpcc_rand_state;
+    x ^= x >> 12; x ^= x << 25; x ^= x >> 27;
+    tpcc_rand_state = x;
+    return x * 0x2545F4914F6CDD1DULL;
+}
 static inline int Random(int l, int r)  // uniform, inclusive
 {
-    // ??? Problematic. See the comments below
-    if (r - l > RAND_MAX) return rand() / (double)RAND_MAX * (r-l) + l;
-    // Due to the discrete nature of floating-point numbers, this may mean that
-    //  some values will just never show up in your output stream.
-    // In C++11 we can use the std::default_random_engine library to solve this problem,
-    //  but not in C
-    else return rand() % (r-l+1) + l;
-    // So I use another way (as above) when r - l <= RAND_MAX, but this is also problematic 
-    //  because the result is not uniformly distributed when RAND_MAX % (r-l+1) != 0.
-    // Maybe we shall choose "the lesser of two evils"
+    // (the bias of the modulo of a 64-bit random number is negligible for the ranges of TPC-C)
+    return (int) (tpcc_rand() % (uint64_t) (r - l + 1)) + l;
 }
 static inline struct tm cur_local_time()
 {
     time_t cur_time = time(NULL);
-    return *localtime(&cur_time);
+    struct tm local;
+    return *localtime_r(&cur_time, &local);
 }
 static inline void swap(int* a, int* b) { int t = *a; *a = *b; *b = t; }
 static inline int nurand(int A, int x, int y)
@@ -208,35 +236,133 @@ static inline int nurand(int A, int x, int y)
 // Database Operations
 ////////////////////////
 
-extern inline void Insert(tx_trans_t* trans, char* key, void* val);
-extern inline void Select(tx_trans_t* trans, char* key, void** val);
-extern inline void Delete(tx_trans_t* trans, char* key);
-
-extern const int prikey_len_warehouse;
-extern const int prikey_len_district;
-extern const int prikey_len_customer;
-extern const int prikey_len_item;
-extern const int prikey_len_order;
-extern const int prikey_len_orderline;
-extern const int prikey_len_stock;
-extern const int prikey_len_neworder;
-extern const int prikey_len_history;
-extern const int prikey_len_c2;
-extern const int prikey_len_o2;
-extern const int prikey_len_no2;
-
-extern inline void Get_prikey_warehouse(char* pri_key, int w_id);
-extern inline void Get_prikey_district (char* pri_key, int d_w_id, int d_id);
-extern inline void Get_prikey_customer (char* pri_key, int c_w_id, int c_d_id, int c_id);
-extern inline void Get_prikey_item     (char* pri_key, int i_id);
-extern inline void Get_prikey_order    (char* pri_key, int o_w_id, int o_d_id, int o_id);
-extern inline void Get_prikey_orderline(char* pri_key, int ol_w_id, int ol_d_id, int ol_o_id, int ol_number);
-extern inline void Get_prikey_stock    (char* pri_key, int s_w_id, int s_i_id);
-extern inline void Get_prikey_neworder (char* pri_key, int no_w_id, int no_d_id, int no_o_id);
-extern inline void Get_prikey_history  (char* pri_key, int h_w_id, int h_d_id, int h_c_id);
-extern inline void Get_prikey_c2       (char* pri_key, int c_w_id, int c_d_id, char* c_last);
-extern inline void Get_prikey_o2       (char* pri_key, int o_w_id, int o_d_id, int o_c_id);
-extern inline void Get_prikey_no2      (char* pri_key, int no_w_id, int no_d_id);
+/// Primary keys are packed binary keys (instead of sprintf'ed strings): a table tag byte followed by
+/// the fixed-width big-endian ids of the table (so that keys of a table are memcmp-ordered by their ids).
+/// Every key fits in TPCC_KEY_MAX_LEN bytes, i.e., it is hashed / compared as (at most) two 64-bit words.
+#define TPCC_KEY_MAX_LEN 16
+
+typedef enum
+{
+    TPCC_TAG_WAREHOUSE = 1,
+    TPCC_TAG_DISTRICT,
+    TPCC_TAG_CUSTOMER,
+    TPCC_TAG_ITEM,
+    TPCC_TAG_ORDER,
+    TPCC_TAG_ORDERLINE,
+    TPCC_TAG_STOCK,
+    TPCC_TAG_NEWORDER,
+    TPCC_TAG_HISTORY,
+    TPCC_TAG_C2,  // secondary index: customers by last name
+    TPCC_TAG_O2   // secondary index: orders by customer
+} tpcc_table_tag_t;
+
+typedef struct
+{
+    uint8_t len;
+    uint8_t bytes[TPCC_KEY_MAX_LEN];
+} tpcc_key_t;
+
+static inline uint8_t* __tpcc_key_put8(uint8_t* p, int v)
+{
+    *p = (uint8_t) v;
+    return p + 1;
+}
+static inline uint8_t* __tpcc_key_put16(uint8_t* p, int v)
+{
+    p[0] = (uint8_t) (v >> 8); p[1] = (uint8_t) v;
+    return p + 2;
+}
+static inline uint8_t* __tpcc_key_put32(uint8_t* p, int v)
+{
+    uint32_t be = __builtin_bswap32((uint32_t) v);
+    memcpy(p, &be, 4);
+    return p + 4;
+}
+
+// Generates Get_prikey_<table>(key, ids...) which packs the tag and the ids w/ the given widths (8 / 16 / 32 bits)
+#define __TPCC_KEY_ID(width, id) p = __tpcc_key_put##width(p, id);
+#define TPCC_DEF_PRIKEY_1(table, tag, w1, id1) \
+    static inline void Get_prikey_##table(tpcc_key_t* key, int id1) { \
+        uint8_t* p = __tpcc_key_put8(key->bytes, tag); \
+        __TPCC_KEY_ID(w1, id1) \
+        key->len = (uint8_t) (p - key->bytes); }
+#define TPCC_DEF_PRIKEY_2(table, tag, w1, id1, w2, id2) \
+    static inline void Get_prikey_##table(tpcc_key_t* key, int id1, int id2) { \
+        uint8_t* p = __tpcc_key_put8(key->bytes, tag); \
+        __TPCC_KEY_ID(w1, id1) __TPCC_KEY_ID(w2, id2) \
+        key->len = (uint8_t) (p - key->bytes); }
+#define TPCC_DEF_PRIKEY_3(table, tag, w1, id1, w2, id2, w3, id3) \
+    static inline void Get_prikey_##table(tpcc_key_t* key, int id1, int id2, int id3) { \
+        uint8_t* p = __tpcc_key_put8(key->bytes, tag); \
+        __TPCC_KEY_ID(w1, id1) __TPCC_KEY_ID(w2, id2) __TPCC_KEY_ID(w3, id3) \
+        key->len = (uint8_t) (p - key->bytes); }
+#define TPCC_DEF_PRIKEY_4(table, tag, w1, id1, w2, id2, w3, id3, w4, id4) \
+    static inline void Get_prikey_##table(tpcc_key_t* key, int id1, int id2, int id3, int id4) { \
+        uint8_t* p = __tpcc_key_put8(key->bytes, tag); \
+        __TPCC_KEY_ID(w1, id1) __TPCC_KEY_ID(w2, id2) __TPCC_KEY_ID(w3, id3) __TPCC_KEY_ID(w4, id4) \
+        key->len = (uint8_t) (p - key->bytes); }
+
+TPCC_DEF_PRIKEY_1(warehouse, TPCC_TAG_WAREHOUSE, 32, w_id)                                     //  5B
+TPCC_DEF_PRIKEY_2(district,  TPCC_TAG_DISTRICT,  32, d_w_id,  8, d_id)                         //  6B
+TPCC_DEF_PRIKEY_3(customer,  TPCC_TAG_CUSTOMER,  32, c_w_id,  8, c_d_id, 32, c_id)             // 10B
+TPCC_DEF_PRIKEY_1(item,      TPCC_TAG_ITEM,      32, i_id)                                     //  5B
+TPCC_DEF_PRIKEY_3(order,     TPCC_TAG_ORDER,     32, o_w_id,  8, o_d_id, 32, o_id)             // 10B
+TPCC_DEF_PRIKEY_4(orderline, TPCC_TAG_ORDERLINE, 32, ol_w_id, 8, ol_d_id, 32, ol_o_id, 8, ol_number) // 11B
+TPCC_DEF_PRIKEY_2(stock,     TPCC_TAG_STOCK,     32, s_w_id, 32, s_i_id)                       //  9B
+TPCC_DEF_PRIKEY_3(neworder,  TPCC_TAG_NEWORDER,  32, no_w_id, 8, no_d_id, 32, no_o_id)         // 10B
+TPCC_DEF_PRIKEY_3(history,   TPCC_TAG_HISTORY,   32, h_w_id,  8, h_d_id, 32, h_c_id)           // 10B
+TPCC_DEF_PRIKEY_4(c2,        TPCC_TAG_C2,        32, c_w_id,  8, c_d_id, 16, c_last_no, 32, c_id) // 12B
+TPCC_DEF_PRIKEY_4(o2,        TPCC_TAG_O2,        32, o_w_id,  8, o_d_id, 32, o_c_id, 32, o_id)    // 14B
+
+// decodes a key back to its table and ids, e.g., "district(w=1,d=3)" (as snprintf -- a tx_stats_key_fmt)
+int tpcc_key_str(const uint8_t* key, uint32_t key_len, char* out, uint32_t out_len);
+
+// number [0 .. 999] of the syllables of a C_LAST (see gen_rand_lastname) or -1 if it is not a valid last name
+// (C_LAST is keyed by it, so that the c2 keys stay fixed-width)
+int lastname_to_no(const char* lastname);
+
+// value of a c2 entry (so that the matches of a last name are ordered by C_FIRST w/o reading the customers)
+typedef struct
+{
+    int c_id;
+    char c_first[17];
+} __attribute__((packed)) customer_by_name_t;
+
+static inline void Insert(tx_trans_t* trans, tpcc_key_t* key, void* val, uint32_t val_len)
+{
+    tx_trans_kv_set(trans, key->bytes, key->len, val, val_len);
+}
+static inline void Select(tx_trans_t* trans, tpcc_key_t* key, void** val)
+{
+    tx_trans_kv_get(trans, key->bytes, key->len, val);
+}
+static inline void Delete(tx_trans_t* trans, tpcc_key_t* key)
+{
+    tx_trans_kv_del(trans, key->bytes, key->len);
+}
+// field-level access of large rows (customer, stock): only the bytes of [offset, offset + len) of *row are valid
+// and updates write back only those bytes of the row (see tx_trans_kv_get_range / tx_trans_kv_update_range)
+#define FIELDS(T, first, last) offsetof(T, first), (offsetof(T, last) + sizeof(((T *) 0)->last) - offsetof(T, first))
+static inline void Select_fields(tx_trans_t* trans, tpcc_key_t* key, uint32_t offset, uint32_t len, void** row)
+{
+    tx_trans_kv_get_range(trans, key->bytes, key->len, offset, len, row);
+}
+static inline void Update_fields(tx_trans_t* trans, tpcc_key_t* key, void* row, uint32_t offset, uint32_t len)
+{
+    tx_trans_kv_update_range(trans, key->bytes, key->len, offset, (char*) row + offset, len);
+}
+// hint that the row of key is about to be accessed: len 0 --> its index entry, else its first len bytes (a lookup,
+//  i.e., its index entry should be prefetched beforehand -- see tx_single_kv_prefetch)
+static inline void Prefetch(tx_ctx_t* ctx, tpcc_key_t* key, uint32_t len)
+{
+    tx_single_kv_prefetch(ctx, key->bytes, key->len, len);
+}
+// scans [from, to) -- of one of the ordered tables (see tpcc_kvs_t)
+static inline int Scan(tx_trans_t* trans, tpcc_key_t* from, tpcc_key_t* to, uint32_t max_rows,
+                       tx_trans_scan_cb cb, void* cb_arg)
+{
+    return tx_trans_kv_scan(trans, from->bytes, from->len, to->bytes, to->len, max_rows, cb, cb_arg);
+}
 
 void Select_warehouse           (tx_trans_t* trans, int w_id, warehouse_t** w);
 void Select_district            (tx_trans_t* trans, int d_w_id, int d_id, district_t** d);
@@ -245,11 +371,18 @@ void Select_item                (tx_trans_t* trans, int i_id, item_t** i);
 void Select_order               (tx_trans_t* trans, int o_w_id, int o_d_id, int o_id, order_t** o);
 void Select_orderline           (tx_trans_t* trans, int ol_w_id, int ol_d_id, int ol_o_id, int ol_number, orderline_t** ol);
 void Select_stock               (tx_trans_t* trans, int s_w_id, int s_i_id, stock_t** s);
+// the items of i_ids (w/ their lookups overlapped, see tx_trans_kv_multi_get) -- returns the number found
+int  Select_items               (tx_trans_t* trans, const int* i_ids, int n_items, item_t** i);
 void Select_neworder            (tx_trans_t* trans, int no_w_id, int no_d_id, int no_o_id, neworder_t** no);
 void Select_history             (tx_trans_t* trans, int h_w_id, int h_d_id, int h_c_id, history_t** h);
 void Select_customer_byname     (tx_trans_t* trans, int c_w_id, int c_d_id, char* c_last, customer_t** c);
+// C_ID of the customer selected by last name (-1 if none)
+int  Select_customer_id_byname  (tx_trans_t* trans, int c_w_id, int c_d_id, char* c_last);
 void Select_latest_order        (tx_trans_t* trans, int o_w_id, int o_d_id, int o_c_id, order_t** o);
 void Select_undelivered_neworder(tx_trans_t* trans, int no_w_id, int no_d_id, neworder_t** no);
+// orderlines of [o_id_from, o_id_to) (in key order) -- returns their number (up to max_ol)
+int  Select_orderlines          (tx_trans_t* trans, int ol_w_id, int ol_d_id, int o_id_from, int o_id_to,
+                                 orderline_t** ol, int max_ol);
 
 void Insert_warehouse(tx_trans_t* trans, warehouse_t* w);
 void Insert_district (tx_trans_t* trans, district_t* d);
@@ -261,14 +394,133 @@ void Insert_stock    (tx_trans_t* trans, stock_t* s);
 void Insert_neworder (tx_trans_t* trans, neworder_t* no);
 void Insert_history  (tx_trans_t* trans, history_t* h);
 
-void Insert_warehouse_trans(tx_ctx_t* ctx, warehouse_t* w);
-void Insert_district_trans (tx_ctx_t* ctx, district_t* d);
-void Insert_customer_trans (tx_ctx_t* ctx, customer_t* c);
-void Insert_item_trans     (tx_ctx_t* ctx, item_t* i);
-void Insert_order_trans    (tx_ctx_t* ctx, order_t* o);
-void Insert_orderline_trans(tx_ctx_t* ctx, orderline_t* ol);
-void Insert_stock_trans    (tx_ctx_t* ctx, stock_t* s);
-void Insert_neworder_trans (tx_ctx_t* ctx, neworder_t* no);
-void Insert_history_trans  (tx_ctx_t* ctx, history_t* h);
+// updates of existing rows (w/o touching the secondary indexes)
+void Update_customer (tx_trans_t* trans, customer_t* c);
+void Update_order    (tx_trans_t* trans, order_t* o);
+
+// e.g., Select_customer_fields(trans, w_id, d_id, c_id, FIELDS(customer_t, c_balance, c_delivery_cnt), &c)
+void Select_customer_fields(tx_trans_t* trans, int c_w_id, int c_d_id, int c_id, uint32_t offset, uint32_t len,
+                            customer_t** c);
+void Select_stock_fields   (tx_trans_t* trans, int s_w_id, int s_i_id, uint32_t offset, uint32_t len, stock_t** s);
+void Update_customer_fields(tx_trans_t* trans, int c_w_id, int c_d_id, int c_id, customer_t* c, uint32_t offset,
+                            uint32_t len);
+void Update_stock_fields   (tx_trans_t* trans, int s_w_id, int s_i_id, stock_t* s, uint32_t offset, uint32_t len);
+
+// commutative adds to fields of rows (see tx_trans_kv_add) -- return -1 if the row is not found
+int Add_warehouse_ytd    (tx_trans_t* trans, int w_id, float amount);
+int Add_district_ytd     (tx_trans_t* trans, int d_w_id, int d_id, float amount);
+// S_YTD += quantity, S_ORDER_CNT += 1 and S_REMOTE_CNT += remote
+int Add_stock_order      (tx_trans_t* trans, int s_w_id, int s_i_id, uint32_t quantity, uint16_t remote);
+// C_BALANCE += amount and C_DELIVERY_CNT += 1
+int Add_customer_delivery(tx_trans_t* trans, int c_w_id, int c_d_id, int c_id, float amount);
+
+// single (non-transactional) reads of a copy of a row -- return -1 if it is not found
+int Read_warehouse(tx_ctx_t* ctx, int w_id, warehouse_t* w);
+int Read_district (tx_ctx_t* ctx, int d_w_id, int d_id, district_t* d);
+
+// bulk load (see init_db_population): a loader puts the rows directly into the backend
+typedef struct
+{
+    const tx_kvs_ops_t* kvs_ops;
+    void* kvs;
+    uint64_t n_rows;  // kv items put so far
+} tpcc_loader_t;
+
+static inline void Load(tpcc_loader_t* ld, tpcc_key_t* key, void* val, uint32_t val_len)
+{
+    if (ld->kvs_ops->put(ld->kvs, key->bytes, key->len, val, val_len) < 0)
+    {
+        fprintf(stderr, "Backend %s is full after %lu rows!\n", ld->kvs_ops->name, ld->n_rows);
+        exit(1);
+    }
+    ld->n_rows++;
+}
+
+void Load_warehouse(tpcc_loader_t* ld, warehouse_t* w);
+void Load_district (tpcc_loader_t* ld, district_t* d);
+void Load_customer (tpcc_loader_t* ld, customer_t* c);
+void Load_item     (tpcc_loader_t* ld, item_t* i);
+void Load_order    (tpcc_loader_t* ld, order_t* o);
+void Load_orderline(tpcc_loader_t* ld, orderline_t* ol);
+void Load_stock    (tpcc_loader_t* ld, stock_t* s);
+void Load_neworder (tpcc_loader_t* ld, neworder_t* no);
+void Load_history  (tpcc_loader_t* ld, history_t* h);
 
 void Delete_neworder(tx_trans_t* trans, neworder_t* no);
+
+//////////////////
+// Transactions
+//////////////////
+
+typedef enum
+{
+    TPCC_NEW_ORDER = 1,  // (ids of the trace of tpcc_trans_generator.py)
+    TPCC_PAYMENT,
+    TPCC_ORDER_STATUS,
+    TPCC_DELIVERY,
+    TPCC_STOCK_LEVEL,
+    TPCC_NUM_TXN_TYPES
+} tpcc_txn_type_t;
+
+typedef struct
+{
+    int ol_i_id;
+    int ol_supply_w_id;
+    int ol_quantity;
+} tpcc_order_line_in_t;
+
+// input of a business transaction (generated by a terminal or read from a trace)
+typedef struct
+{
+    tpcc_txn_type_t type;
+    int w_id;
+    int d_id;  // (not used by delivery)
+    union
+    {
+        struct { int c_id, ol_cnt; tpcc_order_line_in_t ol[15]; } new_order;
+        struct { int c_w_id, c_d_id; float h_amount; int byname, c_id; char c_last[17]; } payment;  // byname: 1 by c_last, 2 by c_id
+        struct { int byname, c_id; char c_last[17]; } order_status;
+        struct { int o_carrier_id; time_t enq_time; } delivery;  // (enq_time: queued for deferred execution)
+        struct { int threshold; } stock_level;
+    };
+} tpcc_txn_t;
+
+typedef struct
+{
+    uint64_t committed[TPCC_NUM_TXN_TYPES];  // business txs (rolled back new-orders incl.)
+    uint64_t failed   [TPCC_NUM_TXN_TYPES];  // failed commits (the tx is retried)
+    uint64_t rolled_back;                    // new-orders w/ an unused item
+} tpcc_stats_t;
+
+// state of the emulated terminals of a worker thread
+typedef struct
+{
+    tx_ctx_t*    ctx;
+    FILE*        delivery_log;  // results of the deliveries (NULL --> not logged)
+    tpcc_stats_t stats;
+} tpcc_terminal_t;
+
+// input of a random tx of the given type from the home warehouse w_id (port of tpcc_trans_generator.py)
+void gen_trans(tpcc_txn_t* txn, tpcc_txn_type_t type, int w_id, int n_warehouse);
+// % of the order lines supplied by / payments of customers of a remote warehouse (1 and 15 by the spec)
+extern int tpcc_remote_ol_pct, tpcc_remote_payment_pct;
+// next tx of a trace of tpcc_trans_generator.py -- returns 0 at its end
+int  read_trans(FILE* trace, tpcc_txn_t* txn);
+// binary traces (see tx_trace.h; tpcc --convert writes one from a text trace): a record is the tpcc_txn_t of the
+//  tx truncated after the input of its type, i.e., the replay casts records in place
+#define TPCC_TRACE_WORKLOAD "tpcc"
+uint32_t trans_rec_len(tpcc_txn_type_t type);  // (0 --> not a tx type)
+
+// prefetches the rows a tx will access by key (stage 0: their index entries, stage 1: the rows), e.g., of the next
+//  txs of a terminal while it runs the current one
+void trans_prefetch(tx_ctx_t* ctx, const tpcc_txn_t* txn, int stage);
+
+// runs a business tx until it commits (or it is rolled back) and counts it in term->stats
+void trans_run(tpcc_terminal_t* term, const tpcc_txn_t* txn);
+
+// failed: the commit failed or the tx read an inconsistent state (a missing row) and was aborted
+tx_trans_result trans_new_order   (tpcc_terminal_t* term, const tpcc_txn_t* txn);
+tx_trans_result trans_payment     (tpcc_terminal_t* term, const tpcc_txn_t* txn);
+tx_trans_result trans_order_status(tpcc_terminal_t* term, const tpcc_txn_t* txn);
+tx_trans_result trans_delivery    (tpcc_terminal_t* term, const tpcc_txn_t* txn);  // (retries each district)
+tx_trans_result trans_stock_level (tpcc_terminal_t* term, const tpcc_txn_t* txn);
@@ -0,0 +1,437 @@
+//
+// TPC-C driver: a timed run of the emulated terminals of W warehouses on T pinned worker threads
+//  (or the single-threaded replay of a trace of tpcc_trans_generator.py)
+//
+// usage: ./tpcc [--warehouses W] [--threads T] [--duration secs] [--mix NO,P,OS,D,SL] [--backend ht|skiplist]
+//               [--pipeline N] [--remote OL,P] [--partitioned] [--trace trans_trace.txt|.bin] [--stats stats.json]
+//        ./tpcc --trace trans_trace.txt --convert trans_trace.bin
+// e.g. gcc -O3 -pthread -I. -Itpcc tpcc/*.c tx_shim.c tx_shim_single.c tx_shim_trans.c tx_shim_slab.c
+//          tx_shim_kvs.c tx_shim_kvs_skiplist.c tx_shim_part.c tx_trace.c -o tpcc
+//  (a text trace is parsed as it is replayed, i.e., in the measured window: --convert writes the binary trace
+//   of it once, which is then mmaped and replayed w/o parsing -- see tx_trace.h)
+//  (add -DTX_STATS tx_shim_stats.c for --stats, which dumps the latency percentiles, abort causes and hot keys
+//   of the run as JSON)
+//
+// Worker t emulates the terminals of the warehouses w with (w-1) % T == t (or of warehouse t % W + 1 if T > W),
+//  i.e., the home warehouse of each tx is one of its own and only remote accesses (and T > W) conflict.
+// --pipeline N: a worker generates the inputs of its next N-1 txs ahead and prefetches the rows they access by key
+//  (the index entries when a tx is generated, the rows while the tx before it runs), so that w/ a dataset larger
+//  than the LLC (e.g., 100 warehouses) the misses of a tx overlap w/ the execution of the previous one
+//  (nothing is prefetched w/ a backend w/o a prefetch op, e.g., skiplist).
+// --remote OL,P: the % of the order lines of new-orders supplied by a remote warehouse and of the payments of the
+//  customers of a remote warehouse (1,15 by the spec).
+// --partitioned: instead of OCC, worker t owns the partition of its home warehouses (i.e., of all the rows keyed by
+//  their w_id -- items are only read) and the txs run deterministically (see tx_shim_part.h): those of its own
+//  warehouses serially and w/o locks or validation, those w/ a remote warehouse (of another worker) after the
+//  sequencer has ordered them. The replay of a trace is then a single partition (i.e., only the commits differ).
+//
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+#include "tx_shim.h"
+#include "tx_shim_slab.h"
+#include "tx_shim_part.h"
+#include "tx_trace.h"
+#ifdef TX_STATS
+#include "tx_shim_stats.h"
+#endif
+#include "tpcc.h"
+#define new(T) tx_slab_alloc(sizeof(T))  // rows are 64B-aligned w/o the malloc lock
+
+#define TPCC_MAX_PIPELINE 16
+
+static const char* tpcc_txn_names[TPCC_NUM_TXN_TYPES] = {
+    [TPCC_NEW_ORDER]    = "new-order",
+    [TPCC_PAYMENT]      = "payment",
+    [TPCC_ORDER_STATUS] = "order-status",
+    [TPCC_DELIVERY]     = "delivery",
+    [TPCC_STOCK_LEVEL]  = "stock-level"
+};
+
+typedef struct
+{
+    tpcc_terminal_t term;
+    int thread_id;
+    int n_warehouse;
+    int n_threads;
+    const int* mix;  // weights by tx type
+    int pipeline;    // txs generated ahead (1 --> none)
+    const tx_kvs_ops_t* kvs_ops;
+    void* kvs;
+    tx_part_sched_t* sched;  // --partitioned (the partition of the worker is its thread_id)
+    volatile uint8_t* stop;
+} tpcc_worker_t;
+
+#ifdef TX_STATS
+static tx_stats_t* run_stats;  // of all the ctxs of the run (merged before they are destroyed)
+static pthread_mutex_t run_stats_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void merge_ctx_stats(tx_ctx_t* ctx)
+{
+    pthread_mutex_lock(&run_stats_lock);
+    tx_stats_merge(run_stats, ctx->stats);
+    pthread_mutex_unlock(&run_stats_lock);
+}
+#endif
+
+static inline double elapsed_secs(struct timespec* start)
+{
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (end.tv_sec - start->tv_sec) + (end.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+static inline tpcc_txn_type_t pick_txn_type(const int* mix, int mix_sum)
+{
+    int x = Random(1, mix_sum), type = TPCC_NEW_ORDER;
+    while (x > mix[type]) x -= mix[type++];
+    return type;
+}
+
+// --partitioned: the warehouses of worker t are those w/ (w-1) % T == t (T <= W)
+static void trans_parts(const tpcc_txn_t* txn, int n_threads, tx_part_set_t* parts)
+{
+    tx_part_set_clear(parts);
+    tx_part_set_add(parts, (txn->w_id - 1) % n_threads);
+    if (txn->type == TPCC_NEW_ORDER)
+        for (int k = 0; k < txn->new_order.ol_cnt; k++)
+            tx_part_set_add(parts, (txn->new_order.ol[k].ol_supply_w_id - 1) % n_threads);
+    else if (txn->type == TPCC_PAYMENT)
+        tx_part_set_add(parts, (txn->payment.c_w_id - 1) % n_threads);
+}
+
+typedef struct
+{
+    tpcc_terminal_t* term;  // (of the submitter)
+    const tpcc_txn_t* txn;
+} tpcc_part_txn_t;
+
+// (on the ctx of one of the partitions of the tx, w/ all of them held)
+static int part_trans_run(tx_ctx_t* ctx, void* arg)
+{
+    tpcc_part_txn_t* pt = (tpcc_part_txn_t *) arg;
+    tx_ctx_t* own_ctx = pt->term->ctx;
+    pt->term->ctx = ctx;
+    trans_run(pt->term, pt->txn);
+    pt->term->ctx = own_ctx;
+    return committed;
+}
+
+static void part_trans_exec(tpcc_worker_t* wk, const tpcc_txn_t* txn)
+{
+    tpcc_part_txn_t pt = { .term = &wk->term, .txn = txn };
+    tx_part_set_t parts;
+    trans_parts(txn, wk->n_threads, &parts);
+    tx_part_poll(wk->sched, wk->thread_id);
+    tx_part_exec(wk->sched, wk->thread_id, &parts, part_trans_run, &pt);
+}
+
+static void* tpcc_worker(void* arg)
+{
+    tpcc_worker_t* wk = (tpcc_worker_t *) arg;
+
+    cpu_set_t cpuset;
+    CPU_ZERO(&cpuset);
+    CPU_SET(wk->thread_id % sysconf(_SC_NPROCESSORS_ONLN), &cpuset);
+    pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset);
+
+    tpcc_srand(time(NULL) ^ ((uint64_t) wk->thread_id << 32));
+    tx_ctx_t* ctx = new(tx_ctx_t);
+    tx_ctx_init(ctx, wk->kvs_ops, wk->kvs);
+    wk->term.ctx = ctx;
+    if (wk->sched != NULL) tx_part_attach(wk->sched, wk->thread_id, ctx);
+
+    // home warehouses: first_w, first_w + T, ... (<= W)
+    int first_w = wk->thread_id % wk->n_warehouse + 1;
+    int n_homes = wk->n_threads >= wk->n_warehouse ? 1 : (wk->n_warehouse - first_w) / wk->n_threads + 1;
+
+    int mix_sum = 0;
+    for (int type = TPCC_NEW_ORDER; type < TPCC_NUM_TXN_TYPES; type++) mix_sum += wk->mix[type];
+
+    tpcc_txn_t txns[TPCC_MAX_PIPELINE];  // (ring of the next txs)
+    for (int k = 0; k < wk->pipeline; k++)
+    {
+        int w_id = first_w + wk->n_threads * Random(0, n_homes - 1);
+        gen_trans(&txns[k], pick_txn_type(wk->mix, mix_sum), w_id, wk->n_warehouse);
+        if (wk->pipeline > 1) trans_prefetch(ctx, &txns[k], 0);
+    }
+    for (int k = 0; !*wk->stop; k = (k + 1) % wk->pipeline)
+    {
+        if (wk->pipeline > 1) trans_prefetch(ctx, &txns[(k + 1) % wk->pipeline], 1);
+        if (wk->sched != NULL) part_trans_exec(wk, &txns[k]);
+        else trans_run(&wk->term, &txns[k]);
+
+        int w_id = first_w + wk->n_threads * Random(0, n_homes - 1);
+        gen_trans(&txns[k], pick_txn_type(wk->mix, mix_sum), w_id, wk->n_warehouse);
+        if (wk->pipeline > 1) trans_prefetch(ctx, &txns[k], 0);
+    }
+    if (wk->sched != NULL) tx_part_finish(wk->sched, wk->thread_id);
+
+#ifdef TX_STATS
+    merge_ctx_stats(ctx);
+#endif
+    tx_ctx_destroy(ctx);
+    tx_slab_free(ctx);
+    return NULL;
+}
+
+static void replay_trace(tpcc_terminal_t* term, FILE* trace)
+// deliveries are deferred to the end of the trace (and their results are logged)
+{
+    static tpcc_txn_t que[10001]; int qtop = 0;  // queue for deferred execution
+    tpcc_txn_t txn;
+    while (read_trans(trace, &txn))
+    {
+        if (txn.type != TPCC_DELIVERY) trans_run(term, &txn);
+        else if (qtop < 10001) que[qtop++] = txn;
+    }
+    for (int i = 0; i < qtop; i++) trans_run(term, &que[i]);
+}
+
+static void replay_trace_bin(tpcc_terminal_t* term, const tx_trace_t* trace)
+// (as replay_trace, but the records are run in place)
+{
+    static tpcc_txn_t que[10001]; int qtop = 0;
+    for (const uint8_t* rec = trace->records; rec < trace->end; )
+    {
+        const tpcc_txn_t* txn = (const tpcc_txn_t*) rec;
+        uint32_t rec_len = trans_rec_len(txn->type);
+        if (rec_len == 0) { puts("Error!"); break; }
+        if (txn->type != TPCC_DELIVERY) trans_run(term, txn);
+        else if (qtop < 10001)
+        {
+            memcpy(&que[qtop], txn, rec_len);
+            que[qtop++].delivery.enq_time = time(NULL);
+        }
+        rec += rec_len;
+    }
+    for (int i = 0; i < qtop; i++) trans_run(term, &que[i]);
+}
+
+static int convert_trace(const char* in_file, const char* out_file)
+{
+    FILE* in = fopen(in_file, "r");
+    if (in == NULL) { perror(in_file); return 1; }
+    tx_trace_writer_t out;
+    if (tx_trace_writer_open(&out, out_file, TPCC_TRACE_WORKLOAD, NULL, 0) < 0) { perror(out_file); return 1; }
+
+    tpcc_txn_t txn;
+    memset(&txn, 0, sizeof(txn));  // (no stack garbage in the padding of the records)
+    while (read_trans(in, &txn))
+    {
+        if (txn.type == TPCC_DELIVERY) txn.delivery.enq_time = 0;  // (set when queued)
+        tx_trace_writer_append(&out, &txn, trans_rec_len(txn.type));
+        memset(&txn, 0, sizeof(txn));
+    }
+    fclose(in);
+    uint64_t n_records = out.hdr.n_records, len = out.hdr.records_len;
+    if (tx_trace_writer_close(&out) < 0) { perror(out_file); return 1; }
+    printf("Converted %lu txs to %s (%lu bytes of records)\n", n_records, out_file, len);
+    return 0;
+}
+
+static void report(const tpcc_stats_t* stats, double elapsed)
+{
+    uint64_t tot_committed = 0, tot_failed = 0;
+    printf("%-13s %10s %12s %11s\n", "tx", "committed", "tx/s", "abort rate");
+    for (int type = TPCC_NEW_ORDER; type < TPCC_NUM_TXN_TYPES; type++)
+    {
+        uint64_t c = stats->committed[type], f = stats->failed[type];
+        printf("%-13s %10lu %12.1f %10.2f%%\n", tpcc_txn_names[type], c, c / elapsed, 100.0 * f / (c + f + (c + f == 0)));
+        tot_committed += c; tot_failed += f;
+    }
+    printf("%-13s %10lu %12.1f %10.2f%%\n", "total", tot_committed, tot_committed / elapsed,
+           100.0 * tot_failed / (tot_committed + tot_failed + (tot_committed + tot_failed == 0)));
+    printf("tpmC: %.1f (%lu new-orders rolled back) in %.2f s\n",
+           stats->committed[TPCC_NEW_ORDER] * 60 / elapsed, stats->rolled_back, elapsed);
+}
+
+static void usage(const char* prog)
+{
+    printf("usage: %s [--warehouses W] [--threads T] [--duration secs] [--mix NO,P,OS,D,SL] [--backend name]"
+           " [--pipeline N] [--remote OL,P] [--partitioned] [--trace file] [--stats file]\n       %s --trace file.txt --convert file.bin\n", prog, prog);
+}
+
+int main(int argc, char* argv[])
+{
+    int n_warehouse = 1, n_threads = 1, pipeline = 1, partitioned = 0;
+    double duration = 10;
+    int mix[TPCC_NUM_TXN_TYPES] = { [TPCC_NEW_ORDER] = 45, [TPCC_PAYMENT] = 43, [TPCC_ORDER_STATUS] = 4,
+                                    [TPCC_DELIVERY] = 4, [TPCC_STOCK_LEVEL] = 4 };
+    const char* backend = "ht";
+    const char* trace_file = NULL;
+    const char* stats_file = NULL;
+    const char* convert_file = NULL;
+
+    static const struct option opts[] = {
+        { "warehouses", required_argument, NULL, 'w' },
+        { "threads",    required_argument, NULL, 't' },
+        { "duration",   required_argument, NULL, 'd' },
+        { "mix",        required_argument, NULL, 'm' },
+        { "backend",    required_argument, NULL, 'b' },
+        { "pipeline",   required_argument, NULL, 'p' },
+        { "trace",      required_argument, NULL, 'f' },
+        { "stats",      required_argument, NULL, 's' },
+        { "convert",    required_argument, NULL, 'c' },
+        { "remote",     required_argument, NULL, 'r' },
+        { "partitioned", no_argument,      NULL, 'P' },
+        { NULL, 0, NULL, 0 }
+    };
+    int opt;
+    while ((opt = getopt_long(argc, argv, "w:t:d:m:b:p:f:s:c:r:P", opts, NULL)) != -1)
+        switch (opt)
+        {
+            case 'w': n_warehouse = atoi(optarg); break;
+            case 't': n_threads = atoi(optarg); break;
+            case 'd': duration = atof(optarg); break;
+            case 'm':
+                if (sscanf(optarg, "%d,%d,%d,%d,%d", &mix[TPCC_NEW_ORDER], &mix[TPCC_PAYMENT], &mix[TPCC_ORDER_STATUS],
+                           &mix[TPCC_DELIVERY], &mix[TPCC_STOCK_LEVEL]) != 5) { usage(argv[0]); return 1; }
+                break;
+            case 'b': backend = optarg; break;
+            case 'p': pipeline = atoi(optarg); break;
+            case 'f': trace_file = optarg; break;
+            case 's': stats_file = optarg; break;
+            case 'c': convert_file = optarg; break;
+            case 'r':
+                if (sscanf(optarg, "%d,%d", &tpcc_remote_ol_pct, &tpcc_remote_payment_pct) != 2 ||
+                    tpcc_remote_ol_pct < 0 || tpcc_remote_ol_pct > 100 ||
+                    tpcc_remote_payment_pct < 0 || tpcc_remote_payment_pct > 100) { usage(argv[0]); return 1; }
+                break;
+            case 'P': partitioned = 1; break;
+            default: usage(argv[0]); return 1;
+        }
+    int mix_sum = 0;
+    for (int type = TPCC_NEW_ORDER; type < TPCC_NUM_TXN_TYPES; type++)
+        mix_sum += mix[type] < 0 ? -1000 : mix[type];
+    if (n_warehouse < 1 || n_threads < 1 || n_threads > TX_MAX_THREADS - 1 || mix_sum <= 0 ||
+        pipeline < 1 || pipeline > TPCC_MAX_PIPELINE)
+        { usage(argv[0]); return 1; }
+    if (partitioned && trace_file == NULL && n_threads > n_warehouse)
+        { puts("--partitioned needs a warehouse per thread (T <= W)!"); return 1; }
+    if (convert_file != NULL)
+    {
+        if (trace_file == NULL) { usage(argv[0]); return 1; }
+        return convert_trace(trace_file, convert_file);
+    }
+
+    // (w/ an unordered backend, the tables of the range queries go to a skiplist -- see tpcc_kvs_t)
+    const tx_kvs_ops_t* backend_ops = tx_kvs_ops_by_name(backend);
+    if (backend_ops == NULL) { puts("Unknown backend!"); return 1; }
+    const tx_kvs_ops_t* kvs_ops = tpcc_kvs_ops_of(backend_ops);
+#ifdef TX_STATS
+    run_stats = tx_stats_create();
+#else
+    if (stats_file != NULL) { puts("--stats needs a build w/ -DTX_STATS (and tx_shim_stats.c)!"); return 1; }
+#endif
+    void* kvs = tpcc_kvs_create(backend_ops, TPCC_KVS_KEYS(n_warehouse));  // (sized for the whole run upfront)
+
+    // the population is partitioned across (as many as) the workers of the run
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    uint64_t n_rows = init_db_population(kvs_ops, kvs, n_warehouse, n_threads);
+    double load_secs = elapsed_secs(&start);
+    printf("Populated %d warehouse(s) w/ %d thread(s) in %.2f s: %lu rows, %.2f M rows/s (%s%s)\n", n_warehouse,
+           n_threads, load_secs, n_rows, n_rows / load_secs / 1e6, backend_ops->name,
+           kvs_ops == backend_ops ? "" : ", scanned tables on skiplist");
+
+    tx_ctx_t* ctx = new(tx_ctx_t);
+    tx_ctx_init(ctx, kvs_ops, kvs);
+
+    tpcc_stats_t stats = {};
+    if (trace_file != NULL)
+    {
+        tx_trace_t bin_trace;
+        FILE* trace = NULL;
+        if (tx_trace_open(&bin_trace, trace_file, TPCC_TRACE_WORKLOAD) < 0)  // (not a binary trace)
+        {
+            trace = fopen(trace_file, "r");
+            if (trace == NULL) { perror(trace_file); return 1; }
+        }
+        tpcc_terminal_t term = { .ctx = ctx, .delivery_log = fopen("delivery_tx_result.txt", "w") };
+        tx_part_sched_t sched;
+        if (partitioned)  // (a single partition, i.e., every tx is local)
+        {
+            tx_part_sched_init(&sched, 1);
+            tx_part_attach(&sched, 0, ctx);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        if (trace != NULL) replay_trace(&term, trace);
+        else replay_trace_bin(&term, &bin_trace);
+        double elapsed = elapsed_secs(&start);
+        if (partitioned)
+        {
+            tx_part_finish(&sched, 0);
+            tx_part_sched_destroy(&sched);
+        }
+        if (trace != NULL) fclose(trace);
+        else tx_trace_close(&bin_trace);
+        fclose(term.delivery_log);
+        report(&term.stats, elapsed);
+    }
+    else {
+        volatile uint8_t stop = 0;
+        pthread_t threads[n_threads];
+        tpcc_worker_t* workers = calloc(n_threads, sizeof(tpcc_worker_t));
+        tx_part_sched_t sched;
+        if (partitioned) tx_part_sched_init(&sched, n_threads);
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (int i = 0; i < n_threads; i++)
+        {
+            workers[i] = (tpcc_worker_t) { .thread_id = i, .n_warehouse = n_warehouse, .n_threads = n_threads,
+                                           .mix = mix, .pipeline = pipeline, .kvs_ops = kvs_ops, .kvs = kvs,
+                                           .sched = partitioned ? &sched : NULL, .stop = &stop };
+            pthread_create(&threads[i], NULL, tpcc_worker, &workers[i]);
+        }
+
+        struct timespec ts = { (time_t) duration, (long) ((duration - (time_t) duration) * 1e9) };
+        nanosleep(&ts, NULL);
+        stop = 1;
+
+        for (int i = 0; i < n_threads; i++)
+        {
+            pthread_join(threads[i], NULL);
+            for (int type = TPCC_NEW_ORDER; type < TPCC_NUM_TXN_TYPES; type++)
+            {
+                stats.committed[type] += workers[i].term.stats.committed[type];
+                stats.failed[type] += workers[i].term.stats.failed[type];
+            }
+            stats.rolled_back += workers[i].term.stats.rolled_back;
+        }
+        double elapsed = elapsed_secs(&start);
+        printf("%d thread(s), %d warehouse(s), mix %d,%d,%d,%d,%d, pipeline %d, remote %d,%d", n_threads, n_warehouse,
+               mix[TPCC_NEW_ORDER], mix[TPCC_PAYMENT], mix[TPCC_ORDER_STATUS], mix[TPCC_DELIVERY],
+               mix[TPCC_STOCK_LEVEL], pipeline, tpcc_remote_ol_pct, tpcc_remote_payment_pct);
+        if (partitioned)
+        {
+            printf(", partitioned (%lu txs sequenced)", sched.num_sequenced);
+            tx_part_sched_destroy(&sched);
+        }
+        putchar('\n');
+        report(&stats, elapsed);
+        free(workers);
+    }
+
+#ifdef TX_STATS
+    merge_ctx_stats(ctx);  // (of the trace replay)
+    if (stats_file != NULL)
+    {
+        FILE* out = fopen(stats_file, "w");
+        if (out == NULL) { perror(stats_file); return 1; }
+        tx_stats_dump_json(out, run_stats, tpcc_key_str);
+        fclose(out);
+    }
+    tx_stats_free(run_stats);
+#endif
+    tx_ctx_destroy(ctx);
+    tx_slab_free(ctx);
+    kvs_ops->destroy(kvs);
+    return 0;
+}
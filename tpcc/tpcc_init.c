@@ -1,7 +1,12 @@
 #include "tx_shim.h"
+#include "tx_shim_slab.h"
 #include "tpcc.h"
 #include <time.h>  // struct tm 
-#define new(T) malloc(sizeof(T))
+#include <pthread.h>
+#include <assert.h>
+#define new(T) tx_slab_alloc(sizeof(T))  // rows are 64B-aligned w/o the malloc lock
+
+__thread uint64_t tpcc_rand_state = 88172645463325252ULL;  // (threads that do not tpcc_srand get the same sequence)
 
 void initialize_and_permute_random(int* permutation, int n)
 // Fisher-Yates shuffles for generating random permutations
@@ -49,6 +54,23 @@ void gen_rand_lastname(char* lastname, int x)
     strcat(lastname, c_last_name_sections[x2]);
     strcat(lastname, c_last_name_sections[x1]);
 }
+int lastname_to_no(const char* lastname)
+// Inverse of gen_rand_lastname (the syllables are prefix-free, so the decoding is unique)
+{
+    int x = 0;
+    for (int i = 0; i < 3; i++)
+    {
+        int j = 0;
+        for (; j < 10; j++)
+        {
+            size_t len = strlen(c_last_name_sections[j]);
+            if (strncmp(lastname, c_last_name_sections[j], len) == 0) { lastname += len; break; }
+        }
+        if (j == 10) return -1;
+        x = x * 10 + j;
+    }
+    return *lastname == 0 ? x : -1;
+}
 void gen_rand_datafield(char* data)
 // Used for generating I_DATA and S_DATA.
 // Random a-string [26 .. 50]. For 10% of the rows, selected at random,
@@ -75,25 +97,26 @@ void gen_rand_zip(char* zipcode)
     strcat(zipcode, "11111");
 }
 
-void init_db_population(const int n_warehouse)
+static void load_items(tpcc_loader_t* ld, int i_from, int i_to)
+// rows [i_from, i_to) of the ITEM table
 {
-    struct tm populated_time = cur_local_time(); 
-    tx_ctx_t* ctx = new(tx_ctx_t);
-    tx_ctx_init(ctx);
-    // FILE* debug_txt = fopen("db_population.txt", "w");  // debug
-    
     // ITEM table
-    for (int i = 0; i < 100000; i++)
+    for (int i = i_from; i < i_to; i++)
     {
-        item_t* c = new(item_t);
+        item_t c_row = {}, *c = &c_row;
         c -> i_id = i+1;
         c -> i_im_id = Random(1, 10000);
         gen_rand_astr(c -> i_name, 14, 24);
         c -> i_price = Random(100, 10000) / 100.0;
         gen_rand_datafield(c -> i_data);
-        Insert_item_trans(ctx, c);
+        Load_item(ld, c);
         // fprintf(debug_txt, "%d %d %f %s %s\n", c -> i_id, c -> i_im_id, c -> i_price, c -> i_name, c -> i_data);
     }
+}
+
+static void load_warehouse(tpcc_loader_t* ld, struct tm* populated_time, int w_id)
+// a WAREHOUSE row and its STOCK, DISTRICT, CUSTOMER, HISTORY, ORDER, ORDER-LINE and NEW-ORDER rows
+{
     /*
         Store or deletes tuples in each table as follows:
         (1) Create a globally unique key for each row of a table by concatenating
@@ -114,171 +137,296 @@ void init_db_population(const int n_warehouse)
          transaction_end()
     */
     
-    for (int i = 0; i < n_warehouse; i++)
+    warehouse_t w_row = {}, *w = &w_row;
+    w -> w_id = w_id;
+    gen_rand_astr(w -> w_name, 6, 10);
+    gen_rand_astr(w -> w_street_1, 10, 20);
+    gen_rand_astr(w -> w_street_2, 10, 20);
+    gen_rand_astr(w -> w_city, 10, 20);
+    gen_rand_astr(w -> w_state, 2, 2);
+    // ??? In the specification it says, w_state should be "random a-string of 2 letters",
+    //  while the definition of a-string includes digits and English letters. Contradictory?
+    gen_rand_zip(w -> w_zip);
+    w -> w_tax = Random(0, 2000) / 10000.0;
+    w -> w_ytd = 300000.0;
+    Load_warehouse(ld, w);
+    // fprintf(debug_txt, "%d %f %f %s %s %s\n", w -> w_id, w -> w_tax, w -> w_ytd, w -> w_name, w -> w_street_1, w -> w_street_2);
+    // fprintf(debug_txt, "%s %s %s\n", w -> w_state, w -> w_zip, w -> w_city);
+    
+    // For each row in the WAREHOUSE table: 
+    for (int j = 0; j < 100000; j++)
     {
-        warehouse_t* w = new(warehouse_t);
-        w -> w_id = i+1;
-        gen_rand_astr(w -> w_name, 6, 10);
-        gen_rand_astr(w -> w_street_1, 10, 20);
-        gen_rand_astr(w -> w_street_2, 10, 20);
-        gen_rand_astr(w -> w_city, 10, 20);
-        gen_rand_astr(w -> w_state, 2, 2);
-        // ??? In the specification it says, w_state should be "random a-string of 2 letters",
-        //  while the definition of a-string includes digits and English letters. Contradictory?
-        gen_rand_zip(w -> w_zip);
-        w -> w_tax = Random(0, 2000) / 10000.0;
-        w -> w_ytd = 300000.0;
-        Insert_warehouse_trans(ctx, w);
-        // fprintf(debug_txt, "%d %f %f %s %s %s\n", w -> w_id, w -> w_tax, w -> w_ytd, w -> w_name, w -> w_street_1, w -> w_street_2);
-        // fprintf(debug_txt, "%s %s %s\n", w -> w_state, w -> w_zip, w -> w_city);
-        
-        // For each row in the WAREHOUSE table: 
-        for (int j = 0; j < 100000; j++)
+        stock_t s_row = {}, *s = &s_row;
+        s -> s_i_id = j+1;
+        s -> s_w_id = w -> w_id;
+        s -> s_quantity = Random(10, 100);
+        for (int k = 0; k < 10; k++) gen_rand_astr(s -> s_dist[k], 24, 24);
+        s -> s_ytd = 0;
+        s -> s_order_cnt = 0;
+        s -> s_remote_cnt = 0;
+        gen_rand_datafield(s -> s_data);
+        Load_stock(ld, s);
+        // fprintf(debug_txt, "%d %d %d\n", s -> s_w_id, s -> s_i_id, s -> s_quantity);
+        // fprintf(debug_txt, "%d %d %d\n", s -> s_ytd, s -> s_order_cnt, s -> s_remote_cnt);
+        // for (int k = 0; k < 10; k++) fprintf(debug_txt, "%s\n", s -> s_dist[k]);
+        // fprintf(debug_txt, "%s\n", s -> s_data);
+    }
+    
+    for (int j = 0; j < 10; j++)
+    {
+        district_t d_row = {}, *d = &d_row;
+        d -> d_id = j+1;
+        d -> d_w_id = w -> w_id;
+        gen_rand_astr(d -> d_name, 6, 10);
+        gen_rand_astr(d -> d_street_1, 10, 20);
+        gen_rand_astr(d -> d_street_2, 10, 20);
+        gen_rand_astr(d -> d_city, 10, 20);
+        gen_rand_astr(d -> d_state, 2, 2);
+        gen_rand_zip(d -> d_zip);
+        d -> d_tax = Random(0, 2000) / 10000.0;
+        d -> d_ytd = 30000.00;
+        d -> d_next_o_id = 3001;
+        d -> d_o_id_seq = tx_seq_create(d -> d_next_o_id);
+        Load_district(ld, d);
+        // fprintf(debug_txt, "%d %d %f %f %d\n", d -> d_id, d -> d_w_id, d -> d_tax, d -> d_ytd, d -> d_next_o_id);
+        // Test of d_name, d_city, etc are similar to w_name, w_city, so omitted.
+
+        // For each row in the DISTRICT table:
+        for (int k = 0; k < 3000; k++)
         {
-            stock_t* s = new(stock_t);
-            s -> s_i_id = j+1;
-            s -> s_w_id = w -> w_id;
-            s -> s_quantity = Random(10, 100);
-            for (int k = 0; k < 10; k++) gen_rand_astr(s -> s_dist[k], 24, 24);
-            s -> s_ytd = 0;
-            s -> s_order_cnt = 0;
-            s -> s_remote_cnt = 0;
-            gen_rand_datafield(s -> s_data);
-            Insert_stock_trans(ctx, s);
-            // fprintf(debug_txt, "%d %d %d\n", s -> s_w_id, s -> s_i_id, s -> s_quantity);
-            // fprintf(debug_txt, "%d %d %d\n", s -> s_ytd, s -> s_order_cnt, s -> s_remote_cnt);
-            // for (int k = 0; k < 10; k++) fprintf(debug_txt, "%s\n", s -> s_dist[k]);
-            // fprintf(debug_txt, "%s\n", s -> s_data);
+            customer_t c_row = {}, *c = &c_row;
+            c -> c_id = k+1;
+            c -> c_d_id = d -> d_id;
+            c -> c_w_id = d -> d_w_id;
+            gen_rand_lastname(c -> c_last, k < 1000 ? k : -1);
+                // Iterating through the range of [0 .. 999] for the first 1,000 customers,
+                //  and generating a non-uniform random number using the function
+                //  NURand(255,0,999) for each of the remaining 2,000 customers. The
+                //  run-time constant C used for the database population
+                //  must be randomly chosen independently from the test run(s).
+            strcpy(c -> c_middle, "OE");
+            gen_rand_astr(c -> c_first, 8, 16);
+            gen_rand_astr(c -> c_street_1, 10, 20);
+            gen_rand_astr(c -> c_street_2, 10, 20);
+            gen_rand_astr(c -> c_city, 10, 20);
+            gen_rand_astr(c -> c_state, 2, 2);
+            gen_rand_zip(c -> c_zip);
+            gen_rand_nstr(c -> c_phone, 16);
+            c -> c_since = populated_time;
+                // C_SINCE date/time given by the operating system when
+                //  the CUSTOMER table was populated.
+            strcpy(c -> c_credit, Random(1, 10) > 1 ? "GC" : "BC");
+                // C_CREDIT = "GC". For 10% of the rows, selected at random, C_CREDIT = "BC"
+            c -> c_credit_lim = 50000.00;
+            c -> c_discount = Random(0, 5000) / 10000.0;
+            c -> c_balance = -10.00;
+            c -> c_ytd_payment = 10.00;
+            c -> c_payment_cnt = 1;
+            c -> c_delivery_cnt = 0;
+            gen_rand_astr(c -> c_data, 300, 500);
+            Load_customer(ld, c);
+            // Test of c_street_1, c_city, c_state, etc are similar to above, so omitted.
+            // fprintf(debug_txt, "%d %d %d %s\n", c->c_id, c->c_d_id, c->c_w_id, c->c_middle);
+            // fprintf(debug_txt, "%s %s %f\n", c->c_phone, c->c_credit, c->c_credit_lim);
+            // fprintf(debug_txt, "%s", asctime(c->c_since));
+            // fprintf(debug_txt, "%f %f %f %d %d\n", c->c_discount, c->c_balance, c->c_ytd_payment, c->c_payment_cnt, c->c_delivery_cnt);
+            // fprintf(debug_txt, "%d %s\n", c->c_id, c->c_last);
+            
+            // For each row in the CUSTOMER table, 1 row in the HISTORY table with:
+            history_t h_row = {}, *h = &h_row;
+            h -> h_c_id = c -> c_id;
+            h -> h_c_d_id = h -> h_d_id = d -> d_id;
+            h -> h_c_w_id = h -> h_w_id = w -> w_id;
+            h -> h_date = populated_time;
+            h -> h_amount = 10.00;
+            gen_rand_astr(h -> h_data, 12, 24);
+            Load_history(ld, h);
+            // fprintf(debug_txt, "%d %d %d %d %d %f %s\n", h->h_c_id, h->h_c_d_id, h->h_d_id, h->h_c_w_id, h->h_w_id, h->h_amount, h->h_data);
+            // fprintf(debug_txt, "%s", asctime(h->h_date));
         }
         
-        for (int j = 0; j < 10; j++)
+        // ORDER table
+        int perm[3000];
+        initialize_and_permute_random(perm, 3000);
+        for (int k = 0; k < 3000; k++)
         {
-            district_t* d = new(district_t);
-            d -> d_id = j+1;
-            d -> d_w_id = w -> w_id;
-            gen_rand_astr(d -> d_name, 6, 10);
-            gen_rand_astr(d -> d_street_1, 10, 20);
-            gen_rand_astr(d -> d_street_2, 10, 20);
-            gen_rand_astr(d -> d_city, 10, 20);
-            gen_rand_astr(d -> d_state, 2, 2);
-            gen_rand_zip(d -> d_zip);
-            d -> d_tax = Random(0, 2000) / 10000.0;
-            d -> d_ytd = 30000.00;
-            d -> d_next_o_id = 3001;
-            Insert_district_trans(ctx, d);
-            // fprintf(debug_txt, "%d %d %f %f %d\n", d -> d_id, d -> d_w_id, d -> d_tax, d -> d_ytd, d -> d_next_o_id);
-            // Test of d_name, d_city, etc are similar to w_name, w_city, so omitted.
-
-            // For each row in the DISTRICT table:
-            for (int k = 0; k < 3000; k++)
-            {
-                customer_t* c = new(customer_t);
-                c -> c_id = k+1;
-                c -> c_d_id = d -> d_id;
-                c -> c_w_id = d -> d_w_id;
-                gen_rand_lastname(c -> c_last, k < 1000 ? k : -1);
-                    // Iterating through the range of [0 .. 999] for the first 1,000 customers,
-                    //  and generating a non-uniform random number using the function
-                    //  NURand(255,0,999) for each of the remaining 2,000 customers. The
-                    //  run-time constant C used for the database population
-                    //  must be randomly chosen independently from the test run(s).
-                strcpy(c -> c_middle, "OE");
-                gen_rand_astr(c -> c_first, 8, 16);
-                gen_rand_astr(c -> c_street_1, 10, 20);
-                gen_rand_astr(c -> c_street_2, 10, 20);
-                gen_rand_astr(c -> c_city, 10, 20);
-                gen_rand_astr(c -> c_state, 2, 2);
-                gen_rand_zip(c -> c_zip);
-                gen_rand_nstr(c -> c_phone, 16);
-                c -> c_since = new(struct tm);
-                *(c -> c_since) = populated_time;
-                    // C_SINCE date/time given by the operating system when
-                    //  the CUSTOMER table was populated.
-                strcpy(c -> c_credit, Random(1, 10) > 1 ? "GC" : "BC");
-                    // C_CREDIT = "GC". For 10% of the rows, selected at random, C_CREDIT = "BC"
-                c -> c_credit_lim = 50000.00;
-                c -> c_discount = Random(0, 5000) / 10000.0;
-                c -> c_balance = -10.00;
-                c -> c_ytd_payment = 10.00;
-                c -> c_payment_cnt = 1;
-                c -> c_delivery_cnt = 0;
-                gen_rand_astr(c -> c_data, 300, 500);
-                Insert_customer_trans(ctx, c);
-                // Test of c_street_1, c_city, c_state, etc are similar to above, so omitted.
-                // fprintf(debug_txt, "%d %d %d %s\n", c->c_id, c->c_d_id, c->c_w_id, c->c_middle);
-                // fprintf(debug_txt, "%s %s %f\n", c->c_phone, c->c_credit, c->c_credit_lim);
-                // fprintf(debug_txt, "%s", asctime(c->c_since));
-                // fprintf(debug_txt, "%f %f %f %d %d\n", c->c_discount, c->c_balance, c->c_ytd_payment, c->c_payment_cnt, c->c_delivery_cnt);
-                // fprintf(debug_txt, "%d %s\n", c->c_id, c->c_last);
-                
-                // For each row in the CUSTOMER table, 1 row in the HISTORY table with:
-                history_t* h = new(history_t);
-                h -> h_c_id = c -> c_id;
-                h -> h_c_d_id = h -> h_d_id = d -> d_id;
-                h -> h_c_w_id = h -> h_w_id = w -> w_id;
-                h -> h_date = new(struct tm); *(h -> h_date) = cur_local_time();
-                h -> h_amount = 10.00;
-                gen_rand_astr(h -> h_data, 12, 24);
-                Insert_history_trans(ctx, h);
-                // fprintf(debug_txt, "%d %d %d %d %d %f %s\n", h->h_c_id, h->h_c_d_id, h->h_d_id, h->h_c_w_id, h->h_w_id, h->h_amount, h->h_data);
-                // fprintf(debug_txt, "%s", asctime(h->h_date));
-            }
-            
-            // ORDER table
-            int perm[3000];
-            initialize_and_permute_random(perm, 3000);
-            for (int k = 0; k < 3000; k++)
-            {
-                order_t* o = new(order_t);
-                o -> o_id = k+1;
-                o -> o_c_id = perm[k];
-                    // O_C_ID selected sequentially from a random permutation of [1 .. 3,000]
-                o -> o_d_id = d -> d_id;
-                o -> o_w_id = w -> w_id;
-                o -> o_entry_d = new(struct tm); *(o -> o_entry_d) = cur_local_time();
-                o -> o_carrier_id = o -> o_id < 2101 ? Random(1, 10) : -1;
-                o -> o_ol_cnt = Random(5, 15);
-                o -> o_all_local = 1;
-                Insert_order_trans(ctx, o);
-                // fprintf(debug_txt, "%d %d %d %d %d %d %d\n", o->o_id, o->o_d_id, o->o_w_id, o->o_carrier_id, o->o_ol_cnt, o->o_all_local, o->o_c_id);
-                // fprintf(debug_txt, "%s", asctime(o->o_entry_d));
-                
-                for (int p = 0; p < o -> o_ol_cnt; p++)
-                {
-                    orderline_t* ol = new(orderline_t);
-                    ol -> ol_o_id = o -> o_id;
-                    ol -> ol_d_id = d -> d_id;
-                    ol -> ol_w_id = w -> w_id;
-                    ol -> ol_number = p+1;
-                    ol -> ol_i_id = Random(1, 100000);
-                    ol -> ol_supply_w_id = w -> w_id;
-                    if (ol -> ol_o_id < 2101) { ol -> ol_delivery_d = new(struct tm); *(ol -> ol_delivery_d) = *(o -> o_entry_d); }
-                    else ol -> ol_delivery_d = NULL;
-                    ol -> ol_quantity = 5;
-                    ol -> ol_amount = ol -> ol_o_id < 2101 ? 0.00 : Random(1, 999999) / 100.0;
-                    gen_rand_astr(ol -> ol_dist_info, 24, 24);
-                    Insert_orderline_trans(ctx, ol);
-                    // fprintf(debug_txt, "%d %d %d %d %d %d %d\n", ol->ol_o_id, ol->ol_d_id, ol->ol_w_id, ol->ol_supply_w_id, ol->ol_number, ol->ol_i_id, ol->ol_quantity);
-                    // fprintf(debug_txt, "%d %f\n", ol->ol_o_id, ol->ol_amount);
-                    // fprintf(debug_txt, "%s\n", ol->ol_dist_info);
-                    // fprintf(debug_txt, "%d %s", ol->ol_o_id, ol->ol_delivery_d == NULL ? "NULL\n" : asctime(ol->ol_delivery_d));
-                }
-            }
+            order_t o_row = {}, *o = &o_row;
+            o -> o_id = k+1;
+            o -> o_c_id = perm[k];
+                // O_C_ID selected sequentially from a random permutation of [1 .. 3,000]
+            o -> o_d_id = d -> d_id;
+            o -> o_w_id = w -> w_id;
+            o -> o_entry_d = populated_time;
+            o -> o_carrier_id = o -> o_id < 2101 ? Random(1, 10) : -1;
+            o -> o_ol_cnt = Random(5, 15);
+            o -> o_all_local = 1;
+            Load_order(ld, o);
+            // fprintf(debug_txt, "%d %d %d %d %d %d %d\n", o->o_id, o->o_d_id, o->o_w_id, o->o_carrier_id, o->o_ol_cnt, o->o_all_local, o->o_c_id);
+            // fprintf(debug_txt, "%s", asctime(o->o_entry_d));
             
-            for (int k = 0; k < 900; k++)
+            for (int p = 0; p < o -> o_ol_cnt; p++)
             {
-                neworder_t* no = new(neworder_t);
-                no -> no_o_id = k + 2101;
-                    // 900 rows in the NEW-ORDER table corresponding to the last 900 rows in the ORDER table
-                    //  for that district with NO_O_ID = O_ID (i.e., with NO_O_ID between 2,101 and 3,000)
-                no -> no_d_id = d -> d_id;
-                no -> no_w_id = w -> w_id;
-                Insert_neworder_trans(ctx, no);
-                // fprintf(debug_txt, "%d %d %d\n", no->no_o_id, no->no_d_id, no->no_w_id);
+                orderline_t ol_row = {}, *ol = &ol_row;
+                ol -> ol_o_id = o -> o_id;
+                ol -> ol_d_id = d -> d_id;
+                ol -> ol_w_id = w -> w_id;
+                ol -> ol_number = p+1;
+                ol -> ol_i_id = Random(1, 100000);
+                ol -> ol_supply_w_id = w -> w_id;
+                if (ol -> ol_o_id < 2101) ol -> ol_delivery_d = o -> o_entry_d;
+                else ol -> ol_delivery_d = NULL;
+                ol -> ol_quantity = 5;
+                ol -> ol_amount = ol -> ol_o_id < 2101 ? 0.00 : Random(1, 999999) / 100.0;
+                gen_rand_astr(ol -> ol_dist_info, 24, 24);
+                Load_orderline(ld, ol);
+                // fprintf(debug_txt, "%d %d %d %d %d %d %d\n", ol->ol_o_id, ol->ol_d_id, ol->ol_w_id, ol->ol_supply_w_id, ol->ol_number, ol->ol_i_id, ol->ol_quantity);
+                // fprintf(debug_txt, "%d %f\n", ol->ol_o_id, ol->ol_amount);
+                // fprintf(debug_txt, "%s\n", ol->ol_dist_info);
+                // fprintf(debug_txt, "%d %s", ol->ol_o_id, ol->ol_delivery_d == NULL ? "NULL\n" : asctime(ol->ol_delivery_d));
             }
         }
+        
+        for (int k = 0; k < 900; k++)
+        {
+            neworder_t no_row = {}, *no = &no_row;
+            no -> no_o_id = k + 2101;
+                // 900 rows in the NEW-ORDER table corresponding to the last 900 rows in the ORDER table
+                //  for that district with NO_O_ID = O_ID (i.e., with NO_O_ID between 2,101 and 3,000)
+            no -> no_d_id = d -> d_id;
+            no -> no_w_id = w -> w_id;
+            Load_neworder(ld, no);
+            // fprintf(debug_txt, "%d %d %d\n", no->no_o_id, no->no_d_id, no->no_w_id);
+        }
+    }
+}
+
+typedef struct
+{
+    tpcc_loader_t ld;
+    int thread_id;
+    int n_threads;
+    int n_warehouse;
+    struct tm* populated_time;
+} tpcc_load_thread_t;
+
+static void* load_thread(void* arg)
+{
+    tpcc_load_thread_t* t = (tpcc_load_thread_t *) arg;
+    tpcc_srand(time(NULL) ^ ((uint64_t) t->thread_id << 32));
+
+    load_items(&t->ld, 100000 * t->thread_id / t->n_threads, 100000 * (t->thread_id + 1) / t->n_threads);
+    for (int w_id = t->thread_id + 1; w_id <= t->n_warehouse; w_id += t->n_threads)
+        load_warehouse(&t->ld, t->populated_time, w_id);
+    return NULL;
+}
+
+uint64_t init_db_population(const tx_kvs_ops_t* kvs_ops, void* kvs, const int n_warehouse, const int n_threads)
+{
+    // C_SINCE, H_DATE, O_ENTRY_D and OL_DELIVERY_D of all the populated rows (shared, never freed)
+    struct tm* populated_time = new(struct tm); *populated_time = cur_local_time();
+    // FILE* debug_txt = fopen("db_population.txt", "w");  // debug
+
+    pthread_t threads[n_threads];
+    tpcc_load_thread_t* loaders = calloc(n_threads, sizeof(tpcc_load_thread_t));
+    for (int i = 0; i < n_threads; i++)
+    {
+        loaders[i] = (tpcc_load_thread_t) { { kvs_ops, kvs, 0 }, i, n_threads, n_warehouse, populated_time };
+        pthread_create(&threads[i], NULL, load_thread, &loaders[i]);
+    }
+    uint64_t n_rows = 0;
+    for (int i = 0; i < n_threads; i++)
+    {
+        pthread_join(threads[i], NULL);
+        n_rows += loaders[i].ld.n_rows;
     }
+    free(loaders);
 
     // fclose(debug_txt);
-    tx_ctx_destroy(ctx);
+    return n_rows;
+}
+
+// Store of an unordered point backend (see tpcc_kvs_create): routes every op by the table tag of its key
+
+static inline uint8_t tpcc_kvs_is_ordered(void* key_ptr)
+{
+    uint8_t tag = *(uint8_t *) key_ptr;
+    return tag == TPCC_TAG_C2 || tag == TPCC_TAG_O2 || tag == TPCC_TAG_NEWORDER || tag == TPCC_TAG_ORDERLINE;
+}
+#define TPCC_KVS_ROUTE(kvs, key_ptr, op, ...) \
+    (tpcc_kvs_is_ordered(key_ptr) ? tx_kvs_skiplist_ops.op(((tpcc_kvs_t *) (kvs))->ordered, key_ptr, __VA_ARGS__) \
+                                  : ((tpcc_kvs_t *) (kvs))->point_ops->op(((tpcc_kvs_t *) (kvs))->point, key_ptr, __VA_ARGS__))
+
+void* tpcc_kvs_create(const tx_kvs_ops_t* point_ops, uint64_t max_keys)
+{
+    if (point_ops->scan != NULL) return point_ops->create(max_keys);  // (an ordered backend stores every table)
+    // (objs of both backends are locked / validated by the same op of the ctx)
+    assert(point_ops->lock == NULL && point_ops->unlock == NULL && point_ops->validate == NULL);
+    tpcc_kvs_t* kvs = malloc(sizeof(tpcc_kvs_t));
+    kvs->point_ops = point_ops;
+    kvs->point = point_ops->create(max_keys);
+    kvs->ordered = tx_kvs_skiplist_ops.create(max_keys);
+    return kvs;
+}
+
+static void tpcc_kvs_destroy(void* kvs)
+{
+    tpcc_kvs_t* t = (tpcc_kvs_t *) kvs;
+    t->point_ops->destroy(t->point);
+    tx_kvs_skiplist_ops.destroy(t->ordered);
+    free(t);
+}
+
+static tx_internal_obj_val_t* tpcc_kvs_get(void* kvs, void* key_ptr, uint32_t key_len)
+{
+    return TPCC_KVS_ROUTE(kvs, key_ptr, get, key_len);
+}
+
+static tx_internal_obj_val_t* tpcc_kvs_insert(void* kvs, void* key_ptr, uint32_t key_len,
+                                              uint32_t alloc_len, uint32_t unique_alloc_id)
+{
+    return TPCC_KVS_ROUTE(kvs, key_ptr, insert, key_len, alloc_len, unique_alloc_id);
+}
+
+static int tpcc_kvs_put(void* kvs, void* key_ptr, uint32_t key_len, void* val_ptr, uint32_t val_len)
+{
+    return TPCC_KVS_ROUTE(kvs, key_ptr, put, key_len, val_ptr, val_len);
+}
+
+static int tpcc_kvs_del(void* kvs, void* key_ptr, uint32_t key_len)
+{
+    return TPCC_KVS_ROUTE(kvs, key_ptr, del, key_len);
+}
+
+static int tpcc_kvs_scan(void* kvs, void* from_key, uint32_t from_len, void* to_key, uint32_t to_len,
+                         tx_kvs_scan_cb cb, void* cb_arg)
+{
+    // (ranges never span tables)
+    assert(tpcc_kvs_is_ordered(from_key));
+    return tx_kvs_skiplist_ops.scan(((tpcc_kvs_t *) kvs)->ordered, from_key, from_len, to_key, to_len, cb, cb_arg);
+}
+
+static void tpcc_kvs_prefetch(void* kvs, void* key_ptr, uint32_t key_len)
+{
+    tpcc_kvs_t* t = (tpcc_kvs_t *) kvs;
+    if (!tpcc_kvs_is_ordered(key_ptr) && t->point_ops->prefetch != NULL) t->point_ops->prefetch(t->point, key_ptr, key_len);
+}
+
+const tx_kvs_ops_t tpcc_kvs_ops = {
+    .name     = "tpcc",
+    .create   = NULL,  // (see tpcc_kvs_create)
+    .destroy  = tpcc_kvs_destroy,
+    .get      = tpcc_kvs_get,
+    .insert   = tpcc_kvs_insert,
+    .put      = tpcc_kvs_put,
+    .del      = tpcc_kvs_del,
+    .lock     = NULL,
+    .unlock   = NULL,
+    .validate = NULL,
+    .scan     = tpcc_kvs_scan,
+    .prefetch = tpcc_kvs_prefetch,
+};
+
+const tx_kvs_ops_t* tpcc_kvs_ops_of(const tx_kvs_ops_t* point_ops)
+{
+    return point_ops->scan != NULL ? point_ops : &tpcc_kvs_ops;
 }
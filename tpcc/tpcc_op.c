@@ -1,302 +1,422 @@
 #include "tx_shim.h"
+#include "tx_shim_slab.h"
 #include "tpcc.h"
 #include <stdio.h>
-#define new(T) malloc(sizeof(T))
+#define new(T) tx_slab_alloc(sizeof(T))  // rows are 64B-aligned w/o the malloc lock
 
-const int prikey_len_warehouse = 11;  // With 1 bit padding  // ??? scale of W?
-const int prikey_len_district  = 14;
-const int prikey_len_customer  = 19;
-const int prikey_len_item      = 8;
-const int prikey_len_order     = 19;
-const int prikey_len_orderline = 23;
-const int prikey_len_stock     = 19;
-const int prikey_len_neworder  = 20;
-const int prikey_len_history   = 19;
-const int prikey_len_c2        = 31;
-const int prikey_len_o2        = 20;
-const int prikey_len_no2       = 16;
+// tables by tag w/ the names and widths (in bytes) of the ids of their keys (see Get_prikey_*)
+static const struct
+{
+    const char* table;
+    uint8_t num_ids;
+    const char* ids[4];
+    uint8_t widths[4];
+} tpcc_key_desc[] = {
+    [TPCC_TAG_WAREHOUSE] = { "warehouse", 1, { "w" },                     { 4 } },
+    [TPCC_TAG_DISTRICT]  = { "district",  2, { "w", "d" },                { 4, 1 } },
+    [TPCC_TAG_CUSTOMER]  = { "customer",  3, { "w", "d", "c" },           { 4, 1, 4 } },
+    [TPCC_TAG_ITEM]      = { "item",      1, { "i" },                     { 4 } },
+    [TPCC_TAG_ORDER]     = { "order",     3, { "w", "d", "o" },           { 4, 1, 4 } },
+    [TPCC_TAG_ORDERLINE] = { "orderline", 4, { "w", "d", "o", "ol" },     { 4, 1, 4, 1 } },
+    [TPCC_TAG_STOCK]     = { "stock",     2, { "w", "i" },                { 4, 4 } },
+    [TPCC_TAG_NEWORDER]  = { "neworder",  3, { "w", "d", "o" },           { 4, 1, 4 } },
+    [TPCC_TAG_HISTORY]   = { "history",   3, { "w", "d", "c" },           { 4, 1, 4 } },
+    [TPCC_TAG_C2]        = { "c2",        4, { "w", "d", "last", "c" },   { 4, 1, 2, 4 } },
+    [TPCC_TAG_O2]        = { "o2",        4, { "w", "d", "c", "o" },      { 4, 1, 4, 4 } },
+};
 
-inline void Insert(tx_trans_t* trans, char* key, void* val)
+int tpcc_key_str(const uint8_t* key, uint32_t key_len, char* out, uint32_t out_len)
 {
-    tx_trans_kv_set(trans, key, strlen(key), val, sizeof(val));
+    int n_tags = sizeof(tpcc_key_desc) / sizeof(tpcc_key_desc[0]);
+    if (key_len == 0 || key[0] == 0 || key[0] >= n_tags) return snprintf(out, out_len, "?(%u bytes)", key_len);
+
+    int len = snprintf(out, out_len, "%s(", tpcc_key_desc[key[0]].table);
+    const uint8_t* p = key + 1;
+    for (int i = 0; i < tpcc_key_desc[key[0]].num_ids; i++)  // (range start keys may have only a prefix of the ids)
+    {
+        int width = tpcc_key_desc[key[0]].widths[i];
+        if (p + width > key + key_len) break;
+        uint32_t id = 0;
+        for (int b = 0; b < width; b++) id = (id << 8) | *p++;
+        int at = len < (int) out_len ? len : (int) out_len;  // (truncated)
+        len += snprintf(out + at, out_len - at, "%s%s=%u", i > 0 ? "," : "", tpcc_key_desc[key[0]].ids[i], id);
+    }
+    int at = len < (int) out_len ? len : (int) out_len;
+    return len + snprintf(out + at, out_len - at, ")");
 }
-inline void Select(tx_trans_t* trans, char* key, void** val)
+
+void Select_warehouse(tx_trans_t* trans, int w_id, warehouse_t** w)
 {
-    tx_trans_kv_get(trans, key, strlen(key), val);
+    tpcc_key_t w_pri_key;
+    Get_prikey_warehouse(&w_pri_key, w_id);
+    Select(trans, &w_pri_key, (void**)w);
 }
-inline void Delete(tx_trans_t* trans, char* key)
+void Select_district(tx_trans_t* trans, int d_w_id, int d_id, district_t** d)
 {
-    tx_trans_kv_del(trans, key, sizeof(key));
+    tpcc_key_t d_pri_key;
+    Get_prikey_district(&d_pri_key, d_w_id, d_id);
+    Select(trans, &d_pri_key, (void**)d);
 }
-
-inline void Get_prikey_warehouse(char* pri_key, int w_id)
+void Select_customer(tx_trans_t* trans, int c_w_id, int c_d_id, int c_id, customer_t** c)
 {
-    sprintf(pri_key, "w%d", w_id);
+    tpcc_key_t c_pri_key;
+    Get_prikey_customer(&c_pri_key, c_w_id, c_d_id, c_id);
+    Select(trans, &c_pri_key, (void**)c);
 }
-inline void Get_prikey_district(char* pri_key, int d_w_id, int d_id)
+void Select_item(tx_trans_t* trans, int i_id, item_t** i)
 {
-    sprintf(pri_key, "d%d,%d", d_w_id, d_id);
+    tpcc_key_t i_pri_key;
+    Get_prikey_item(&i_pri_key, i_id);
+    Select(trans, &i_pri_key, (void**)i);
 }
-inline void Get_prikey_customer(char* pri_key, int c_w_id, int c_d_id, int c_id)
+int Select_items(tx_trans_t* trans, const int* i_ids, int n_items, item_t** i)
 {
-    sprintf(pri_key, "c%d,%d,%d", c_w_id, c_d_id, c_id);
+    tpcc_key_t i_pri_keys[n_items];
+    tx_trans_kv_get_t gets[n_items];
+    for (int k = 0; k < n_items; k++)
+    {
+        Get_prikey_item(&i_pri_keys[k], i_ids[k]);
+        gets[k] = (tx_trans_kv_get_t) { .key_ptr = i_pri_keys[k].bytes, .key_len = i_pri_keys[k].len };
+    }
+    int n_found = tx_trans_kv_multi_get(trans, gets, n_items);
+    for (int k = 0; k < n_items; k++) i[k] = (item_t*) gets[k].value_ptr;
+    return n_found;
 }
-inline void Get_prikey_item(char* pri_key, int i_id)
+void Select_order(tx_trans_t* trans, int o_w_id, int o_d_id, int o_id, order_t** o)
 {
-    sprintf(pri_key, "i%d", i_id);
+    tpcc_key_t o_pri_key;
+    Get_prikey_order(&o_pri_key, o_w_id, o_d_id, o_id);
+    Select(trans, &o_pri_key, (void**)o);
 }
-inline void Get_prikey_order(char* pri_key, int o_w_id, int o_d_id, int o_id)
+void Select_orderline(tx_trans_t* trans, int ol_w_id, int ol_d_id, int ol_o_id, int ol_number, orderline_t** ol)
 {
-    sprintf(pri_key, "o%d,%d,%d", o_w_id, o_d_id, o_id);
+    tpcc_key_t ol_pri_key;
+    Get_prikey_orderline(&ol_pri_key, ol_w_id, ol_d_id, ol_o_id, ol_number);
+    Select(trans, &ol_pri_key, (void**)ol);
 }
-inline void Get_prikey_orderline(char* pri_key, int ol_w_id, int ol_d_id, int ol_o_id, int ol_number)
+void Select_stock(tx_trans_t* trans, int s_w_id, int s_i_id, stock_t** s)
 {
-    sprintf(pri_key, "ol%d,%d,%d,%d", ol_w_id, ol_d_id, ol_o_id, ol_number);
+    tpcc_key_t s_pri_key;
+    Get_prikey_stock(&s_pri_key, s_w_id, s_i_id);
+    Select(trans, &s_pri_key, (void**)s);
 }
-inline void Get_prikey_stock(char* pri_key, int s_w_id, int s_i_id)
+void Select_neworder(tx_trans_t* trans, int no_w_id, int no_d_id, int no_o_id, neworder_t** no)
 {
-    sprintf(pri_key, "s%d,%d", s_w_id, s_i_id);
+    tpcc_key_t no_pri_key;
+    Get_prikey_neworder(&no_pri_key, no_w_id, no_d_id, no_o_id);
+    Select(trans, &no_pri_key, (void**)no);
 }
-inline void Get_prikey_neworder(char* pri_key, int no_w_id, int no_d_id, int no_o_id)
+void Select_history(tx_trans_t* trans, int h_w_id, int h_d_id, int h_c_id, history_t** h)
 {
-    sprintf(pri_key, "no%d,%d,%d", no_w_id, no_d_id, no_o_id);
+    tpcc_key_t h_pri_key;
+    Get_prikey_history(&h_pri_key, h_w_id, h_d_id, h_c_id);
+    Select(trans, &h_pri_key, (void**)h);
 }
-inline void Get_prikey_history(char* pri_key, int h_w_id, int h_d_id, int h_c_id)
+typedef struct
 {
-    sprintf(pri_key, "h%d,%d,%d", h_w_id, h_d_id, h_c_id);
+    void** rows;
+    int n;
+} scan_rows_t;
+static int scan_collect_rows(void* key_ptr, uint32_t key_len, void* val_ptr, uint32_t val_len, void* arg)
+{
+    (void) key_ptr; (void) key_len; (void) val_len;
+    scan_rows_t* rows = arg;
+    rows->rows[rows->n++] = val_ptr;
+    return 0;
 }
-inline void Get_prikey_c2(char* pri_key, int c_w_id, int c_d_id, char* c_last)
+static int cmp_customer_by_first(const void* a, const void* b)
 {
-    sprintf(pri_key, "cl%d,%d,%s", c_w_id, c_d_id, c_last);
-    // cannot use 'c2' here because the '2' could be interpreted as part of c_w_id
+    return strcmp((*(customer_by_name_t**)a)->c_first, (*(customer_by_name_t**)b)->c_first);
 }
-inline void Get_prikey_o2(char* pri_key, int o_w_id, int o_d_id, int o_c_id)
+#define MAX_CUSTOMERS_PER_NAME 64
+int Select_customer_id_byname(tx_trans_t* trans, int c_w_id, int c_d_id, char* c_last)
 {
-    sprintf(pri_key, "ol%d,%d,%d", o_w_id, o_d_id, o_c_id);
+    int c_last_no = lastname_to_no(c_last);
+    tpcc_key_t from, to;
+    Get_prikey_c2(&from, c_w_id, c_d_id, c_last_no, 0);
+    Get_prikey_c2(&to, c_w_id, c_d_id, c_last_no + 1, 0);
+
+    customer_by_name_t* matches[MAX_CUSTOMERS_PER_NAME];
+    scan_rows_t rows = { (void**)matches, 0 };
+    if (c_last_no < 0 || Scan(trans, &from, &to, MAX_CUSTOMERS_PER_NAME, scan_collect_rows, &rows) <= 0) return -1;
+
+    // the customer at position n/2 (rounded up) of the matches sorted by C_FIRST
+    qsort(matches, rows.n, sizeof(matches[0]), cmp_customer_by_first);
+    return matches[(rows.n - 1) / 2]->c_id;
 }
-inline void Get_prikey_no2(char* pri_key, int no_w_id, int no_d_id)
+void Select_customer_byname(tx_trans_t* trans, int c_w_id, int c_d_id, char* c_last, customer_t** c)
 {
-    sprintf(pri_key, "nol%d,%d", no_w_id, no_d_id);
+    int c_id = Select_customer_id_byname(trans, c_w_id, c_d_id, c_last);
+    *c = NULL;
+    if (c_id >= 0) Select_customer(trans, c_w_id, c_d_id, c_id, c);
 }
-
-void Select_warehouse(tx_trans_t* trans, int w_id, warehouse_t** w)
+static int scan_keep_last_int(void* key_ptr, uint32_t key_len, void* val_ptr, uint32_t val_len, void* arg)
 {
-    char w_pri_key[prikey_len_warehouse];
-    Get_prikey_warehouse(w_pri_key, w_id);
-    Select(trans, w_pri_key, (void**)w);
+    (void) key_ptr; (void) key_len; (void) val_len;
+    memcpy(arg, val_ptr, sizeof(int)); // (val not aligned)
+    return 0;
 }
-void Select_district(tx_trans_t* trans, int d_w_id, int d_id, district_t** d)
+void Select_latest_order(tx_trans_t* trans, int o_w_id, int o_d_id, int o_c_id, order_t** o)
 {
-    char d_pri_key[prikey_len_district];
-    Get_prikey_district(d_pri_key, d_w_id, d_id);
-    Select(trans, d_pri_key, (void**)d);
+    tpcc_key_t from, to;
+    Get_prikey_o2(&from, o_w_id, o_d_id, o_c_id, 0);
+    Get_prikey_o2(&to, o_w_id, o_d_id, o_c_id + 1, 0);
+    int largest_o_id = -1;  // o2 entries of a customer are ordered by o_id
+    Scan(trans, &from, &to, 0, scan_keep_last_int, &largest_o_id);
+    *o = NULL;
+    if (largest_o_id >= 0) Select_order(trans, o_w_id, o_d_id, largest_o_id, o);
 }
-void Select_customer(tx_trans_t* trans, int c_w_id, int c_d_id, int c_id, customer_t** c)
+void Select_undelivered_neworder(tx_trans_t* trans, int no_w_id, int no_d_id, neworder_t** no)
 {
-    char c_pri_key[prikey_len_customer];
-    Get_prikey_customer(c_pri_key, c_w_id, c_d_id, c_id);
-    Select(trans, c_pri_key, (void**)c);
+    tpcc_key_t from, to;
+    Get_prikey_neworder(&from, no_w_id, no_d_id, 0);
+    Get_prikey_neworder(&to, no_w_id, no_d_id + 1, 0);
+    scan_rows_t rows = { (void**)no, 0 };
+    *no = NULL;
+    Scan(trans, &from, &to, 1, scan_collect_rows, &rows);  // the one w/ the min no_o_id
 }
-void Select_item(tx_trans_t* trans, int i_id, item_t** i)
+int Select_orderlines(tx_trans_t* trans, int ol_w_id, int ol_d_id, int o_id_from, int o_id_to,
+                      orderline_t** ol, int max_ol)
 {
-    char i_pri_key[prikey_len_item];
-    Get_prikey_item(i_pri_key, i_id);
-    Select(trans, i_pri_key, (void**)i);
+    tpcc_key_t from, to;
+    Get_prikey_orderline(&from, ol_w_id, ol_d_id, o_id_from, 0);
+    Get_prikey_orderline(&to, ol_w_id, ol_d_id, o_id_to, 0);
+    scan_rows_t rows = { (void**)ol, 0 };
+    Scan(trans, &from, &to, max_ol, scan_collect_rows, &rows);
+    return rows.n;
 }
-void Select_order(tx_trans_t* trans, int o_w_id, int o_d_id, int o_id, order_t** o)
+
+static inline void Get_c2_entry(customer_t* c, tpcc_key_t* c2_key, customer_by_name_t* c2)
 {
-    char o_pri_key[prikey_len_order];
-    Get_prikey_order(o_pri_key, o_w_id, o_d_id, o_id);
-    Select(trans, o_pri_key, (void**)o);
+    Get_prikey_c2(c2_key, c->c_w_id, c->c_d_id, lastname_to_no(c->c_last), c->c_id);
+    c2->c_id = c->c_id;
+    strcpy(c2->c_first, c->c_first);
 }
-void Select_orderline(tx_trans_t* trans, int ol_w_id, int ol_d_id, int ol_o_id, int ol_number, orderline_t** ol)
+
+// Also used as update (temporarily)
+void Insert_warehouse(tx_trans_t* trans, warehouse_t* w)
 {
-    char ol_pri_key[prikey_len_orderline];
-    Get_prikey_orderline(ol_pri_key, ol_w_id, ol_d_id, ol_o_id, ol_number);
-    Select(trans, ol_pri_key, (void**)ol);
+    tpcc_key_t w_pri_key;
+    Get_prikey_warehouse(&w_pri_key, w->w_id);
+    Insert(trans, &w_pri_key, w, sizeof(*w));
 }
-void Select_stock(tx_trans_t* trans, int s_w_id, int s_i_id, stock_t** s)
+void Insert_district(tx_trans_t* trans, district_t* d)
 {
-    char s_pri_key[prikey_len_stock];
-    Get_prikey_stock(s_pri_key, s_w_id, s_i_id);
-    Select(trans, s_pri_key, (void**)s);
+    tpcc_key_t d_pri_key;
+    Get_prikey_district(&d_pri_key, d->d_w_id, d->d_id);
+    Insert(trans, &d_pri_key, d, sizeof(*d));
 }
-void Select_neworder(tx_trans_t* trans, int no_w_id, int no_d_id, int no_o_id, neworder_t** no)
+void Insert_customer(tx_trans_t* trans, customer_t* c)
 {
-    char no_pri_key[prikey_len_neworder];
-    Get_prikey_neworder(no_pri_key, no_w_id, no_d_id, no_o_id);
-    Select(trans, no_pri_key, (void**)no);
+    tpcc_key_t c_pri_key;
+    Get_prikey_customer(&c_pri_key, c->c_w_id, c->c_d_id, c->c_id);
+    Insert(trans, &c_pri_key, c, sizeof(*c));
+
+    // secondary index (the "mid-position" customer is picked by Select_customer_byname)
+    tpcc_key_t c2_key;
+    customer_by_name_t c2;
+    Get_c2_entry(c, &c2_key, &c2);
+    Insert(trans, &c2_key, &c2, sizeof(c2));
 }
-void Select_history(tx_trans_t* trans, int h_w_id, int h_d_id, int h_c_id, history_t** h)
+void Insert_item(tx_trans_t* trans, item_t* i)
 {
-    char h_pri_key[prikey_len_history];
-    Get_prikey_history(h_pri_key, h_w_id, h_d_id, h_c_id);
-    Select(trans, h_pri_key, (void**)h);
+    tpcc_key_t i_pri_key;
+    Get_prikey_item(&i_pri_key, i->i_id);
+    Insert(trans, &i_pri_key, i, sizeof(*i));
 }
-void Select_customer_byname(tx_trans_t* trans, int c_w_id, int c_d_id, char* c_last, customer_t** c)
+void Insert_order(tx_trans_t* trans, order_t* o)
 {
-    int* c_id;
-    char c2_key[prikey_len_c2];
-    Get_prikey_c2(c2_key, c_w_id, c_d_id, c_last);
-    Select(trans, c2_key, &c_id);
-    Select_customer(trans, c_w_id, c_d_id, *c_id, c);
-    // ??? where is the insertion?
+    tpcc_key_t o_pri_key;
+    Get_prikey_order(&o_pri_key, o->o_w_id, o->o_d_id, o->o_id);
+    Insert(trans, &o_pri_key, o, sizeof(*o));
+
+    // secondary index
+    tpcc_key_t o2_key;
+    Get_prikey_o2(&o2_key, o->o_w_id, o->o_d_id, o->o_c_id, o->o_id);
+    Insert(trans, &o2_key, &o->o_id, sizeof(o->o_id));
 }
-void Select_latest_order(tx_trans_t* trans, int o_w_id, int o_d_id, int o_c_id, order_t** o)
+void Insert_orderline(tx_trans_t* trans, orderline_t* ol)
 {
-    int* largest_o_id;
-    char o2_key[prikey_len_o2];
-    Get_prikey_o2(o2_key, o_w_id, o_d_id, o_c_id);
-    Select(trans, o2_key, &largest_o_id);
-    Select_order(trans, o_w_id, o_d_id, *largest_o_id, o);
+    tpcc_key_t ol_pri_key;
+    Get_prikey_orderline(&ol_pri_key, ol->ol_w_id, ol->ol_d_id, ol->ol_o_id, ol->ol_number);
+    Insert(trans, &ol_pri_key, ol, sizeof(*ol));
 }
-void Select_undelivered_neworder(tx_trans_t* trans, int no_w_id, int no_d_id, neworder_t** no)
+void Insert_stock(tx_trans_t* trans, stock_t* s)
 {
-    int* min_no_o_id;
-    char no2_key[prikey_len_no2];
-    Get_prikey_no2(no2_key, no_w_id, no_d_id);
-    Select(trans, no2_key, &min_no_o_id);
-    Select_neworder(trans, no_w_id, no_d_id, *min_no_o_id, no);
+    tpcc_key_t s_pri_key;
+    Get_prikey_stock(&s_pri_key, s->s_w_id, s->s_i_id);
+    Insert(trans, &s_pri_key, s, sizeof(*s));
 }
-
-// Also used as update (temporarily)
-void Insert_warehouse(tx_trans_t* trans, warehouse_t* w)
+void Insert_neworder(tx_trans_t* trans, neworder_t* no)
 {
-    char w_pri_key[prikey_len_warehouse];
-    Get_prikey_warehouse(w_pri_key, w->w_id);
-    Insert(trans, w_pri_key, w);
+    tpcc_key_t no_pri_key;
+    Get_prikey_neworder(&no_pri_key, no->no_w_id, no->no_d_id, no->no_o_id);
+    Insert(trans, &no_pri_key, no, sizeof(*no));
 }
-void Insert_district(tx_trans_t* trans, district_t* d)
+void Insert_history(tx_trans_t* trans, history_t* h)
 {
-    char d_pri_key[prikey_len_district];
-    Get_prikey_district(d_pri_key, d->d_w_id, d->d_id);
-    Insert(trans, d_pri_key, d);
+    tpcc_key_t h_pri_key;  // In fact, history_t doesn't have a primary key (??? Then how to insert it?)
+    Get_prikey_history(&h_pri_key, h->h_w_id, h->h_d_id, h->h_c_id);
+    Insert(trans, &h_pri_key, h, sizeof(*h));
 }
-void Insert_customer(tx_trans_t* trans, customer_t* c)
+
+void Update_customer(tx_trans_t* trans, customer_t* c)
+{
+    tpcc_key_t c_pri_key;
+    Get_prikey_customer(&c_pri_key, c->c_w_id, c->c_d_id, c->c_id);
+    Insert(trans, &c_pri_key, c, sizeof(*c));
+}
+void Update_order(tx_trans_t* trans, order_t* o)
 {
-    char c_pri_key[prikey_len_customer];
-    Get_prikey_customer(c_pri_key, c->c_w_id, c->c_d_id, c->c_id);
-    Insert(trans, c_pri_key, c);
+    tpcc_key_t o_pri_key;
+    Get_prikey_order(&o_pri_key, o->o_w_id, o->o_d_id, o->o_id);
+    Insert(trans, &o_pri_key, o, sizeof(*o));
+}
 
-    // maintain aux table (TODO: use a data structure to maintain "mid-position" customer)
-    char c2_key[prikey_len_c2];
-    Get_prikey_c2(c2_key, c->c_w_id, c->c_d_id, c->c_last);
-    Insert(trans, c2_key, c);
+void Select_customer_fields(tx_trans_t* trans, int c_w_id, int c_d_id, int c_id, uint32_t offset, uint32_t len,
+                            customer_t** c)
+{
+    tpcc_key_t c_pri_key;
+    Get_prikey_customer(&c_pri_key, c_w_id, c_d_id, c_id);
+    Select_fields(trans, &c_pri_key, offset, len, (void**)c);
 }
-void Insert_item(tx_trans_t* trans, item_t* i)
+void Select_stock_fields(tx_trans_t* trans, int s_w_id, int s_i_id, uint32_t offset, uint32_t len, stock_t** s)
 {
-    char i_pri_key[prikey_len_item];
-    Get_prikey_item(i_pri_key, i->i_id);
-    Insert(trans, i_pri_key, i);
+    tpcc_key_t s_pri_key;
+    Get_prikey_stock(&s_pri_key, s_w_id, s_i_id);
+    Select_fields(trans, &s_pri_key, offset, len, (void**)s);
 }
-void Insert_order(tx_trans_t* trans, order_t* o)
+void Update_customer_fields(tx_trans_t* trans, int c_w_id, int c_d_id, int c_id, customer_t* c, uint32_t offset,
+                            uint32_t len)
 {
-    char o_pri_key[prikey_len_order];
-    Get_prikey_order(o_pri_key, o->o_w_id, o->o_d_id, o->o_id);
-    Insert(trans, o_pri_key, o);
+    tpcc_key_t c_pri_key;
+    Get_prikey_customer(&c_pri_key, c_w_id, c_d_id, c_id);
+    Update_fields(trans, &c_pri_key, c, offset, len);
+}
+void Update_stock_fields(tx_trans_t* trans, int s_w_id, int s_i_id, stock_t* s, uint32_t offset, uint32_t len)
+{
+    tpcc_key_t s_pri_key;
+    Get_prikey_stock(&s_pri_key, s_w_id, s_i_id);
+    Update_fields(trans, &s_pri_key, s, offset, len);
+}
 
-    // aux table
-    char o2_key[prikey_len_o2];
-    Get_prikey_o2(o2_key, o->o_w_id, o->o_d_id, o->o_c_id);
-    int* o2_o_id = new(int);  *o2_o_id = o->o_id;
-    Insert(trans, o2_key, o2_o_id);  // must be the new largest o_id
+int Add_warehouse_ytd(tx_trans_t* trans, int w_id, float amount)
+{
+    tpcc_key_t w_pri_key;
+    Get_prikey_warehouse(&w_pri_key, w_id);
+    return tx_trans_kv_add(trans, w_pri_key.bytes, w_pri_key.len, offsetof(warehouse_t, w_ytd), TX_ADD_F32, &amount);
 }
-void Insert_orderline(tx_trans_t* trans, orderline_t* ol)
+int Add_district_ytd(tx_trans_t* trans, int d_w_id, int d_id, float amount)
 {
-    char ol_pri_key[prikey_len_orderline];
-    Get_prikey_orderline(ol_pri_key, ol->ol_w_id, ol->ol_d_id, ol->ol_o_id, ol->ol_number);
-    Insert(trans, ol_pri_key, ol);
+    tpcc_key_t d_pri_key;
+    Get_prikey_district(&d_pri_key, d_w_id, d_id);
+    return tx_trans_kv_add(trans, d_pri_key.bytes, d_pri_key.len, offsetof(district_t, d_ytd), TX_ADD_F32, &amount);
 }
-void Insert_stock(tx_trans_t* trans, stock_t* s)
+int Add_stock_order(tx_trans_t* trans, int s_w_id, int s_i_id, uint32_t quantity, uint16_t remote)
 {
-    char s_pri_key[prikey_len_stock];
-    Get_prikey_stock(s_pri_key, s->s_w_id, s->s_i_id);
-    Insert(trans, s_pri_key, s);
+    tpcc_key_t s_pri_key;
+    Get_prikey_stock(&s_pri_key, s_w_id, s_i_id);
+    uint16_t one = 1;
+    if (tx_trans_kv_add(trans, s_pri_key.bytes, s_pri_key.len, offsetof(stock_t, s_ytd), TX_ADD_I32, &quantity) < 0)
+        return -1;
+    tx_trans_kv_add(trans, s_pri_key.bytes, s_pri_key.len, offsetof(stock_t, s_order_cnt), TX_ADD_I16, &one);
+    if (remote)
+        tx_trans_kv_add(trans, s_pri_key.bytes, s_pri_key.len, offsetof(stock_t, s_remote_cnt), TX_ADD_I16, &remote);
+    return 0;
 }
-void Insert_neworder(tx_trans_t* trans, neworder_t* no)
+int Add_customer_delivery(tx_trans_t* trans, int c_w_id, int c_d_id, int c_id, float amount)
 {
-    char no_pri_key[prikey_len_neworder];
-    Get_prikey_neworder(no_pri_key, no->no_w_id, no->no_d_id, no->no_o_id);
-    Insert(trans, no_pri_key, no);
-
-    // aux table
-    char no2_key[prikey_len_no2];
-    Get_prikey_no2(no2_key, no->no_w_id, no->no_d_id);
+    tpcc_key_t c_pri_key;
+    Get_prikey_customer(&c_pri_key, c_w_id, c_d_id, c_id);
+    uint16_t one = 1;
+    if (tx_trans_kv_add(trans, c_pri_key.bytes, c_pri_key.len, offsetof(customer_t, c_balance), TX_ADD_F32, &amount) < 0)
+        return -1;
+    tx_trans_kv_add(trans, c_pri_key.bytes, c_pri_key.len, offsetof(customer_t, c_delivery_cnt), TX_ADD_I16, &one);
+    return 0;
+}
 
-    neworder_t* no;
-    Select(trans, no2_key, &no);
-    if (no != NULL) return;
-    // Orders and neworders must come with increasing o_id,
-    //  so this neworder must not be the min neworder in this (w_id, d_id)
-    
-    int* no2_o_id = new(int); *no2_o_id = no->no_o_id;
-    Insert(trans, no2_key, no2_o_id);
+int Read_warehouse(tx_ctx_t* ctx, int w_id, warehouse_t* w)
+{
+    tpcc_key_t w_pri_key;
+    Get_prikey_warehouse(&w_pri_key, w_id);
+    uint32_t len = sizeof(*w);
+    return tx_single_kv_get(ctx, w_pri_key.bytes, w_pri_key.len, w, &len) == successful ? 0 : -1;
 }
-void Insert_history(tx_trans_t* trans, history_t* h)
+int Read_district(tx_ctx_t* ctx, int d_w_id, int d_id, district_t* d)
 {
-    char h_pri_key[prikey_len_history];  // In fact, history_t doesn't have a primary key (??? Then how to insert it?)
-    Get_prikey_history(h_pri_key, h->h_w_id, h->h_d_id, h->h_c_id);
-    Insert(trans, h_pri_key, h);
+    tpcc_key_t d_pri_key;
+    Get_prikey_district(&d_pri_key, d_w_id, d_id);
+    uint32_t len = sizeof(*d);
+    return tx_single_kv_get(ctx, d_pri_key.bytes, d_pri_key.len, d, &len) == successful ? 0 : -1;
 }
 
-void Insert_warehouse_trans(tx_ctx_t* ctx, warehouse_t* w)
+void Load_warehouse(tpcc_loader_t* ld, warehouse_t* w)
 {
-    tx_trans_t* trans = tx_trans_create(ctx);  tx_trans_init(ctx, trans);
-    Insert_warehouse(trans, w);
-    tx_trans_commit(trans);  tx_trans_destroy(trans);
+    tpcc_key_t w_pri_key;
+    Get_prikey_warehouse(&w_pri_key, w->w_id);
+    Load(ld, &w_pri_key, w, sizeof(*w));
 }
-void Insert_district_trans(tx_ctx_t* ctx, district_t* d)
+void Load_district(tpcc_loader_t* ld, district_t* d)
 {
-    tx_trans_t* trans = tx_trans_create(ctx);  tx_trans_init(ctx, trans);
-    Insert_district(trans, d);
-    tx_trans_commit(trans);  tx_trans_destroy(trans);
+    tpcc_key_t d_pri_key;
+    Get_prikey_district(&d_pri_key, d->d_w_id, d->d_id);
+    Load(ld, &d_pri_key, d, sizeof(*d));
 }
-void Insert_customer_trans(tx_ctx_t* ctx, customer_t* c)
+void Load_customer(tpcc_loader_t* ld, customer_t* c)
 {
-    tx_trans_t* trans = tx_trans_create(ctx);  tx_trans_init(ctx, trans);
-    Insert_customer(trans, c);
-    tx_trans_commit(trans);  tx_trans_destroy(trans);
+    tpcc_key_t c_pri_key;
+    Get_prikey_customer(&c_pri_key, c->c_w_id, c->c_d_id, c->c_id);
+    Load(ld, &c_pri_key, c, sizeof(*c));
+
+    tpcc_key_t c2_key;
+    customer_by_name_t c2;
+    Get_c2_entry(c, &c2_key, &c2);
+    Load(ld, &c2_key, &c2, sizeof(c2));
 }
-void Insert_item_trans(tx_ctx_t* ctx, item_t* i)
+void Load_item(tpcc_loader_t* ld, item_t* i)
 {
-    tx_trans_t* trans = tx_trans_create(ctx);  tx_trans_init(ctx, trans);
-    Insert_item(trans, i);
-    tx_trans_commit(trans);  tx_trans_destroy(trans);
+    tpcc_key_t i_pri_key;
+    Get_prikey_item(&i_pri_key, i->i_id);
+    Load(ld, &i_pri_key, i, sizeof(*i));
 }
-void Insert_order_trans(tx_ctx_t* ctx, order_t* o)
+void Load_order(tpcc_loader_t* ld, order_t* o)
 {
-    tx_trans_t* trans = tx_trans_create(ctx);  tx_trans_init(ctx, trans);
-    Insert_order(trans, o);
-    tx_trans_commit(trans);  tx_trans_destroy(trans);
+    tpcc_key_t o_pri_key;
+    Get_prikey_order(&o_pri_key, o->o_w_id, o->o_d_id, o->o_id);
+    Load(ld, &o_pri_key, o, sizeof(*o));
+
+    tpcc_key_t o2_key;
+    Get_prikey_o2(&o2_key, o->o_w_id, o->o_d_id, o->o_c_id, o->o_id);
+    Load(ld, &o2_key, &o->o_id, sizeof(o->o_id));
 }
-void Insert_orderline_trans(tx_ctx_t* ctx, orderline_t* ol)
+void Load_orderline(tpcc_loader_t* ld, orderline_t* ol)
 {
-    tx_trans_t* trans = tx_trans_create(ctx);  tx_trans_init(ctx, trans);
-    Insert_orderline(trans, ol);
-    tx_trans_commit(trans);  tx_trans_destroy(trans);
+    tpcc_key_t ol_pri_key;
+    Get_prikey_orderline(&ol_pri_key, ol->ol_w_id, ol->ol_d_id, ol->ol_o_id, ol->ol_number);
+    Load(ld, &ol_pri_key, ol, sizeof(*ol));
 }
-void Insert_stock_trans(tx_ctx_t* ctx, stock_t* s)
+void Load_stock(tpcc_loader_t* ld, stock_t* s)
 {
-    tx_trans_t* trans = tx_trans_create(ctx);  tx_trans_init(ctx, trans);
-    Insert_stock(trans, s);
-    tx_trans_commit(trans);  tx_trans_destroy(trans);
+    tpcc_key_t s_pri_key;
+    Get_prikey_stock(&s_pri_key, s->s_w_id, s->s_i_id);
+    Load(ld, &s_pri_key, s, sizeof(*s));
 }
-void Insert_neworder_trans(tx_ctx_t* ctx, neworder_t* no)
+void Load_neworder(tpcc_loader_t* ld, neworder_t* no)
 {
-    tx_trans_t* trans = tx_trans_create(ctx);  tx_trans_init(ctx, trans);
-    Insert_neworder(trans, no);
-    tx_trans_commit(trans);  tx_trans_destroy(trans);
+    tpcc_key_t no_pri_key;
+    Get_prikey_neworder(&no_pri_key, no->no_w_id, no->no_d_id, no->no_o_id);
+    Load(ld, &no_pri_key, no, sizeof(*no));
 }
-void Insert_history_trans(tx_ctx_t* ctx, history_t* h)
+void Load_history(tpcc_loader_t* ld, history_t* h)
 {
-    tx_trans_t* trans = tx_trans_create(ctx);  tx_trans_init(ctx, trans);
-    Insert_history(trans, h);
-    tx_trans_commit(trans);  tx_trans_destroy(trans);
+    tpcc_key_t h_pri_key;
+    Get_prikey_history(&h_pri_key, h->h_w_id, h->h_d_id, h->h_c_id);
+    Load(ld, &h_pri_key, h, sizeof(*h));
 }
 
 void Delete_neworder(tx_trans_t* trans, neworder_t* no)
 {
-    char no_pri_key[prikey_len_neworder];
-    Get_prikey_neworder(no_pri_key, no->no_w_id, no->no_d_id, no->no_o_id);
-    Delete(trans, no_pri_key);
+    tpcc_key_t no_pri_key;
+    Get_prikey_neworder(&no_pri_key, no->no_w_id, no->no_d_id, no->no_o_id);
+    Delete(trans, &no_pri_key);
 }
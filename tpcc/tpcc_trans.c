@@ -1,119 +1,145 @@
 #include "tx_shim.h"
+#include "tx_shim_slab.h"
+#include "tx_trace.h"
 #include "tpcc.h"
 #include <stdio.h>
 #include <string.h>
 #include <time.h>
-#define new(T) malloc(sizeof(T))
+#define new(T) tx_slab_alloc(sizeof(T))  // rows are 64B-aligned w/o the malloc lock
 
 //////////////////////
 // Transactions
 //////////////////////
 
-static FILE* fp;
-static FILE* delivery_tx_result_fp;
+static inline tx_trans_result tpcc_commit(tpcc_terminal_t* term, tx_trans_t* trans, tpcc_txn_type_t type)
+{
+    tx_trans_result res = tx_trans_commit(trans);
+    if (res == failed) term->stats.failed[type]++;
+    return res;
+}
+// A row that must exist is missing, i.e., the tx read an inconsistent state of the db
+//  (e.g., the order of a concurrent new order w/o its orderlines) and would fail on commit anyway.
+static inline tx_trans_result tpcc_abort(tpcc_terminal_t* term, tx_trans_t* trans, tpcc_txn_type_t type)
+{
+    tx_trans_abort_n_clear(trans);
+    term->stats.failed[type]++;
+    return failed;
+}
 
-static inline char* asc_local_time(void)
+static inline char* asc_time(time_t t, char* buf)  // buf of (at least) 26 chars
 {
-    time_t* cur_time = new(time_t); time(cur_time);
-    return asctime(localtime(cur_time));
+    struct tm local;
+    return asctime_r(localtime_r(&t, &local), buf);
 }
 
-void trans_new_order(tx_ctx_t* ctx)
-// enter the new order generated by gen_new_order() through a single database transaction
+tx_trans_result trans_new_order(tpcc_terminal_t* term, const tpcc_txn_t* txn)
+// enter the new order generated by gen_trans() through a single database transaction
 {
-    // input format:
-    //  transaction type, w_id, d_id, c_id, ol_cnt
-    //   - (order line 1) ol_i_id, ol_supply_w_id, ol_quantity
-    //   ...
-    int w_id, d_id, c_id, ol_cnt;
-    fscanf(fp, "%d%d%d%d", &w_id, &d_id, &c_id, &ol_cnt);
-
-    tx_trans_t* trans = tx_trans_create(ctx);  tx_trans_init(ctx, trans);
-    
-    warehouse_t* w; Select_warehouse(trans, w_id, &w);
+    int w_id = txn->w_id, d_id = txn->d_id, c_id = txn->new_order.c_id, ol_cnt = txn->new_order.ol_cnt;
+
+    tx_trans_t* trans = tx_trans_create(term->ctx);
+
+    warehouse_t w_row, *w = &w_row;
+    if (Read_warehouse(term->ctx, w_id, w) < 0) w = NULL;
     // The row in the WAREHOUSE table with matching W_ID is selected and
     //  W_TAX, the warehouse tax rate, is retrieved.
-    
-    district_t* d; Select_district(trans, w_id, d_id, &d);
-    // Note that we want to do an update here rather than an insert. But the backend
-    //  only provides set() that fulfills both the insert and the update action.
-    //  Do we need to add a get() before set() to tell between these two actions???
 
+    district_t d_row, *d = &d_row;
+    if (Read_district(term->ctx, w_id, d_id, d) < 0) d = NULL;
     // The row in the DISTRICT table with matching D_W_ID and D_ID is selected,
     //  D_TAX, the district tax rate, is retrieved, and D_NEXT_O_ID,
     //  the next available order number for the district, is retrieved and incremented by one.
-    
+    // (W_TAX and D_TAX never change and D_NEXT_O_ID is taken from the sequence of the district, so both rows are
+    //  read outside the tx and new orders do not conflict on them -- the numbers of failed txs are skipped)
+
     customer_t* c; Select_customer(trans, w_id, d_id, c_id, &c);
     // The row in the CUSTOMER table with matching C_W_ID, C_D_ID, and C_ID is selected
     //  and C_DISCOUNT, the customer's discount rate, C_LAST, the customer's last name,
     //  and C_CREDIT, the customer's credit status, are retrieved.
-    
-    neworder_t* no = new(neworder_t);
-    no->no_w_id = w_id; no->no_d_id = d_id; no->no_o_id = d->d_next_o_id;
-    Insert_neworder(trans, no);
-
-    order_t* o = new(order_t);
-    o->o_w_id = w_id; o->o_d_id = d_id; o->o_id = d->d_next_o_id;
-    o->o_c_id = c_id; o->o_all_local = 1; o->o_carrier_id = -1;
-    o->o_entry_d = new(struct tm); *o->o_entry_d = cur_local_time();  // ??? can be optimized
+    if (w == NULL || d == NULL || c == NULL) return tpcc_abort(term, trans, TPCC_NEW_ORDER);
+    int o_id = tx_trans_seq_next(trans, d->d_o_id_seq, 1);
+
+    neworder_t no = { .no_o_id = o_id, .no_d_id = d_id, .no_w_id = w_id };
+    Insert_neworder(trans, &no);
+
+    order_t o = { .o_id = o_id, .o_d_id = d_id, .o_w_id = w_id, .o_c_id = c_id,
+                  .o_carrier_id = -1, .o_all_local = 1 };
+    o.o_entry_d = new(struct tm); *o.o_entry_d = cur_local_time();  // ??? can be optimized
     // A new row is inserted into both the NEW-ORDER table and the ORDER table to
     //  reflect the creation of the new order. O_CARRIER_ID is set to a null value.
     // If the order includes only home order-lines, then O_ALL_LOCAL is set to 1,
     //  otherwise O_ALL_LOCAL is set to 0. (???)
 
-    d->d_next_o_id++; Insert_district(trans, d);
-    
-    o->o_ol_cnt = ol_cnt;
+    o.o_ol_cnt = ol_cnt;
     // From specification: The number of items, O_OL_CNT, is computed to match ol_cnt.
-    // Currently we can't tell whether the fscanf() fails, so no way to compute O_OL_CNT,
-    //  and we temporarily use a direct assignment. (???)
+
+    // The item and stock keys of all the order lines are known upfront, so their lookups are overlapped instead of
+    //  missing one after the other: the index entries of the stocks are prefetched, the items are selected in a
+    //  batch and the stock rows are prefetched before the order lines are processed.
+    int i_ids[15];
+    item_t* items[15];
+    for (int k = 0; k < ol_cnt; k++)
+    {
+        const tpcc_order_line_in_t* in = &txn->new_order.ol[k];
+        tpcc_key_t s_key; Get_prikey_stock(&s_key, in->ol_supply_w_id, in->ol_i_id);
+        Prefetch(term->ctx, &s_key, 0);
+        i_ids[k] = in->ol_i_id;
+    }
+    Select_items(trans, i_ids, ol_cnt, items);
+    // The row in the ITEM table with matching I_ID (equals OL_I_ID) is
+    //  selected and I_PRICE, the price of the item, I_NAME, the name of
+    //  the item, and I_DATA are retrieved.
+    // According to spec, a Select in the ITEM table must be done whether or not
+    //  the i_id is a null value. So we put this ahead of the following if clause.
+    for (int k = 0; k < ol_cnt; k++)
+    {
+        const tpcc_order_line_in_t* in = &txn->new_order.ol[k];
+        tpcc_key_t s_key; Get_prikey_stock(&s_key, in->ol_supply_w_id, in->ol_i_id);
+        Prefetch(term->ctx, &s_key, sizeof(stock_t));
+    }
 
     float sum_ol_amount = 0;
     char brand_generic[15];  // brand-generic (see TPC-C specification section 2.4)
     for (int k = 0; k < ol_cnt; k++)
     {
-        int ol_i_id, ol_supply_w_id, ol_quantity;
-        fscanf(fp, "%d%d%d", &ol_i_id, &ol_supply_w_id, &ol_quantity);
-        orderline_t* ol = new(orderline_t);
-        ol->ol_o_id = o->o_id;
-        ol->ol_w_id = o->o_w_id; ol->ol_d_id = o->o_d_id;
-        ol->ol_i_id = ol_i_id; ol->ol_supply_w_id = ol_supply_w_id;
-        ol->ol_quantity = ol_quantity;
-
-        item_t* i; Select_item(trans, ol_i_id, &i);
-        // The row in the ITEM table with matching I_ID (equals OL_I_ID) is
-        //  selected and I_PRICE, the price of the item, I_NAME, the name of
-        //  the item, and I_DATA are retrieved.
-        // According to spec, a Select in the ITEM table must be done whether or not
-        //  the i_id is a null value. So we put this ahead of the following if clause.
-
-        if (ol_i_id == 0)
+        const tpcc_order_line_in_t* in = &txn->new_order.ol[k];
+        orderline_t ol = { .ol_o_id = o.o_id, .ol_d_id = o.o_d_id, .ol_w_id = o.o_w_id,
+                           .ol_i_id = in->ol_i_id, .ol_supply_w_id = in->ol_supply_w_id,
+                           .ol_quantity = in->ol_quantity };
+        item_t* i = items[k];
+
+        if (ol.ol_i_id == 0)
         {
-            puts("invalid order-line item id (ol_i_id) in new order transaction");
-            tx_trans_abort_n_clear(trans); return;
+            tx_trans_abort_n_clear(trans);
+            term->stats.rolled_back++;
+            return committed;  // (a completed business tx)
         }
         // If I_ID has an unused value, a "not-found" condition is signaled,
         //  resulting in a rollback of the database transaction.
 
-        stock_t* s; Select_stock(trans, ol_supply_w_id, ol_i_id, &s);
+        stock_t* s;  // (only the fields below of the ~320B row are read and written)
+        Select_stock_fields(trans, ol.ol_supply_w_id, ol.ol_i_id, FIELDS(stock_t, s_quantity, s_quantity), &s);
+        Select_stock_fields(trans, ol.ol_supply_w_id, ol.ol_i_id, FIELDS(stock_t, s_dist[d_id-1], s_dist[d_id-1]), &s);
+        Select_stock_fields(trans, ol.ol_supply_w_id, ol.ol_i_id, FIELDS(stock_t, s_data, s_data), &s);
         // The row in the STOCK table with matching S_I_ID (equals OL_I_ID) and S_W_ID (equals
         // OL_SUPPLY_W_ID) is selected. S_QUANTITY, the quantity in stock, S_DIST_xx, where xx
         // represents the district number, and S_DATA are retrieved.
+        if (i == NULL || s == NULL) return tpcc_abort(term, trans, TPCC_NEW_ORDER);
 
-        if (s->s_quantity - ol_quantity >= 10) s->s_quantity -= ol_quantity;
-        else s->s_quantity = (s->s_quantity - ol_quantity) + 91;
+        if (s->s_quantity - ol.ol_quantity >= 10) s->s_quantity -= ol.ol_quantity;
+        else s->s_quantity = (s->s_quantity - ol.ol_quantity) + 91;
         // If the retrieved value for S_QUANTITY exceeds
         // OL_QUANTITY by 10 or more, then S_QUANTITY is decreased by OL_QUANTITY; otherwise
         // S_QUANTITY is updated to (S_QUANTITY - OL_QUANTITY) + 91.
-        
-        s->s_ytd += ol_quantity; s->s_order_cnt += 1;
-        if (ol_supply_w_id != w_id) { s->s_remote_cnt += 1; o->o_all_local = 0; }
-        Insert_stock(trans, s);
+
+        Update_stock_fields(trans, ol.ol_supply_w_id, ol.ol_i_id, s, FIELDS(stock_t, s_quantity, s_quantity));
+        if (ol.ol_supply_w_id != w_id) o.o_all_local = 0;
+        Add_stock_order(trans, ol.ol_supply_w_id, ol.ol_i_id, ol.ol_quantity, ol.ol_supply_w_id != w_id);
         // S_YTD is increased by OL_QUANTITY and S_ORDER_CNT is incremented by 1.
         // If the order-line is remote, then S_REMOTE_CNT is incremented by 1.
 
-        ol->ol_amount = ol->ol_quantity * i->i_price;
-        sum_ol_amount += ol->ol_amount;
+        ol.ol_amount = ol.ol_quantity * i->i_price;
+        sum_ol_amount += ol.ol_amount;
         // The amount for the item in the order (OL_AMOUNT) is computed.
 
         brand_generic[k] = strstr(i->i_data, "original") && strstr(s->s_data, "original") ? 'B' : 'G';
@@ -122,57 +148,50 @@ void trans_new_order(tx_ctx_t* ctx)
         //  otherwise, the brand-generic field is set to "G".
         // This information is intended for terminal display
 
-        ol->ol_delivery_d = NULL; ol->ol_number = k;
-        strcpy(ol->ol_dist_info, s->s_dist[ol->ol_d_id]);
-        Insert_orderline(trans, ol);
+        ol.ol_delivery_d = NULL; ol.ol_number = k+1;  // numbered from 1 (as in the population)
+        strcpy(ol.ol_dist_info, s->s_dist[ol.ol_d_id - 1]);  // (S_DIST_01 is s_dist[0])
+        Insert_orderline(trans, &ol);
         // A new row is inserted into the ORDER-LINE table to reflect the item on
         //  the order. OL_DELIVERY_D is set to a null value, OL_NUMBER is set to
         //  a unique value within all the ORDER-LINE rows that have the same OL_O_ID
         //  value, and OL_DIST_INFO is set to the content of S_DIST_xx, where xx
         //  represents the district number (OL_D_ID)
     }
-    
+
     float total_amount = sum_ol_amount * (1 - c->c_discount) * (1 + w->w_tax + d->d_tax);
     // The total-amount for the complete order is computed.
     // This information is intended for terminal display
-    
-    Insert_order(trans, o);
-    tx_trans_commit(trans);  tx_trans_destroy(trans);  // ??? destroy a tx every time?
+
+    Insert_order(trans, &o);
+    return tpcc_commit(term, trans, TPCC_NEW_ORDER);
     // The database transaction is committed, unless it has been rolled back
     //  as a result of an unused value for the last item number.
 
     // ...
     // The output data are communicated to the terminal. (Omit)
 }
-void trans_payment(tx_ctx_t* ctx)
+tx_trans_result trans_payment(tpcc_terminal_t* term, const tpcc_txn_t* txn)
 {
-    int w_id, d_id, c_w_id, c_d_id, byname;
-    float h_amount;
-    fscanf(fp, "%d%d%d%d%f%d", &w_id, &d_id, &c_w_id, &c_d_id, &h_amount, &byname);
-
-    tx_trans_t* trans = tx_trans_create(ctx);  tx_trans_init(ctx, trans);
-
-    warehouse_t* w; Select_warehouse(trans, w_id, &w);
-    w->w_ytd += h_amount;
-    Insert_warehouse(trans, w);
-    
-    district_t* d; Select_district(trans, w_id, d_id, &d);
-    d->d_ytd += h_amount;
-    Insert_district(trans, d);
-    
-    customer_t* c;
-    int c_id;
-    char c_last[17];
-    if (byname == 2)
-    {
-        fscanf(fp, "%s", c_last);
-        Select_customer_byname(trans, c_w_id, c_d_id, c_last, &c);
-        c_id = c->c_id;
-    }
-    else {
-        fscanf(fp, "%d", &c_id);
-        Select_customer(trans, c_w_id, c_d_id, c_id, &c);
-    }
+    int w_id = txn->w_id, d_id = txn->d_id;
+    int c_w_id = txn->payment.c_w_id, c_d_id = txn->payment.c_d_id;
+    float h_amount = txn->payment.h_amount;
+
+    tx_trans_t* trans = tx_trans_create(term->ctx);
+
+    // W_NAME and D_NAME are never updated, so they are read outside the tx, which then only adds to W_YTD
+    //  and D_YTD (i.e., the payments of a warehouse do not conflict on its warehouse and district rows)
+    warehouse_t w_row, *w = &w_row; district_t d_row, *d = &d_row;
+    if (Read_warehouse(term->ctx, w_id, w) < 0 || Read_district(term->ctx, w_id, d_id, d) < 0 ||
+        Add_warehouse_ytd(trans, w_id, h_amount) < 0 || Add_district_ytd(trans, w_id, d_id, h_amount) < 0)
+        return tpcc_abort(term, trans, TPCC_PAYMENT);
+
+    int c_id = txn->payment.c_id;
+    if (txn->payment.byname == 1)  // 1: by last name, 2: by c_id (see tpcc_trans_generator.py)
+        c_id = Select_customer_id_byname(trans, c_w_id, c_d_id, (char*) txn->payment.c_last);
+    customer_t* c = NULL;  // (C_DATA is only read and written for bad credit)
+    if (c_id >= 0) Select_customer_fields(trans, c_w_id, c_d_id, c_id, FIELDS(customer_t, c_credit, c_payment_cnt), &c);
+    if (c == NULL) return tpcc_abort(term, trans, TPCC_PAYMENT);
+
     c->c_balance -= h_amount;
     c->c_ytd_payment += h_amount;
     c->c_payment_cnt++;
@@ -182,67 +201,94 @@ void trans_payment(tx_ctx_t* ctx)
     char c_data[501] = {}, c_new_data[501] = {};
     if (strstr(c->c_credit, "BC"))
     {
+        char now[26];
+        Select_customer_fields(trans, c_w_id, c_d_id, c_id, FIELDS(customer_t, c_data, c_data), &c);
         strcpy(c_data, c->c_data);
         sprintf(c_new_data, "| %4d %2d %4d %2d %4d $%7.2f %12s %24s",
-        c_id, c_d_id, c_w_id, d_id, w_id, h_amount, asc_local_time(), h_data);  // ???
+        c_id, c_d_id, c_w_id, d_id, w_id, h_amount, asc_time(time(NULL), now), h_data);  // ???
         strncat(c_new_data, c_data, 500-strlen(c_new_data));  // padding???
         strcpy(c->c_data, c_new_data);
+        Update_customer_fields(trans, c_w_id, c_d_id, c_id, c, FIELDS(customer_t, c_data, c_data));
     }
-    Insert_customer(trans, c);
-
-    history_t* h = new(history_t); h->h_amount = h_amount;
-    strcpy(h->h_data, h_data);
-    h->h_c_d_id = c_d_id; h->h_c_w_id = c_w_id; h->h_c_id = c_id; h->h_d_id = d_id;
-    h->h_w_id = w_id;
-    h->h_date = new(struct tm); *h->h_date = cur_local_time();
-    Insert_history(trans, h);
-    
-    tx_trans_commit(trans);  tx_trans_destroy(trans);
+    Update_customer_fields(trans, c_w_id, c_d_id, c_id, c, FIELDS(customer_t, c_balance, c_payment_cnt));
+
+    history_t h = { .h_c_id = c_id, .h_c_d_id = c_d_id, .h_c_w_id = c_w_id, .h_d_id = d_id, .h_w_id = w_id,
+                    .h_amount = h_amount };
+    strcpy(h.h_data, h_data);
+    h.h_date = new(struct tm); *h.h_date = cur_local_time();
+    Insert_history(trans, &h);
+
+    return tpcc_commit(term, trans, TPCC_PAYMENT);
 }
-void trans_order_status(tx_ctx_t* ctx)
+tx_trans_result trans_order_status(tpcc_terminal_t* term, const tpcc_txn_t* txn)
 {
-    int w_id, d_id, byname;
-    fscanf(fp, "%d%d%d", &w_id, &d_id, &byname);
+    int w_id = txn->w_id, d_id = txn->d_id;
 
-    tx_trans_t* trans = tx_trans_create(ctx);  tx_trans_init(ctx, trans);
+    tx_trans_t* trans = tx_rd_only_trans_create(term->ctx);  // (zero-copy reads)
 
     customer_t* c;
-    char c_last[17];
-    int c_id = 0;
-    if (byname == 2)
-    {
-        fscanf(fp, "%s", c_last);
-        Select_customer_byname(trans, w_id, d_id, c_last, &c);
-        c_id = c->c_id;
-    }
-    else {
-        fscanf(fp, "%d", &c_id);
-        Select_customer(trans, w_id, d_id, c_id, &c);
-    }
-    
+    if (txn->order_status.byname == 1)  // 1: by last name, 2: by c_id (see tpcc_trans_generator.py)
+        Select_customer_byname(trans, w_id, d_id, (char*) txn->order_status.c_last, &c);
+    else
+        Select_customer(trans, w_id, d_id, txn->order_status.c_id, &c);
+    if (c == NULL) return tpcc_abort(term, trans, TPCC_ORDER_STATUS);
+
     order_t* o;
-    Select_latest_order(trans, w_id, d_id, c_id, &o);
+    Select_latest_order(trans, w_id, d_id, c->c_id, &o);
 
-    for (int k = 0; k < 15; k++)
-    {
-        orderline_t* ol; Select_orderline(trans, w_id, d_id, o->o_id, k, &ol);
-        if (ol == NULL) break;  // end of orderlines in this order
-    }
-    
-    tx_trans_commit(trans);  tx_trans_destroy(trans);
+    orderline_t* ols[15];
+    if (o != NULL) Select_orderlines(trans, w_id, d_id, o->o_id, o->o_id + 1, ols, 15);
+
+    return tpcc_commit(term, trans, TPCC_ORDER_STATUS);
     // From the spec: A commit is not required as long as all ACID properties are satisfied.
 
     // ...
     // The output data are communicated to the terminal. (Omit)
 }
-int trans_delivery(tx_ctx_t* ctx, time_t created_time, int w_id, int o_carrier_id)  // Deferred Execution
+static tx_trans_result trans_deliver_district(tpcc_terminal_t* term, int w_id, int d_id, int o_carrier_id, int* o_id)
+// delivers the oldest undelivered order of the district (*o_id; -1 if there is none)
 {
-    // returns number of skipped districts (no undelivered orders)
-    tx_trans_t* trans = tx_trans_create(ctx);
-    fprintf(delivery_tx_result_fp, "Delivery tx created time: %s\n", asctime(localtime(&created_time)));
-    fprintf(delivery_tx_result_fp, "W: %d, Order carrier: %d\n", w_id, o_carrier_id);
+    tx_trans_t* trans = tx_trans_create(term->ctx);
+
+    neworder_t* no; Select_undelivered_neworder(trans, w_id, d_id, &no);
+    // This select function can be optimized: we only need no_o_id
+    *o_id = no == NULL ? -1 : no->no_o_id;
+    if (no == NULL) return tpcc_commit(term, trans, TPCC_DELIVERY);  // (validates that there is still none)
+
+    order_t* o; Select_order(trans, w_id, d_id, *o_id, &o);
+    if (o == NULL) return tpcc_abort(term, trans, TPCC_DELIVERY);
+    Delete_neworder(trans, no);
+
+    o -> o_carrier_id = o_carrier_id;
+    Update_order(trans, o);
+
+    struct tm cur_time = cur_local_time();
+    float o_ol_amount = 0;
+    orderline_t* ols[15];
+    int ol_cnt = Select_orderlines(trans, w_id, d_id, *o_id, *o_id + 1, ols, 15);
+    for (int k = 0; k < ol_cnt; k++)
+    {
+        orderline_t* ol = ols[k];
+        ol->ol_delivery_d = new(struct tm); *ol->ol_delivery_d = cur_time;  // must be NULL before
+        o_ol_amount += ol->ol_amount;
+        Insert_orderline(trans, ol);
+    }
+
+    if (Add_customer_delivery(trans, w_id, d_id, o->o_c_id, o_ol_amount) < 0)
+        return tpcc_abort(term, trans, TPCC_DELIVERY);
+
+    return tpcc_commit(term, trans, TPCC_DELIVERY);
+}
+tx_trans_result trans_delivery(tpcc_terminal_t* term, const tpcc_txn_t* txn)  // Deferred Execution
+{
+    int w_id = txn->w_id, o_carrier_id = txn->delivery.o_carrier_id;
+    char now[26];
+    if (term->delivery_log != NULL)
+    {
+        fprintf(term->delivery_log, "Delivery tx created time: %s\n", asc_time(txn->delivery.enq_time, now));
+        fprintf(term->delivery_log, "W: %d, Order carrier: %d\n", w_id, o_carrier_id);
+    }
 
-    warehouse_t* w; Select_warehouse(trans, w_id, &w);
     // The deferred execution of the Delivery transaction delivers one outstanding order
     //  (average items-per-order = 10) for each one of the 10 districts of the
     //  selected warehouse using one or more (up to 10) database transactions.
@@ -250,60 +296,29 @@ int trans_delivery(tx_ctx_t* ctx, time_t created_time, int w_id, int o_carrier_i
     //  or broken down into up to 10 database transactions to allow the test sponsor
     //  the flexibility to implement the business transaction with the most efficient
     //  number of database transactions.
-    
-    // Delivering each order is done in the following steps:
-    int num_skipped = 0;
+
+    // Delivering each order is done in the following steps (one tx per district, retried until it commits):
     for (int d_id = 1; d_id <= 10; d_id++)
     {
-        tx_trans_init(ctx, trans);
-        
-        neworder_t* no; Select_undelivered_neworder(trans, w_id, d_id, &no);
-        // This select function can be optimized: we only need no_o_id
-        if (no == NULL)
-        {
-            tx_trans_commit(trans);  // ??? Didn't do anything in this tx, should we commit or abort?
-            num_skipped++;
-            continue;
-        }
-        Delete_neworder(trans, no);
-
-        order_t* o; Select_order(trans, w_id, d_id, no->no_o_id, &o);
-        o -> o_carrier_id = o_carrier_id;
-        Insert_order(trans, o);
-
-        struct tm cur_time = cur_local_time();
-        float o_ol_amount = 0;
-        for (int k = 0; k < 15; k++)
-        {
-            orderline_t* ol; Select_orderline(trans, w_id, d_id, no->no_o_id, k, &ol);
-            if (ol == NULL) break;  // end of orderlines in this order
-            ol->ol_delivery_d = new(struct tm); *ol->ol_delivery_d = cur_time;  // must be NULL before
-            o_ol_amount += ol->ol_amount;
-            Insert_orderline(trans, ol);
-        }
-
-        customer_t* c; Select_customer(trans, w_id, d_id, o->o_c_id, &c);
-        c->c_balance += o_ol_amount;
-        c->c_delivery_cnt++;
-        Insert_customer(trans, c);
-
-        tx_trans_commit(trans);
-        fprintf(delivery_tx_result_fp, " D: %d, O: %d\n", d_id, o->o_id);
+        int o_id;
+        while (trans_deliver_district(term, w_id, d_id, o_carrier_id, &o_id) == failed);
+        if (term->delivery_log != NULL && o_id >= 0) fprintf(term->delivery_log, " D: %d, O: %d\n", d_id, o_id);
+        // (districts w/o undelivered orders are skipped)
     }
 
-    tx_trans_destroy(trans);
-    fprintf(delivery_tx_result_fp, "Delivery tx completed time: %s\n", asc_local_time());
-    return num_skipped;
+    if (term->delivery_log != NULL)
+        fprintf(term->delivery_log, "Delivery tx completed time: %s\n", asc_time(time(NULL), now));
+    return committed;
 }
-void trans_stock_level(tx_ctx_t* ctx)
+tx_trans_result trans_stock_level(tpcc_terminal_t* term, const tpcc_txn_t* txn)
 {
-    int w_id, d_id, threshold;
-    fscanf(fp, "%d%d%d", &w_id, &d_id, &threshold);
+    int w_id = txn->w_id, d_id = txn->d_id, threshold = txn->stock_level.threshold;
 
-    tx_trans_t* trans = tx_trans_create(ctx);  tx_trans_init(ctx, trans);
+    tx_trans_t* trans = tx_rd_only_trans_create(term->ctx);  // (zero-copy reads)
 
-    district_t* d; Select_district(trans, w_id, d_id, &d);
-    int d_next_o_id = d -> d_next_o_id;
+    district_t d;  // (only its sequence is needed, see trans_new_order)
+    if (Read_district(term->ctx, w_id, d_id, &d) < 0) return tpcc_abort(term, trans, TPCC_STOCK_LEVEL);
+    int d_next_o_id = tx_seq_peek(d.d_o_id_seq);
 
     // EXEC SQL SELECT COUNT(DISTINCT (s_i_id)) INTO :stock_count
     // FROM order_line, stock
@@ -311,67 +326,219 @@ void trans_stock_level(tx_ctx_t* ctx)
     // ol_d_id=:d_id AND ol_o_id<:o_id AND
     // ol_o_id>=:o_id-20 AND s_w_id=:w_id AND
     // s_i_id=ol_i_id AND s_quantity < :threshold;
+    orderline_t* ols[20 * 15];
+    int ol_cnt = Select_orderlines(trans, w_id, d_id, d_next_o_id > 20 ? d_next_o_id - 20 : 0, d_next_o_id, ols, 20 * 15);
+
+    int i_ids[20 * 15], n_i_ids = 0;  // distinct ol_i_id
+    for (int k = 0; k < ol_cnt; k++)
+    {
+        int j = 0;
+        while (j < n_i_ids && i_ids[j] != ols[k]->ol_i_id) j++;
+        if (j == n_i_ids) i_ids[n_i_ids++] = ols[k]->ol_i_id;
+    }
+
     int cnt_low_stock = 0;
-    for (int o_id = d_next_o_id - 20; o_id < d_next_o_id; o_id++)
-        for (int ol_number = 0; ol_number < 15; ol_number++)
-        {
-            orderline_t* ol; Select_orderline(trans, w_id, d_id, o_id, ol_number, &ol);
-            // TODO: record **distinct** ol_i_id
-            stock_t* s; Select_stock(trans, w_id, ol->ol_i_id, &s);
-            if (s -> s_quantity < threshold) cnt_low_stock++;
-        }
+    for (int k = 0; k < n_i_ids; k++)
+    {
+        stock_t* s; Select_stock(trans, w_id, i_ids[k], &s);
+        if (s == NULL) return tpcc_abort(term, trans, TPCC_STOCK_LEVEL);
+        if (s -> s_quantity < threshold) cnt_low_stock++;
+    }
 
-    tx_trans_commit(trans);  tx_trans_destroy(trans);
+    return tpcc_commit(term, trans, TPCC_STOCK_LEVEL);
 }
 
-typedef struct trans_delivery_t
+void trans_prefetch(tx_ctx_t* ctx, const tpcc_txn_t* txn, int stage)
 {
-    time_t enq_time;
-    int w_id;
-    int o_carrier_id;
-} trans_delivery_t;  // Used to store delivery tx for deferred execution
+    uint32_t rows = stage > 0;  // (0 --> the index entries)
+    tpcc_key_t key;
+    switch (txn->type)
+    {
+        case TPCC_NEW_ORDER:
+            Get_prikey_warehouse(&key, txn->w_id); Prefetch(ctx, &key, rows * sizeof(warehouse_t));
+            Get_prikey_district(&key, txn->w_id, txn->d_id); Prefetch(ctx, &key, rows * sizeof(district_t));
+            Get_prikey_customer(&key, txn->w_id, txn->d_id, txn->new_order.c_id); Prefetch(ctx, &key, rows * sizeof(customer_t));
+            for (int k = 0; k < txn->new_order.ol_cnt; k++)  // (the stocks are prefetched by the tx itself)
+            {
+                Get_prikey_item(&key, txn->new_order.ol[k].ol_i_id);
+                Prefetch(ctx, &key, rows * sizeof(item_t));
+            }
+            break;
+        case TPCC_PAYMENT:
+            Get_prikey_warehouse(&key, txn->w_id); Prefetch(ctx, &key, rows * sizeof(warehouse_t));
+            Get_prikey_district(&key, txn->w_id, txn->d_id); Prefetch(ctx, &key, rows * sizeof(district_t));
+            if (txn->payment.byname != 1)
+            {
+                Get_prikey_customer(&key, txn->payment.c_w_id, txn->payment.c_d_id, txn->payment.c_id);
+                Prefetch(ctx, &key, rows * sizeof(customer_t));
+            }
+            break;
+        case TPCC_ORDER_STATUS:
+            if (txn->order_status.byname != 1)
+            {
+                Get_prikey_customer(&key, txn->w_id, txn->d_id, txn->order_status.c_id);
+                Prefetch(ctx, &key, rows * sizeof(customer_t));
+            }
+            break;
+        case TPCC_STOCK_LEVEL:
+            Get_prikey_district(&key, txn->w_id, txn->d_id); Prefetch(ctx, &key, rows * sizeof(district_t));
+            break;
+        default: break;  // (deliveries scan)
+    }
+}
 
-void process_trans_from_trace(void)
+void trans_run(tpcc_terminal_t* term, const tpcc_txn_t* txn)
 {
-    tx_ctx_t* ctx = new(tx_ctx_t);
-    tx_ctx_init(ctx);
-    fp = fopen("trans_trace.txt", "r");
-    delivery_tx_result_fp = fopen("delivery_tx_result.txt", "w");
-
-    int trans_type;
-    static trans_delivery_t que[10001]; int qtop = 0; // queue for deferred execution
-    time_t enq_time;  // enqueue time
-    int w_id, o_carrier_id;  // for delivery tx
-    while (fscanf(fp, "%d", &trans_type) != EOF)
-        switch (trans_type)
-        {
-            case 1: trans_new_order(ctx); break;
-            case 2: trans_payment(ctx); break;
-            case 3: trans_order_status(ctx); break;
-            case 4:  // Deferred Execution 
-                fscanf(fp, "%d%d", &w_id, &o_carrier_id);
-                enq_time = time(NULL);
-                que[qtop++] = (trans_delivery_t){enq_time, w_id, o_carrier_id};
-                break;
-            case 5: trans_stock_level(ctx); break;
-            default: puts("Error!");
-        }
+    static tx_trans_result (*const trans_fn[TPCC_NUM_TXN_TYPES])(tpcc_terminal_t*, const tpcc_txn_t*) = {
+        [TPCC_NEW_ORDER]    = trans_new_order,
+        [TPCC_PAYMENT]      = trans_payment,
+        [TPCC_ORDER_STATUS] = trans_order_status,
+        [TPCC_DELIVERY]     = trans_delivery,
+        [TPCC_STOCK_LEVEL]  = trans_stock_level
+    };
+    while (trans_fn[txn->type](term, txn) == failed);  // (the failed commits are counted by each tx)
+    term->stats.committed[txn->type]++;
+}
 
-    int skipped_districts = 0;
-    for (int i = 0; i < qtop; i++)
-        skipped_districts += trans_delivery(ctx, que[i].enq_time, que[i].w_id, que[i].o_carrier_id);
-    fprintf(delivery_tx_result_fp, "%s\n", asc_local_time());
+//////////////////////////////
+// Transaction Input Generation
+//////////////////////////////
 
-    tx_ctx_destroy(ctx);
-    fclose(fp); fclose(delivery_tx_result_fp);
+static inline int gen_remote_warehouse(int w_id, int n_warehouse)
+// a warehouse other than w_id, selected at random (n_warehouse > 1)
+{
+    int w = Random(1, n_warehouse - 1);
+    return w < w_id ? w : w + 1;
 }
+static inline void gen_customer(int* byname, int* c_id, char* c_last)
+// The customer is randomly selected 60% of the time by last name (y <= 60)
+//  and 40% of the time by number (y > 60).
+{
+    if (Random(1, 100) <= 60) { *byname = 1; *c_id = -1; gen_rand_lastname(c_last, -1); }
+    else { *byname = 2; *c_id = nurand(1023, 1, 3000); c_last[0] = 0; }
+}
+int tpcc_remote_ol_pct = 1, tpcc_remote_payment_pct = 15;
 
-int main(void)
+void gen_trans(tpcc_txn_t* txn, tpcc_txn_type_t type, int w_id, int n_warehouse)
 {
-    srand(time(NULL));
-    init_db_population(1);
+    txn->type = type;
+    txn->w_id = w_id;
+    // For any given terminal, the home warehouse number (W_ID) is constant
+    //  over the whole measurement interval
+    txn->d_id = Random(1, 10);
+    // The district number (D_ID) is randomly selected within [1 .. 10] from
+    //  the home warehouse (D_W_ID = W_ID).
+
+    switch (type)
+    {
+        case TPCC_NEW_ORDER:
+        {
+            txn->new_order.c_id = nurand(1023, 1, 3000);
+            int ol_cnt = txn->new_order.ol_cnt = Random(5, 15);
+            int rbk = Random(1, 100);
+            // A fixed 1% of the New-Order transactions are chosen at random
+            //  to simulate user data entry errors and exercise the performance of
+            //  **rolling back** update transactions.
+            for (int k = 0; k < ol_cnt; k++)
+            {
+                tpcc_order_line_in_t* ol = &txn->new_order.ol[k];
+                ol->ol_i_id = rbk == 1 && k == ol_cnt - 1 ? 0 : nurand(8191, 1, 100000);
+                // If this is the last item on the order and rbk = 1, then the item number is set to an unused value.
+                ol->ol_supply_w_id = n_warehouse == 1 || Random(1, 100) > tpcc_remote_ol_pct ?
+                                     w_id : gen_remote_warehouse(w_id, n_warehouse);
+                // A supplying warehouse number (OL_SUPPLY_W_ID) is selected as
+                //  the home warehouse 99% of the time and as a remote warehouse 1%
+                //  of the time.
+                ol->ol_quantity = Random(1, 10);
+            }
+            break;
+        }
+        case TPCC_PAYMENT:
+            if (n_warehouse == 1 || Random(1, 100) > tpcc_remote_payment_pct)
+            {
+                txn->payment.c_d_id = txn->d_id;
+                txn->payment.c_w_id = w_id;
+            }
+            else {
+                txn->payment.c_d_id = Random(1, 10);
+                txn->payment.c_w_id = gen_remote_warehouse(w_id, n_warehouse);
+            }
+            // The customer resident warehouse is the home warehouse 85% of the time
+            //  and is a randomly selected remote warehouse 15% of the time.
+            txn->payment.h_amount = Random(100, 500000) / 100.0;
+            gen_customer(&txn->payment.byname, &txn->payment.c_id, txn->payment.c_last);
+            break;
+        case TPCC_ORDER_STATUS:
+            gen_customer(&txn->order_status.byname, &txn->order_status.c_id, txn->order_status.c_last);
+            break;
+        case TPCC_DELIVERY:
+            txn->delivery.o_carrier_id = Random(1, 10);
+            txn->delivery.enq_time = time(NULL);
+            break;
+        case TPCC_STOCK_LEVEL:
+            txn->stock_level.threshold = Random(10, 20);
+            // The threshold of minimum quantity in stock (threshold) is selected at random within [10 .. 20].
+            break;
+        default: break;
+    }
+}
+
+#define TRANS_REC_LEN(input) TX_TRACE_REC_LEN(offsetof(tpcc_txn_t, input) + sizeof(((tpcc_txn_t*) 0)->input))
+static const uint32_t trans_rec_lens[TPCC_NUM_TXN_TYPES] = {
+    [TPCC_NEW_ORDER]    = TRANS_REC_LEN(new_order),
+    [TPCC_PAYMENT]      = TRANS_REC_LEN(payment),
+    [TPCC_ORDER_STATUS] = TRANS_REC_LEN(order_status),
+    [TPCC_DELIVERY]     = TRANS_REC_LEN(delivery),
+    [TPCC_STOCK_LEVEL]  = TRANS_REC_LEN(stock_level)
+};
 
-    process_trans_from_trace();
+uint32_t trans_rec_len(tpcc_txn_type_t type)
+{
+    return (unsigned) type < TPCC_NUM_TXN_TYPES ? trans_rec_lens[type] : 0;
+}
 
-    return 0;
+int read_trans(FILE* trace, tpcc_txn_t* txn)
+{
+    int type;
+    if (fscanf(trace, "%d", &type) != 1) return 0;
+    txn->type = type;
+    switch (type)
+    {
+        case TPCC_NEW_ORDER:
+            // transaction type, w_id, d_id, c_id, ol_cnt
+            //  - (order line 1) ol_i_id, ol_supply_w_id, ol_quantity
+            //  ...
+            fscanf(trace, "%d%d%d%d", &txn->w_id, &txn->d_id, &txn->new_order.c_id, &txn->new_order.ol_cnt);
+            for (int k = 0; k < txn->new_order.ol_cnt; k++)
+            {
+                tpcc_order_line_in_t* ol = &txn->new_order.ol[k];
+                fscanf(trace, "%d%d%d", &ol->ol_i_id, &ol->ol_supply_w_id, &ol->ol_quantity);
+            }
+            return 1;
+        case TPCC_PAYMENT:
+            // transaction type, w_id, d_id, c_w_id, c_d_id, h_amount, mode of selection, c_id / c_last_name
+            fscanf(trace, "%d%d%d%d%f%d", &txn->w_id, &txn->d_id, &txn->payment.c_w_id, &txn->payment.c_d_id,
+                   &txn->payment.h_amount, &txn->payment.byname);
+            if (txn->payment.byname == 1) fscanf(trace, "%16s", txn->payment.c_last);
+            else fscanf(trace, "%d", &txn->payment.c_id);
+            return 1;
+        case TPCC_ORDER_STATUS:
+            // transaction type, w_id, d_id, mode of selection, c_id / c_last_name
+            fscanf(trace, "%d%d%d", &txn->w_id, &txn->d_id, &txn->order_status.byname);
+            if (txn->order_status.byname == 1) fscanf(trace, "%16s", txn->order_status.c_last);
+            else fscanf(trace, "%d", &txn->order_status.c_id);
+            return 1;
+        case TPCC_DELIVERY:
+            // transaction type, w_id, o_carrier_id
+            fscanf(trace, "%d%d", &txn->w_id, &txn->delivery.o_carrier_id);
+            txn->delivery.enq_time = time(NULL);
+            return 1;
+        case TPCC_STOCK_LEVEL:
+            // transaction type, w_id, d_id, threshold
+            fscanf(trace, "%d%d%d", &txn->w_id, &txn->d_id, &txn->stock_level.threshold);
+            return 1;
+        default:
+            puts("Error!");
+            return 0;
+    }
 }
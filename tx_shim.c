@@ -6,7 +6,23 @@
 #include <memory.h>
 #include <assert.h>
 #include <stdio.h>
+#include <sched.h>
 #include "tx_shim.h"
+#include "tx_shim_slab.h"
+#include "tx_shim_stats.h"
+
+/////////////////////////
+/// Enum to str literals
+////////////////////////
+const char* tx_trans_type_str  [] = { [TX_READ_ONLY] = "TX_READ_ONLY", [TX_UPDATE] = "TX_UPDATE"};
+const char* tx_trans_result_str[] = { [committed] = "committed", [failed] = "failed"};
+const char* tx_op_type_str     [] = { [ALLOCATE] = "ALLOCATE", [READ] = "READ",
+                                      [UPDATE] = "UPDATE", [TO_DELETE] = "TO_DELETE",
+                                      [DELETED] = "DELETED", [ADD] = "ADD"};
+const char* tx_op_result_str   [] = { [successful] = "successful", [successfully_buffered] = "successfully_buffered",
+                                      [non_existent] = "non_existent", [err_other] = "err_other",
+                                      [err_exceeds_internal_allocated_space] = "err_exceeds_internal_allocated_space",
+                                      [err_exceeds_provided_allocated_space] = "err_exceeds_provided_allocated_space" };
 
 void tx_trans_init(tx_ctx_t *tx_ctx, tx_trans_t* trans)
 {
@@ -14,38 +30,194 @@ void tx_trans_init(tx_ctx_t *tx_ctx, tx_trans_t* trans)
     trans->state = TX_FREE;
     trans->parent = tx_ctx;
     trans->curr_num_objs_in_tx = 0;
+    trans->max_objs_in_tx = TX_TRANS_INIT_OBJS;
+    trans->obj_ids = malloc(TX_TRANS_INIT_OBJS * sizeof(tx_bufed_obj_id));
+    trans->idx_epoch = 1;
+    trans->idx_mask = 4 * TX_TRANS_INIT_OBJS - 1;
+    trans->idx = calloc(trans->idx_mask + 1, sizeof(tx_trans_idx_slot_t));
+    trans->num_ranges = 0;
+    trans->max_ranges = 0;
+    trans->ranges = NULL;
+    trans->arena.head = NULL; // chunks are allocated on first use
+    __tx_arena_reset(&trans->arena);
 }
 
-void tx_ctx_init(tx_ctx_t* tx_ctx /*....*/)
+void* __tx_arena_alloc_slow(tx_arena_t* arena, uint32_t len)
 {
-    tx_ctx->tx_ids = 0;
-    for(int i = 0; i < MAX_CONCUR_TX; ++i){
-        tx_trans_init(tx_ctx, &tx_ctx->trans_arr[i]);
+    // move to the next chunk (kept from previous txs) if it fits, otherwise link a new one after curr
+    tx_arena_chunk_t* next = arena->curr == NULL ? arena->head : arena->curr->next;
+    if(next == NULL || next->size < len){
+        uint32_t size = len > TX_ARENA_CHUNK_SIZE ? len : TX_ARENA_CHUNK_SIZE;
+        tx_arena_chunk_t* chunk = malloc(sizeof(tx_arena_chunk_t) + size);
+        chunk->size = size;
+        chunk->next = next;
+        if(arena->curr == NULL) { arena->head = chunk; }
+        else { arena->curr->next = chunk; }
+        next = chunk;
     }
+    arena->curr = next;
+    arena->used = len;
+    return next->data;
 }
 
-tx_trans_t* tx_trans_create(tx_ctx_t *tx_ctx)
+static void __tx_arena_free(tx_arena_t* arena)
 {
-    int tx_idx = -1;
-    for(int i = 0; i < MAX_CONCUR_TX; ++i){
-        if(tx_ctx->trans_arr[i].state == TX_FREE) {
-            tx_idx = i;
-            break;
+    while(arena->head != NULL){
+        tx_arena_chunk_t* next = arena->head->next;
+        free(arena->head);
+        arena->head = next;
+    }
+    __tx_arena_reset(arena);
+}
+
+static const tx_kvs_ops_t* tx_kvs_backends[] = { &tx_kvs_ht_ops, &tx_kvs_skiplist_ops };
+
+const tx_kvs_ops_t* tx_kvs_ops_by_name(const char* name)
+{
+    for(size_t i = 0; i < sizeof(tx_kvs_backends) / sizeof(tx_kvs_backends[0]); ++i){
+        if(strcmp(tx_kvs_backends[i]->name, name) == 0) { return tx_kvs_backends[i]; }
+    }
+    return NULL;
+}
+
+//////////////////////////////////////////////////////////////////////////
+/// Epoch-based reclamation
+//////////////////////////////////////////////////////////////////////////
+
+/// Objs / nodes removed by a committed tx (or a backend) may still be accessed by the active txs of other ctxs:
+/// -- a ctx announces the global epoch when its first active tx starts and goes quiescent when its last one ends
+/// -- removed ptrs are appended (w/ the current global epoch) to the limbo list of the ctx that removed them
+/// -- the global epoch advances once every active ctx has announced it, so ptrs retired at epoch e
+///    cannot be reached by any active tx once the global epoch reaches e + 2
+/// Limbo lists are reclaimed in batches (when full) so frees are mostly off the commit path.
+
+volatile uint64_t tx_global_epoch = 0;
+static tx_ctx_t* volatile tx_ctxs[TX_MAX_THREADS]; // by thread_id (NULL if free, i.e., ids of destroyed ctxs are reused)
+static volatile uint16_t tx_num_thread_ids = 0;    // 1 + the largest thread_id ever claimed (i.e., scans stop there)
+static uint64_t tx_thread_tx_ids[TX_MAX_THREADS];  // tx_ids of the last ctx of each thread_id (tx ids stay unique)
+static __thread tx_ctx_t* tx_thread_ctx = NULL;    // ctx of the calling thread (used by the backends)
+
+static uint64_t __tx_epoch_try_advance(void)
+{
+    uint64_t global_epoch = tx_global_epoch;
+    for(int i = 0; i < tx_num_thread_ids; ++i){
+        tx_ctx_t* tx_ctx = tx_ctxs[i];
+        if(tx_ctx == NULL) { continue; }
+        uint64_t local_epoch = tx_ctx->epoch.local_epoch;
+        if(local_epoch != TX_EPOCH_QUIESCENT && local_epoch != global_epoch) { return global_epoch; }
+    }
+    __sync_bool_compare_and_swap(&tx_global_epoch, global_epoch, global_epoch + 1);
+    return tx_global_epoch;
+}
+
+static inline uint8_t __tx_epoch_all_quiescent(void)
+{
+    for(int i = 0; i < tx_num_thread_ids; ++i){
+        tx_ctx_t* tx_ctx = tx_ctxs[i];
+        if(tx_ctx != NULL && tx_ctx->epoch.local_epoch != TX_EPOCH_QUIESCENT) { return 0; }
+    }
+    return 1;
+}
+
+static void __tx_epoch_reclaim(tx_ctx_t* tx_ctx)
+{
+    tx_epoch_t* epoch = &tx_ctx->epoch;
+    uint64_t global_epoch = __tx_epoch_try_advance();
+
+    uint32_t freed = 0;
+    while(freed < epoch->num_retired && epoch->retired[freed].epoch + 2 <= global_epoch){
+        tx_slab_free(epoch->retired[freed++].ptr);
+    }
+    epoch->num_retired -= freed;
+    memmove(epoch->retired, &epoch->retired[freed], epoch->num_retired * sizeof(tx_retired_t));
+}
+
+void __tx_epoch_retire(tx_ctx_t* tx_ctx, void* ptr)
+{
+    if(tx_ctx == NULL) { tx_ctx = tx_thread_ctx; }
+    if(tx_ctx == NULL){ // a thread w/o a ctx (i.e., kvs used w/o the shim, e.g., to populate it) has no limbo list:
+        // freed right away, so no txs may run on the kvs meanwhile
+        assert(__tx_epoch_all_quiescent());
+        tx_slab_free(ptr);
+        return;
+    }
+
+    tx_epoch_t* epoch = &tx_ctx->epoch;
+    if(epoch->num_retired == epoch->max_retired){
+        __tx_epoch_reclaim(tx_ctx);
+        if(epoch->num_retired > epoch->max_retired / 2){ // long-running txs hold back reclamation
+            epoch->max_retired *= 2;
+            epoch->retired = realloc(epoch->retired, epoch->max_retired * sizeof(tx_retired_t));
         }
     }
+    epoch->retired[epoch->num_retired].ptr = ptr;
+    epoch->retired[epoch->num_retired].epoch = tx_global_epoch;
+    epoch->num_retired++;
+}
 
-    if(tx_idx == -1){
-        return NULL; // no free tx buffs
+// claims the smallest free thread_id (i.e., publishes the ctx to the epoch scans -- its epoch must be initialized)
+static uint16_t __tx_thread_id_claim(tx_ctx_t* tx_ctx)
+{
+    for(uint16_t id = 0; id < TX_MAX_THREADS; ++id){
+        if(__atomic_load_n(&tx_ctxs[id], __ATOMIC_ACQUIRE) != NULL ||
+           !__sync_bool_compare_and_swap(&tx_ctxs[id], NULL, tx_ctx)) { continue; }
+        uint16_t num_ids = __atomic_load_n(&tx_num_thread_ids, __ATOMIC_ACQUIRE);
+        while(num_ids <= id && !__atomic_compare_exchange_n(&tx_num_thread_ids, &num_ids, id + 1, 0,
+                                                            __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) { }
+        return id;
     }
+    printf("ERROR: more than %d ctxs exist at the same time!\n", TX_MAX_THREADS);
+    abort();
+}
 
-    // TODO needs a lock!
-    // LOCK
-    tx_ctx->trans_arr[tx_idx].tx_id = tx_ctx->tx_ids++;
-    // UNLOCK
+//////////////////////////////////////////////////////////////////////////
 
-    tx_ctx->trans_arr[tx_idx].state = TX_DYN_READ_ONLY;
+// must be called by the thread that uses the ctx; the kvs may be shared by the ctxs of many threads
+void tx_ctx_init(tx_ctx_t* tx_ctx, const tx_kvs_ops_t* kvs_ops, void* kvs /*....*/)
+{
+    tx_ctx->kvs_ops = kvs_ops;
+    tx_ctx->kvs = kvs;
+    tx_ctx->exclusive = 0;
+    tx_ctx->free_trans = NULL;
+    for(int i = MAX_CONCUR_TX - 1; i >= 0; --i){
+        tx_trans_init(tx_ctx, &tx_ctx->trans_arr[i]);
+        tx_ctx->trans_arr[i].next_free = tx_ctx->free_trans;
+        tx_ctx->free_trans = &tx_ctx->trans_arr[i];
+    }
+
+    tx_ctx->epoch.local_epoch = TX_EPOCH_QUIESCENT;
+    tx_ctx->epoch.active_txs = 0;
+    tx_ctx->epoch.num_retired = 0;
+    tx_ctx->epoch.max_retired = TX_EPOCH_BATCH;
+    tx_ctx->epoch.retired = malloc(TX_EPOCH_BATCH * sizeof(tx_retired_t));
+    tx_ctx->thread_id = __tx_thread_id_claim(tx_ctx);
+    tx_ctx->tx_ids = tx_thread_tx_ids[tx_ctx->thread_id];
+    tx_thread_ctx = tx_ctx;
+#ifdef TX_STATS
+    tx_ctx->stats = tx_stats_create();
+#else
+    tx_ctx->stats = NULL;
+#endif
+}
+
+tx_trans_t* tx_trans_create(tx_ctx_t *tx_ctx)
+{
+    tx_trans_t* trans = tx_ctx->free_trans;
+    if(trans == NULL){
+        TX_STATS_INC(tx_ctx, trans_exhausted);
+        return NULL; // no free tx buffs
+    }
+    tx_ctx->free_trans = trans->next_free;
+
+    // no contention: ids are only unique per ctx and tagged w/ its thread id
+    trans->tx_id = (++tx_ctx->tx_ids << TX_THREAD_ID_BITS) | tx_ctx->thread_id;
+    trans->state = TX_DYN_READ_ONLY;
+    __tx_epoch_enter(tx_ctx);
+#ifdef TX_STATS
+    trans->start_tsc = __tx_rdtsc();
+#endif
 
-    return &tx_ctx->trans_arr[tx_idx];
+    return trans;
 }
 
 // read-only tx known a priory
@@ -59,19 +231,42 @@ tx_trans_t* tx_rd_only_trans_create(tx_ctx_t *tx_ctx)
 }
 
 
-void tx_trans_abort_n_clear(tx_trans_t* trans)
+static inline void __tx_trans_clear(tx_trans_t* trans)
+{
+    if(trans->state == TX_FREE) { return; } // already in the free list
+
+    __tx_epoch_exit(trans->parent);
+    trans->tx_id = 0;
+    trans->state = TX_FREE;
+    trans->next_free = trans->parent->free_trans;
+    trans->parent->free_trans = trans;
+    trans->curr_num_objs_in_tx = 0;
+    trans->num_ranges = 0;
+    trans->max_ranges = 0; // (ranges are in the arena)
+    __tx_arena_reset(&trans->arena);
+    if(++trans->idx_epoch == 0){ // epoch wrapped around --> stale slots could look valid
+        trans->idx_epoch = 1;
+        memset(trans->idx, 0, (trans->idx_mask + 1) * sizeof(tx_trans_idx_slot_t));
+    }
+}
+
+static void __tx_trans_abort(tx_trans_t* trans)
 {
     for(int i = 0; i < trans->curr_num_objs_in_tx; ++i){
         if(trans->obj_ids[i].is_mem &&
-           !trans->obj_ids[i].existed_prior_tx)
+           trans->obj_ids[i].type == ALLOCATE) // DELETED objs are already retired
         {
-            free(trans->obj_ids[i].obj_ptr);
+            tx_single_obj_free(trans->parent, trans->obj_ids[i].obj_ptr);
         }
     }
 
-    trans->tx_id = 0;
-    trans->state = TX_FREE;
-    trans->curr_num_objs_in_tx = 0;
+    __tx_trans_clear(trans);
+}
+
+void tx_trans_abort_n_clear(tx_trans_t* trans)
+{
+    if(trans->state != TX_FREE) { TX_STATS_ABORT(trans->parent, TX_ABORT_USER); }
+    __tx_trans_abort(trans);
 }
 
 void tx_trans_destroy(tx_trans_t* trans)
@@ -81,11 +276,28 @@ void tx_trans_destroy(tx_trans_t* trans)
 
 void tx_ctx_destroy(tx_ctx_t *tx_ctx)
 {
-    // no alloced objs atm so just clear things
-    tx_ctx->tx_ids = 0;
     for(int i = 0; i < MAX_CONCUR_TX; ++i){
-        tx_trans_abort_n_clear(&tx_ctx->trans_arr[i]);
+        tx_trans_t* trans = &tx_ctx->trans_arr[i];
+        __tx_trans_abort(trans);
+        __tx_arena_free(&trans->arena);
+        free(trans->obj_ids);
+        free(trans->idx);
+    }
+
+    // wait for the txs of other ctxs that may still access what this one retired
+    while(tx_ctx->epoch.num_retired > 0){
+        __tx_epoch_reclaim(tx_ctx);
+        if(tx_ctx->epoch.num_retired > 0) { sched_yield(); }
     }
+    free(tx_ctx->epoch.retired);
+    tx_thread_tx_ids[tx_ctx->thread_id] = tx_ctx->tx_ids;
+    tx_ctx->tx_ids = 0;
+    __atomic_store_n(&tx_ctxs[tx_ctx->thread_id], NULL, __ATOMIC_RELEASE); // (the thread_id is free again)
+#ifdef TX_STATS
+    tx_stats_free(tx_ctx->stats); // (merge them before destroying the ctx)
+    tx_ctx->stats = NULL;
+#endif
+    if(tx_thread_ctx == tx_ctx) { tx_thread_ctx = NULL; }
 }
 
 void __tx_trans_state_update(tx_trans_t* trans, uint8_t type){
@@ -100,11 +312,270 @@ void __tx_trans_state_update(tx_trans_t* trans, uint8_t type){
     }
 }
 
-tx_trans_result tx_trans_commit(tx_trans_t* trans){
-    //TODO
-    /// ~~~~ TX commit ~~~~~~
-    /// 1. Lock all ALLOCATE / UPDATE / TO_DELETE objects and check if versions are same --> <otherwise abort TX by releasing locks>
-    /// 2. Check with lock-free reads READS / DELETES that versions are same (or non-existant) --> <otherwise abort TX by releasing locks>
-    /// 3. apply UPDATES / ALLOCATES / TO_DELETE --> <TX is committed | unlock any locked objects>
+//////////////////////////////////////////////////////////////////////////
+/// Commit (Silo-style OCC -- no global lock)
+//////////////////////////////////////////////////////////////////////////
+
+static inline uint8_t __tx_obj_id_is_write(tx_bufed_obj_id* obj_id)
+{
+    return obj_id->type == UPDATE || obj_id->type == TO_DELETE;
+}
+
+// memory objs always use the header lock; kv items the one of the backend
+static inline uint8_t __tx_obj_id_lock(tx_trans_t* trans, tx_bufed_obj_id* obj_id)
+{
+    if(obj_id->is_mem) { return __tx_obj_try_lock(obj_id->int_obj_ptr); }
+    return __lock(trans->parent, obj_id->int_obj_ptr);
+}
+
+static inline void __tx_obj_id_unlock(tx_trans_t* trans, tx_bufed_obj_id* obj_id)
+{
+    if(obj_id->is_mem) { __tx_obj_unlock(obj_id->int_obj_ptr); return; }
+    __unlock(trans->parent, obj_id->int_obj_ptr);
+}
+
+static inline uint8_t __tx_obj_id_validate(tx_trans_t* trans, tx_bufed_obj_id* obj_id)
+{
+    if(obj_id->is_mem) {
+        return !__tx_obj_is_locked(obj_id->int_obj_ptr) &&
+               __tx_obj_version(obj_id->int_obj_ptr) == obj_id->version;
+    }
+    return __validate(trans->parent, obj_id->int_obj_ptr, obj_id->version);
+}
+
+// inserts a locked placeholder for a new kv item -- fails if the key was inserted by another tx in the meantime
+// (or the kvs is full)
+static inline uint8_t __tx_obj_id_insert(tx_trans_t* trans, tx_bufed_obj_id* obj_id)
+{
+    assert(!obj_id->is_mem && obj_id->type == UPDATE);
+    obj_id->int_obj_ptr = __insert(trans->parent, obj_id->kv.key, obj_id->kv.key_len,
+                                   obj_id->buf->hdr.curr_len, trans->tx_id);
+    if(obj_id->int_obj_ptr == NULL){
+        TX_STATS_CONFLICT_OBJ(trans->parent, TX_ABORT_LOCK, obj_id);
+        return 0;
+    }
+    obj_id->is_locked = 1;
+    return 1;
+}
+
+// releases the locks (and removes the placeholders of inserts) of a failed commit
+static void __tx_trans_unlock_objs(tx_trans_t* trans)
+{
+    for(int i = 0; i < trans->curr_num_objs_in_tx; ++i){
+        tx_bufed_obj_id* obj_id = &trans->obj_ids[i];
+        if(!obj_id->is_locked) { continue; }
+
+        if(!obj_id->is_mem && !obj_id->existed_prior_tx){
+            __del(trans->parent, obj_id->kv.key, obj_id->kv.key_len);
+            obj_id->int_obj_ptr = NULL;
+        }else{
+            __tx_obj_id_unlock(trans, obj_id);
+        }
+        obj_id->is_locked = 0;
+    }
+}
+
+// order in which ADD objs are locked: mem objs by address and then kv items by key
+// (i.e., not by item, since a kv item may be replaced while waiting for its lock)
+static inline int __tx_obj_id_lock_order(tx_bufed_obj_id* a, tx_bufed_obj_id* b)
+{
+    if(a->is_mem != b->is_mem) { return a->is_mem ? -1 : 1; }
+    if(a->is_mem) { return a->obj_ptr < b->obj_ptr ? -1 : a->obj_ptr > b->obj_ptr; }
+    if(a->kv.key_len != b->kv.key_len) { return a->kv.key_len < b->kv.key_len ? -1 : 1; }
+    return memcmp(a->kv.key, b->kv.key, a->kv.key_len);
+}
+
+// 1a. lock ADD objs -- waiting for (instead of failing on) locked ones, which is deadlock-free as only ADD locks
+//     are waited for, before any other lock of the tx is acquired and in the same order by every tx
+static uint8_t __tx_trans_lock_adds(tx_trans_t* trans)
+{
+    int num_adds = 0;
+    for(int i = 0; i < trans->curr_num_objs_in_tx; ++i){
+        if(trans->obj_ids[i].type == ADD) { num_adds++; }
+    }
+    if(num_adds == 0) { return 1; }
+
+    tx_bufed_obj_id** adds = __tx_arena_alloc(&trans->arena, num_adds * sizeof(tx_bufed_obj_id*));
+    int n = 0;
+    for(int i = 0; i < trans->curr_num_objs_in_tx; ++i){ // (insertion sort -- a tx has a few ADDs)
+        if(trans->obj_ids[i].type != ADD) { continue; }
+        int j = n++;
+        for(; j > 0 && __tx_obj_id_lock_order(adds[j - 1], &trans->obj_ids[i]) > 0; --j) { adds[j] = adds[j - 1]; }
+        adds[j] = &trans->obj_ids[i];
+    }
+
+    for(int i = 0; i < num_adds; ++i){
+        tx_bufed_obj_id* obj_id = adds[i];
+        while(!__tx_obj_id_lock(trans, obj_id)){
+            if(obj_id->is_mem && __tx_obj_is_retired(obj_id->int_obj_ptr)){ // freed by another tx
+                TX_STATS_CONFLICT_OBJ(trans->parent, TX_ABORT_VALIDATION, obj_id);
+                return 0;
+            }
+            if(!obj_id->is_mem){ // replaced / removed items stay locked --> re-look up the key
+                obj_id->int_obj_ptr = __lookup(trans->parent, obj_id->kv.key, obj_id->kv.key_len);
+                if(obj_id->int_obj_ptr == NULL){
+                    TX_STATS_CONFLICT_OBJ(trans->parent, TX_ABORT_VALIDATION, obj_id);
+                    return 0;
+                }
+            }
+            TX_CPU_RELAX();
+        }
+        obj_id->is_locked = 1;
+
+        // the value may have shrunk in the meantime
+        for(tx_trans_delta_t* delta = obj_id->deltas; delta != NULL; delta = delta->next){
+            if(delta->offset + delta->len > obj_id->int_obj_ptr->hdr.curr_len){
+                TX_STATS_CONFLICT_OBJ(trans->parent, TX_ABORT_VALIDATION, obj_id);
+                return 0;
+            }
+        }
+    }
+    return 1;
+}
+
+// 1b. lock and check versions of UPDATE / TO_DELETE objs (or insert a locked placeholder for new kv items)
+static uint8_t __tx_trans_lock_phase(tx_trans_t* trans)
+{
+    if(!__tx_trans_lock_adds(trans)) { return 0; }
+
+    for(int i = 0; i < trans->curr_num_objs_in_tx; ++i){
+        tx_bufed_obj_id* obj_id = &trans->obj_ids[i];
+        if(!__tx_obj_id_is_write(obj_id)) { continue; }
+
+        if(!obj_id->existed_prior_tx){ // (TO_DELETE of a non-existent key is converted to DELETED when opened)
+            if(!__tx_obj_id_insert(trans, obj_id)) { return 0; }
+            continue;
+        }
+
+        if(!__tx_obj_id_lock(trans, obj_id)){
+            TX_STATS_CONFLICT_OBJ(trans->parent, TX_ABORT_LOCK, obj_id);
+            return 0;
+        }
+        obj_id->is_locked = 1;
+        if(__tx_obj_version(obj_id->int_obj_ptr) != obj_id->version){
+            TX_STATS_CONFLICT_OBJ(trans->parent, TX_ABORT_VALIDATION, obj_id);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// 2. check (lock-free) that READs are not locked by others and their versions (or non-existence) remain the same
+//    and that the ranges scanned by the tx have the same items (no phantoms)
+static uint8_t __tx_trans_validate_phase(tx_trans_t* trans)
+{
+    for(int i = 0; i < trans->curr_num_objs_in_tx; ++i){
+        tx_bufed_obj_id* obj_id = &trans->obj_ids[i];
+        if(obj_id->type != READ && obj_id->type != DELETED) { continue; }
+
+        if(!obj_id->existed_prior_tx){
+            // kv items that did not exist must not have been inserted in the meantime
+            if(!obj_id->is_mem && __lookup(trans->parent, obj_id->kv.key, obj_id->kv.key_len) != NULL){
+                TX_STATS_CONFLICT_OBJ(trans->parent, TX_ABORT_VALIDATION, obj_id);
+                return 0;
+            }
+            continue;
+        }
+        if(obj_id->type == DELETED) { continue; } // alloced and freed within the tx
+
+        if(!__tx_obj_id_validate(trans, obj_id)){
+            TX_STATS_CONFLICT_OBJ(trans->parent, TX_ABORT_VALIDATION, obj_id);
+            return 0;
+        }
+    }
+    return __tx_trans_validate_ranges(trans); // phantoms
+}
+
+// 1. (exclusive) only insert the placeholders of new kv items, i.e., no other obj is locked
+static uint8_t __tx_trans_insert_phase(tx_trans_t* trans)
+{
+    for(int i = 0; i < trans->curr_num_objs_in_tx; ++i){
+        tx_bufed_obj_id* obj_id = &trans->obj_ids[i];
+        if(!__tx_obj_id_is_write(obj_id) || obj_id->existed_prior_tx) { continue; }
+        if(!__tx_obj_id_insert(trans, obj_id)) { return 0; }
+    }
+    return 1;
+}
+
+// 3. apply ALLOCATES / UPDATES / ADDS / TO_DELETES and unlock
+//    (exclusive: only the placeholders of new kv items are locked -- see tx_trans_commit)
+static void __tx_trans_install_phase(tx_trans_t* trans, uint8_t exclusive)
+{
+    // allocated objs first: they are not visible to others until an update of this tx installs a ptr to them
+    for(int i = 0; i < trans->curr_num_objs_in_tx; ++i){
+        tx_bufed_obj_id* obj_id = &trans->obj_ids[i];
+        if(obj_id->type != ALLOCATE) { continue; }
+        memcpy(obj_id->int_obj_ptr->val, obj_id->buf->val, obj_id->buf->hdr.curr_len);
+        obj_id->int_obj_ptr->hdr.curr_len = obj_id->buf->hdr.curr_len;
+    }
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    for(int i = 0; i < trans->curr_num_objs_in_tx; ++i){
+        tx_bufed_obj_id* obj_id = &trans->obj_ids[i];
+        tx_internal_obj_val_t* obj_val = obj_id->buf;
+
+        switch(obj_id->type){
+            case ADD:
+            case UPDATE:
+                assert(exclusive || obj_id->is_locked);
+                if(obj_id->deltas != NULL){ // only the byte ranges written by tx_trans_kv_update_range / the adds
+                    __tx_obj_install_deltas(obj_id->int_obj_ptr, obj_id->deltas);
+                    if(obj_id->is_locked) { __tx_obj_id_unlock(trans, obj_id); }
+                }else if(obj_val->hdr.curr_len <= obj_id->int_obj_ptr->hdr.alloc_len){
+                    __tx_obj_install(obj_id->int_obj_ptr, obj_val->val, obj_val->hdr.curr_len);
+                    if(obj_id->is_locked) { __tx_obj_id_unlock(trans, obj_id); }
+                }else{
+                    // does not fit -- the backend replaces the (still locked) obj which is never unlocked
+                    // so that concurrent txs that opened it fail their validation
+                    assert(!obj_id->is_mem);
+                    __set(trans->parent, obj_id->kv.key, obj_id->kv.key_len, obj_val->val, obj_val->hdr.curr_len);
+                }
+                break;
+
+            case TO_DELETE:
+                if(obj_id->is_mem){
+                    __tx_obj_mark_retired(obj_id->int_obj_ptr);
+                    tx_single_obj_free(trans->parent, obj_id->obj_ptr);
+                }else{
+                    __del(trans->parent, obj_id->kv.key, obj_id->kv.key_len);
+                }
+                break;
+
+            default: // READ / DELETED (/ ALLOCATE)
+                break;
+        }
+        obj_id->is_locked = 0;
+    }
+}
+
+/// ~~~~ TX commit ~~~~~~
+/// 1. Lock all ADD (w/o checking versions) and ALLOCATE / UPDATE / TO_DELETE objects and check if versions are same
+///    --> <otherwise abort TX by releasing locks>
+/// 2. Check with lock-free reads READS / DELETES that versions are same (or non-existant)
+///    and that scanned ranges have the same items --> <otherwise abort TX by releasing locks>
+/// 3. apply UPDATES / ADDS / ALLOCATES / TO_DELETE --> <TX is committed | unlock any locked objects>
+// Locks other than those of ADDs are acquired w/o waiting (i.e., a tx fails instead of blocking) so no lock ordering
+// is needed for them.
+// Txs of an exclusive ctx (i.e., that hold the partitions of all their keys, see tx_shim_part.h) skip 2. and of 1.
+// only insert their new kv items (which fails only if the kvs is full).
+// Either way the trans is cleared and its slot is released.
+tx_trans_result tx_trans_commit(tx_trans_t* trans)
+{
+    assert(trans->state != TX_FREE);
+    TX_STATS_TSC(start_tsc);
+
+    uint8_t exclusive = trans->parent->exclusive;
+    if(exclusive ? !__tx_trans_insert_phase(trans)
+                 : !__tx_trans_lock_phase(trans) || !__tx_trans_validate_phase(trans)){
+        __tx_trans_unlock_objs(trans);
+        __tx_trans_abort(trans);
+        TX_STATS_RECORD(trans->parent, TX_STAT_ABORT, start_tsc);
+        return failed;
+    }
 
+    __tx_trans_install_phase(trans, exclusive);
+    __tx_trans_clear(trans);
+    TX_STATS_RECORD(trans->parent, TX_STAT_COMMIT, start_tsc);
+    TX_STATS_RECORD(trans->parent, TX_STAT_TX, trans->start_tsc);
+    return committed;
 }
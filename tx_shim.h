@@ -26,13 +26,19 @@
 /// 3. Port to traditional non-replicated Atomic commit protocols (optional!!)
 
 
-/// TODO Stats
-/// 0. Stats (runtime and logged) for throughput and latency of all and individual operations
+/// Stats
+/// 0. Latency histograms of txs and individual operations and abort causes per ctx (-DTX_STATS, see tx_shim_stats.h)
 
 #ifndef TX_SHIM_H
 #define TX_SHIM_H
 
 #include <stdint.h>
+#include <string.h>
+#include <assert.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
 
 
 #define TX_ADDR_NULL         0
@@ -75,28 +81,38 @@ typedef enum
 // UPDATE   --> DELETE
 // ALLOCATE --> has full access | can become a NOOP if followed by a DELETE
 // DELETE   --> assumption: it can be upgraded to nothing in the same TX
+// ADD      --> becomes an UPDATE if the obj is accessed otherwise by the same TX
 typedef enum
 {
     ALLOCATE,
     READ,      // check if version and tx_id that allocated object are same on commit
     UPDATE,    // READ + update and inc version (i.e., if obj exists on commit it does not necessarily fail)
     TO_DELETE,
-    DELETED    // NOOP // ALLOC --> DELETE in same tx
+    DELETED,   // NOOP // ALLOC --> DELETE in same tx
+    ADD        // commutative adds applied on commit w/o reading or validating the value (i.e., never conflict)
 } tx_op_type_t;
 
+// type of the field (and operand) of a commutative add (unsigned fields use the signed type of the same size)
+typedef enum
+{
+    TX_ADD_NONE, // (the delta overwrites the range, see tx_trans_kv_update_range)
+    TX_ADD_I8,
+    TX_ADD_I16,
+    TX_ADD_I32,
+    TX_ADD_I64,
+    TX_ADD_F32,
+    TX_ADD_F64
+} tx_add_type_t;
+
 
 /////////////////////////
 /// Enum to str literals
 ////////////////////////
-const char* tx_trans_type_str  [] = { [TX_READ_ONLY] = "TX_READ_ONLY", [TX_UPDATE] = "TX_UPDATE"};
-const char* tx_trans_result_str[] = { [committed] = "committed", [failed] = "failed"};
-const char* tx_op_type_str     [] = { [ALLOCATE] = "ALLOCATE", [READ] = "READ",
-                                      [UPDATE] = "UPDATE", [TO_DELETE] = "TO_DELETE",
-                                      [DELETED] = "DELETED"};
-const char* tx_op_result_str   [] = { [successful] = "successful", [successfully_buffered] = "successfully_buffered",
-                                      [non_existent] = "non_existent", [err_other] = "err_other",
-                                      [err_exceeds_internal_allocated_space] = "err_exceeds_internal_allocated_space",
-                                      [err_exceeds_provided_allocated_space] = "err_exceeds_provided_allocated_space" };
+// (defined in tx_shim.c)
+extern const char* tx_trans_type_str[];
+extern const char* tx_trans_result_str[];
+extern const char* tx_op_type_str[];
+extern const char* tx_op_result_str[];
 
 
 ///////////////////////////////
@@ -105,16 +121,20 @@ const char* tx_op_result_str   [] = { [successful] = "successful", [successfully
 
 #define MAX_KEY_LEN 64 // in bytes
 #define MAX_VAL_LEN 4096
-#define MAX_OBJ_IN_TX 64
-#define MAX_CONCUR_TX 16
+#define MAX_CONCUR_TX 64
+#define TX_THREAD_ID_BITS 8                    // tx ids are tagged w/ the (per tx_ctx_t) thread id
+#define TX_MAX_THREADS (1 << TX_THREAD_ID_BITS)
+#define TX_TRANS_INIT_OBJS 32             // initial capacity of objs opened by a tx (doubles when exceeded)
+#define TX_ARENA_CHUNK_SIZE (16 * 1024) // tx copies of values are bump-allocated from chunks of (at least) this size
 
 // object/kv header: state, allocated and current len, lock
+// (version first so that it is 4B aligned on the -- 64B aligned -- objs of the slab allocator)
 typedef struct
 {
-    uint8_t   lock;     // TODO add proper locking (e.g., seqlocks)
+    uint32_t version;   // seqlock: odd while a writer installs a new value (readers never write it)
+    uint8_t   lock;     // writer lock (CAS 0 --> 1 w/ acquire, release on unlock) or TX_OBJ_RETIRED
     uint16_t  curr_len; // w/o the object header
     uint16_t alloc_len; // w/o the object header
-    uint32_t version;
     uint32_t unique_alloc_id; // e.g., unique transaction id that allocates the object
 } __attribute__((packed)) tx_header_t;
 
@@ -129,7 +149,7 @@ typedef struct
 
 
 // Same as tx_internal_obj_val but with MAX_VAL_LEN for VAL
-// used to statically allocate tx temporary buffs for transactions
+// used to statically allocate temporary buffs (e.g., of single_* ops)
 typedef struct
 {
     tx_header_t hdr;
@@ -138,12 +158,29 @@ typedef struct
 
 
 
+// Byte range of a value written by tx_trans_kv_update_range or added to by tx_trans_*_add (in the arena of the tx)
+typedef struct _tx_trans_delta_t
+{
+    struct _tx_trans_delta_t* next; // (in write order)
+    uint32_t offset;
+    uint32_t len;
+    uint8_t  add_type;              // tx_add_type_t (TX_ADD_NONE --> data overwrites the range)
+    uint8_t  data[];                // (the operand of an add)
+} tx_trans_delta_t;
+
 // ID struct that uniquelly identifies (+ some meta) a bufed object/kv item opened by a tx
 typedef struct
 {
     uint8_t   is_mem;
+    uint8_t   is_partial;       // buf has the header but only the byte ranges of the value read / written by the tx
+    tx_trans_delta_t* deltas;   // byte ranges written (or adds of an ADD) by the tx, installed instead of the whole value
     uint8_t   existed_prior_tx; // if obj exists on commit it fails (for kv | obj cannot be allocated by others!)
+    uint8_t   is_locked;        // set while the commit holds the object's lock
     tx_op_type_t type;
+    uint32_t  version;          // seqlock version observed when the obj was first opened by the tx
+    tx_internal_obj_val_t* int_obj_ptr; // obj in memory / kvs (NULL for kv items that do not exist)
+    tx_internal_obj_val_t* buf;         // tx copy of the header + value (in the arena of the tx)
+    uint16_t  buf_len;                  // max value len that fits in buf
     union {
         void *obj_ptr;
         struct {
@@ -154,48 +191,207 @@ typedef struct
 } __attribute__((packed)) tx_bufed_obj_id;
 
 
+// Slot of the per-tx index of opened objs / kvs (obj ptr or key hash --> idx in obj_ids)
+// slots are only valid if tagged w/ the current idx_epoch of the tx, so the index is cleared in O(1)
+// the index has 4x slots than the capacity of obj_ids (load factor <= 1/4)
+typedef struct
+{
+    uint16_t epoch;
+    uint16_t obj_idx;
+    uint32_t hash_tag; // upper half of the hash (skips most mismatching key compares)
+} tx_trans_idx_slot_t;
+
+
+// Bump arena of a tx for the copies of the values it opens (sized to their alloc_len)
+// chunks are kept across the txs that reuse the trans and the arena is rewound on commit / abort
+typedef struct _tx_arena_chunk_t
+{
+    struct _tx_arena_chunk_t* next;
+    uint32_t size;
+    uint8_t  data[] __attribute__((aligned(8)));
+} tx_arena_chunk_t;
+
+typedef struct
+{
+    tx_arena_chunk_t* head;
+    tx_arena_chunk_t* curr;
+    uint32_t          used; // bytes used in curr
+} tx_arena_t;
+
+
+// item of a range read by tx_trans_kv_scan (key and obj are kept alive by the epoch of the tx)
+typedef struct
+{
+    uint8_t*               key_ptr;
+    uint32_t               key_len;
+    tx_internal_obj_val_t* int_obj_ptr;
+} tx_trans_scan_item_t;
+
+// range read by tx_trans_kv_scan -- re-scanned on commit to detect phantoms (i.e., keys inserted / removed in it)
+typedef struct
+{
+    uint8_t*              from_key;
+    uint8_t*              to_key;    // NULL --> no upper bound
+    uint16_t              from_len;
+    uint16_t              to_len;
+    uint8_t               exhausted; // scanned up to to_key (otherwise the range ends at its last item)
+    uint32_t              num_items;
+    tx_trans_scan_item_t* items;     // in key order (incl. items later deleted by the tx)
+} tx_trans_range_t;
+
+
 struct _tx_ctx_t;
+struct _tx_stats_t;
 
 // transaction state
-typedef struct
+typedef struct _tx_trans_t
 {
     struct _tx_ctx_t*    parent;
+    struct _tx_trans_t*  next_free; // free list of the parent ctx (valid only while TX_FREE)
     tx_trans_state        state;
-    uint32_t              tx_id; // unique transaction id
-    uint16_t                      curr_num_objs_in_tx; // <= MAX_OBJ_IN_TX
-    tx_bufed_obj_id           obj_ids[MAX_OBJ_IN_TX];
-    tx_max_internal_obj_val_t obj_vals[MAX_OBJ_IN_TX];
+    uint64_t              tx_id; // unique transaction id (per-ctx counter << TX_THREAD_ID_BITS | thread_id)
+    uint16_t                      curr_num_objs_in_tx; // <= max_objs_in_tx
+    uint16_t                      max_objs_in_tx;      // capacity of obj_ids
+    uint16_t                      idx_epoch;
+    uint32_t                      idx_mask;            // idx has idx_mask + 1 slots
+    tx_trans_idx_slot_t*      idx;
+    tx_bufed_obj_id*          obj_ids;
+    uint16_t                  num_ranges;
+    uint16_t                  max_ranges;
+    tx_trans_range_t*         ranges;              // (in the arena)
+    tx_arena_t                arena;
+#ifdef TX_STATS
+    uint64_t                  start_tsc;           // (at tx_trans_create)
+#endif
 } tx_trans_t;
 
-// Main context struct
+
+///////////////////////////////
+/// KVS backend interface
+///////////////////////////////
+
+// returns non-zero to stop the scan
+typedef int (*tx_kvs_scan_cb)(void* key_ptr, uint32_t key_len, tx_internal_obj_val_t* int_obj_ptr, void* cb_arg);
+
+// Backend ops (chosen per tx_ctx_t at tx_ctx_init) -- a backend instance (void* kvs) may be shared by many ctxs
+// Objs removed by del or replaced by put are retired:
+// their lock is never released and their version is bumped, so txs that opened them fail on commit
+typedef struct
+{
+    const char* name;
+    void* (*create) (uint64_t max_keys);
+    void  (*destroy)(void* kvs);
+
+    // returns a ptr to the stored header + value or NULL if key does not exists
+    tx_internal_obj_val_t* (*get)(void* kvs, void* key_ptr, uint32_t key_len);
+    // inserts a locked placeholder (odd version, curr_len = 0) or returns NULL if key already exists (or kvs is full)
+    tx_internal_obj_val_t* (*insert)(void* kvs, void* key_ptr, uint32_t key_len,
+                                     uint32_t alloc_len, uint32_t unique_alloc_id);
+    // inserts or replaces (never in-place) the value of a key -- returns val_len or < 0 if the kvs is full
+    int (*put)(void* kvs, void* key_ptr, uint32_t key_len, void* val_ptr, uint32_t val_len);
+    int (*del)(void* kvs, void* key_ptr, uint32_t key_len);
+
+    // Optional (NULL --> the writer lock and seqlock version of tx_header_t are used)
+    uint8_t (*lock)    (void* kvs, tx_internal_obj_val_t* int_obj_ptr);
+    void    (*unlock)  (void* kvs, tx_internal_obj_val_t* int_obj_ptr);
+    uint8_t (*validate)(void* kvs, tx_internal_obj_val_t* int_obj_ptr, uint32_t version);
+
+    // Optional (NULL --> unordered backend) -- scans [from_key, to_key) in key order (to_key NULL --> no upper bound)
+    int (*scan)(void* kvs, void* from_key, uint32_t from_len, void* to_key, uint32_t to_len,
+                tx_kvs_scan_cb cb, void* cb_arg);
+
+    // Optional (NULL --> no-op) -- prefetches the index entry of a key (e.g., its home bucket) w/o waiting on memory
+    void (*prefetch)(void* kvs, void* key_ptr, uint32_t key_len);
+} tx_kvs_ops_t;
+
+extern const tx_kvs_ops_t tx_kvs_ht_ops;       // built-in hash table (tx_shim_kvs.c)
+extern const tx_kvs_ops_t tx_kvs_skiplist_ops; // lock-free skiplist  (tx_shim_kvs_skiplist.c)
+
+const tx_kvs_ops_t* tx_kvs_ops_by_name(const char* name); // NULL if not found
+
+
+
+// Epoch-based reclamation of objs / nodes removed while other threads may still access them
+// a ctx announces the global epoch while it runs txs and frees what it retired 2 epochs ago (see tx_shim.c)
+#define TX_EPOCH_QUIESCENT UINT64_MAX
+#define TX_EPOCH_BATCH 1024 // initial capacity of the limbo list (reclaims are attempted when it fills up)
+
+typedef struct
+{
+    void*    ptr;
+    uint64_t epoch; // global epoch when retired
+} tx_retired_t;
+
+typedef struct
+{
+    volatile uint64_t local_epoch; // announced epoch (TX_EPOCH_QUIESCENT if no tx is active)
+    uint32_t active_txs;
+    uint32_t num_retired;
+    uint32_t max_retired;
+    tx_retired_t* retired;         // limbo list (in retire order --> non-decreasing epochs)
+} tx_epoch_t;
+
+
+// Main context struct -- one per thread (i.e., not thread-safe), while many ctxs may share the same kvs
 typedef struct _tx_ctx_t {
     tx_trans_t trans_arr[MAX_CONCUR_TX]; // Transaction structure
-    uint32_t tx_ids;
-    // TODO
+    tx_trans_t* free_trans;              // free list of trans_arr
+    uint16_t thread_id;                  // unique across live ctxs (< TX_MAX_THREADS), reused once destroyed
+    uint64_t tx_ids;
+    tx_epoch_t epoch;
+    uint8_t exclusive;                   // no other tx accesses the keys of its txs (see tx_shim_part.h)
     // KVS metadata
-    // Stats
+    const tx_kvs_ops_t* kvs_ops;
+    void* kvs;
+    // Stats (tx_shim_stats.h -- NULL w/o -DTX_STATS)
+    struct _tx_stats_t* stats;
 } tx_ctx_t;
 
 
 ///////////////////////////////
 /// Functions
 ///////////////////////////////
-void tx_ctx_init(tx_ctx_t* tx_ctx /*....*/);
+void tx_ctx_init(tx_ctx_t* tx_ctx, const tx_kvs_ops_t* kvs_ops, void* kvs /*....*/);
 void tx_ctx_destroy(tx_ctx_t *tx_ctx);
 
 void tx_trans_init(tx_ctx_t *tx_ctx, tx_trans_t* trans);
 tx_trans_t* tx_trans_create(tx_ctx_t *tx_ctx); // update read-only but not known a priory
-tx_trans_t* tx_rd_only_trans_create(tx_ctx_t *tx_ctx); // read-only known a priory
+tx_trans_t* tx_rd_only_trans_create(tx_ctx_t *tx_ctx); // read-only known a priory (zero-copy reads)
 tx_trans_result tx_trans_commit(tx_trans_t* trans);
 void tx_trans_abort_n_clear(tx_trans_t* trans);
 void tx_trans_destroy(tx_trans_t* trans);
 
 void __tx_trans_state_update(tx_trans_t* trans, uint8_t type);
+uint8_t __tx_trans_validate_ranges(tx_trans_t* trans);
+uint8_t __tx_trans_kv_opened(tx_trans_t* trans, void* key_ptr, uint32_t key_len);
+
+// frees ptr (from tx_slab_alloc) once no tx that could have accessed it is active
+// (tx_ctx NULL --> the ctx of the calling thread or, if it has none, right away: no tx may be active then)
+void __tx_epoch_retire(tx_ctx_t* tx_ctx, void* ptr);
+
+extern volatile uint64_t tx_global_epoch;
+
+// wraps every tx and single op that accesses shared objs (nesting is allowed)
+static inline void __tx_epoch_enter(tx_ctx_t* tx_ctx)
+{
+    if(tx_ctx->epoch.active_txs++ > 0) { return; }
+    tx_ctx->epoch.local_epoch = tx_global_epoch;
+    __sync_synchronize(); // announce before accessing any shared obj
+}
+
+static inline void __tx_epoch_exit(tx_ctx_t* tx_ctx)
+{
+    assert(tx_ctx->epoch.active_txs > 0);
+    if(--tx_ctx->epoch.active_txs > 0) { return; }
+    __atomic_store_n(&tx_ctx->epoch.local_epoch, TX_EPOCH_QUIESCENT, __ATOMIC_RELEASE);
+}
 
 
 
 // trans_* read / write / get / put --> copies the current header + value to tx's buffer if item does not exists
 //                                 there already and updates or returns a ptr to the copied value
+//                                 (except for the read / get / scan of read-only txs known a priori, which return
+//                                  a ptr to the value in place that may change until their -- then failing -- commit)
 // single_* read / write / get / put --> Updates or copies the current value directly to memory / KVS / specified return buf
 
 ///////////////////////
@@ -211,6 +407,11 @@ void  tx_trans_obj_free (tx_trans_t* trans, void* obj_ptr);
 void* tx_trans_obj_read (tx_trans_t* trans, void* obj_ptr);
 void  tx_trans_obj_write(tx_trans_t* trans, void* obj_ptr, uint8_t* val_ptr, uint32_t upd_len, uint8_t is_blind);
 
+// Commutative add of *operand_ptr (of add_type) to the field at offset of the obj: unless the tx accesses the obj
+// otherwise, its value is neither copied nor validated and the adds are applied on commit (i.e., concurrent adds
+// and reads / writes of other txs never make the tx fail)
+void  tx_trans_obj_add  (tx_trans_t* trans, void* obj_ptr, uint32_t offset, tx_add_type_t add_type, void* operand_ptr);
+
 //tx_op_result tx_trans_obj_free (tx_trans_t* trans, void* obj_ptr);
 //tx_op_result tx_trans_obj_read (tx_trans_t* trans, void* obj_ptr, void* ret_buf, uint32_t bytes_to_read);
 //tx_op_result tx_trans_obj_write(tx_trans_t* trans, void* obj_ptr, void* val_ptr, uint32_t bytes_to_write);
@@ -221,6 +422,47 @@ int  tx_trans_kv_del(tx_trans_t* trans, void* key_ptr, uint32_t key_len);
 int  tx_trans_kv_get(tx_trans_t* trans, void* key_ptr, uint32_t key_len, void** value_ptr);
 void tx_trans_kv_set(tx_trans_t* trans, void* key_ptr, uint32_t key_len, void* val_ptr, uint32_t val_len);
 
+/// Byte ranges of kv items (e.g., a few fields of a large row)
+// an item opened by a range op is not copied: only the ranges accessed by the tx are buffered and, if the tx
+// wrote only ranges of it, only those are installed on commit (a later get / set of the item buffers it whole)
+// returns the value len (-1 if not found or the range exceeds it) and a ptr to the start of the value,
+// of which only [offset, offset + len) -- and the other ranges accessed by the tx -- are valid
+int  tx_trans_kv_get_range   (tx_trans_t* trans, void* key_ptr, uint32_t key_len, uint32_t offset, uint32_t len,
+                              void** value_ptr);
+// overwrites [offset, offset + len) of an existing value -- returns -1 if not found or the range exceeds it
+int  tx_trans_kv_update_range(tx_trans_t* trans, void* key_ptr, uint32_t key_len, uint32_t offset, void* src_ptr,
+                              uint32_t len);
+
+// as tx_trans_obj_add -- returns -1 if not found or the field exceeds the value
+// (a tx still fails if the item is removed or shrinks before its commit)
+int  tx_trans_kv_add(tx_trans_t* trans, void* key_ptr, uint32_t key_len, uint32_t offset, tx_add_type_t add_type,
+                     void* operand_ptr);
+
+// returns non-zero to stop the scan
+typedef int (*tx_trans_scan_cb)(void* key_ptr, uint32_t key_len, void* value_ptr, uint32_t val_len, void* cb_arg);
+
+// Calls cb in key order for up to max_items (0 --> no limit) items of [from_key, to_key) (to_key NULL --> no upper bound)
+// w/ the values as returned by tx_trans_kv_get (i.e., the tx's own updates / deletes apply but not its own inserts).
+// The range is re-scanned on commit, so the tx fails if keys were inserted in / removed from it in the meantime.
+// Returns the number of items passed to cb or -1 if the backend of the ctx is unordered (i.e., no scan op).
+int  tx_trans_kv_scan(tx_trans_t* trans, void* from_key, uint32_t from_len, void* to_key, uint32_t to_len,
+                      uint32_t max_items, tx_trans_scan_cb cb, void* cb_arg);
+
+/// Batched gets (e.g., the items of an order), which hide the cache misses of the lookups behind each other:
+/// the index entries of (up to TX_MULTI_GET_BATCH) keys are prefetched, then the keys are looked up and their objs
+/// prefetched and only then the values are copied
+#define TX_MULTI_GET_BATCH 16
+typedef struct
+{
+    void*    key_ptr;
+    uint32_t key_len;
+    int      val_len;    // (out) as returned by tx_trans_kv_get
+    void*    value_ptr;  // (out)
+} tx_trans_kv_get_t;
+
+// opens the keys of gets as tx_trans_kv_get would, in order -- returns the number of keys found
+int  tx_trans_kv_multi_get(tx_trans_t* trans, tx_trans_kv_get_t* gets, uint32_t num_gets);
+
 //tx_op_result tx_trans_kv_get(tx_trans_t* trans, void* key_ptr, uint32_t key_len, void* buf_ptr, uint32_t buf_len);
 //tx_op_result tx_trans_kv_set(tx_trans_t* trans, void* key_ptr, uint32_t key_len, void* val_ptr, uint32_t val_len);
 //tx_op_result tx_trans_kv_del(tx_trans_t* trans, void* key_ptr, uint32_t key_len);
@@ -231,47 +473,320 @@ void tx_trans_kv_set(tx_trans_t* trans, void* key_ptr, uint32_t key_len, void* v
 ///////////////////////
 /// Single-key operations (i.e., non-transactional interface --  Mostly an optimization for single-key ops)
 ///////////////////////
+// Each op is linearizable w/ respect to other single ops and to txs (seqlock reads / writer-locked installs)
 // Memory object interface
 void*        tx_single_obj_alloc(tx_ctx_t *tx_ctx, uint32_t max_obj_len, uint32_t unique_alloc_id);
 tx_op_result tx_single_obj_free (tx_ctx_t *tx_ctx, void* obj_ptr);
 tx_op_result tx_single_obj_read (tx_ctx_t *tx_ctx, void* obj_ptr, void* ret_buf, uint32_t bytes_to_read);
 tx_op_result tx_single_obj_write(tx_ctx_t *tx_ctx, void* obj_ptr, void* val_ptr, uint32_t bytes_to_write);
 
-// Memory object interface
-tx_op_result tx_single_kv_get(tx_ctx_t *tx_ctx, void* key_ptr, uint32_t key_len, void* buf_ptr, uint32_t buf_len);
+// KV interface -- val_len of get: size of buf_ptr in, length of the value out (set: err_other if the kvs is full)
+tx_op_result tx_single_kv_get(tx_ctx_t *tx_ctx, void* key_ptr, uint32_t key_len, void* buf_ptr, uint32_t* val_len);
 tx_op_result tx_single_kv_set(tx_ctx_t *tx_ctx, void* key_ptr, uint32_t key_len, void* val_ptr, uint32_t val_len);
 tx_op_result tx_single_kv_del(tx_ctx_t *tx_ctx, void* key_ptr, uint32_t key_len);
+// Hint that key is about to be accessed (e.g., by the next tx of a batch): prefetches the index entry of the key
+// or, if obj_len > 0, looks it up (i.e., the index entry should be prefetched beforehand) and prefetches the header
+// and first obj_len bytes of its value (a no-op w/ a backend w/o a prefetch op)
+void         tx_single_kv_prefetch(tx_ctx_t *tx_ctx, void* key_ptr, uint32_t key_len, uint32_t obj_len);
+
+
+///////////////////////
+/// Sequences (e.g., of ids)
+///////////////////////
+// Atomic counters outside of the txs: taking values never makes a tx fail (nor waits) and the values taken by
+// a tx are not given back if it fails (i.e., a sequence may have gaps)
+typedef struct
+{
+    volatile uint64_t next;
+} __attribute__((aligned(64))) tx_seq_t; // (a cache line of its own)
+
+tx_seq_t* tx_seq_create(uint64_t first);
+void      tx_seq_free  (tx_ctx_t *tx_ctx, tx_seq_t* seq); // (once no tx that may access it is active)
 
+// takes n consecutive values and returns the first
+static inline uint64_t tx_seq_next(tx_seq_t* seq, uint64_t n){
+    return __atomic_fetch_add(&seq->next, n, __ATOMIC_RELAXED);
+}
+
+// the next value to be taken (i.e., all smaller ones have been taken, not necessarily by committed txs)
+static inline uint64_t tx_seq_peek(tx_seq_t* seq){
+    return __atomic_load_n(&seq->next, __ATOMIC_RELAXED);
+}
+
+// as tx_seq_next within a tx (the values are kept even if the tx fails)
+static inline uint64_t tx_trans_seq_next(tx_trans_t* trans, tx_seq_t* seq, uint64_t n){
+    assert(trans->state != TX_FREE);
+    return tx_seq_next(seq, n);
+}
 
 
 
 
-/// Supposedly represent the get/set/del of a third-party KVS
-int __del(tx_ctx_t *tx_ctx, void* key_ptr, uint32_t key_len);
-int __set(tx_ctx_t *tx_ctx, void* key_ptr, uint32_t key_len, void* val_ptr, uint32_t val_len);
-int __get(tx_ctx_t *tx_ctx, void* key_ptr, uint32_t key_len, void* buf_ptr, uint32_t buf_len); // returns length of object or < 0 if object does not exists
 
+/// Supposedly represent the get/set/del of a third-party KVS -- dispatched to the backend of the tx_ctx (see after the seqlock helpers)
+static inline int __del(tx_ctx_t *tx_ctx, void* key_ptr, uint32_t key_len);
+static inline int __set(tx_ctx_t *tx_ctx, void* key_ptr, uint32_t key_len, void* val_ptr, uint32_t val_len);
+static inline int __get(tx_ctx_t *tx_ctx, void* key_ptr, uint32_t key_len, void* buf_ptr, uint32_t buf_len); // returns length of object or < 0 if object does not exists
 
+/// In-place access required by the commit to lock / validate / install kv items
+static inline tx_internal_obj_val_t* __lookup(tx_ctx_t *tx_ctx, void* key_ptr, uint32_t key_len);
+static inline tx_internal_obj_val_t* __insert(tx_ctx_t *tx_ctx, void* key_ptr, uint32_t key_len,
+                                              uint32_t alloc_len, uint32_t unique_alloc_id);
+static inline uint8_t __lock    (tx_ctx_t *tx_ctx, tx_internal_obj_val_t* int_obj_ptr);
+static inline void    __unlock  (tx_ctx_t *tx_ctx, tx_internal_obj_val_t* int_obj_ptr);
+static inline uint8_t __validate(tx_ctx_t *tx_ctx, tx_internal_obj_val_t* int_obj_ptr, uint32_t version);
+static inline int     __scan    (tx_ctx_t *tx_ctx, void* from_key, uint32_t from_len, void* to_key, uint32_t to_len,
+                                 tx_kvs_scan_cb cb, void* cb_arg); // -1 if the backend is unordered
 
+// Built-in hash table (its calls are devirtualized, see __TX_KVS_CALL)
+void* tx_kvs_ht_create (uint64_t max_keys);
+void  tx_kvs_ht_destroy(void* kvs);
+tx_internal_obj_val_t* tx_kvs_ht_get   (void* kvs, void* key_ptr, uint32_t key_len);
+void tx_kvs_ht_prefetch(void* kvs, void* key_ptr, uint32_t key_len);
+tx_internal_obj_val_t* tx_kvs_ht_insert(void* kvs, void* key_ptr, uint32_t key_len,
+                                        uint32_t alloc_len, uint32_t unique_alloc_id);
+int tx_kvs_ht_put(void* kvs, void* key_ptr, uint32_t key_len, void* val_ptr, uint32_t val_len);
+int tx_kvs_ht_del(void* kvs, void* key_ptr, uint32_t key_len);
 
 
 
-// Lock-free read based on version % 2 == 0 and didn't change while memcpying
+
+
+
+// Lock-free read based on version % 2 == 0 and didn't change while memcpying (readers never write the header)
 /// WARNING: nested LOCK_FREE_READS are not supported !
 #define LOCK_FREE_READ_BEGIN() \
-    uint32_t __prev_ver, __after_ver; \
+    uint32_t __prev_ver; \
     do{ \
-    __prev_ver = int_obj_ptr->hdr.version++;
+    __prev_ver = __tx_obj_read_begin(int_obj_ptr);
 
 #define LOCK_FREE_READ_END() \
-    __after_ver = int_obj_ptr->hdr.version++; \
-    }while (__prev_ver != __after_ver || __prev_ver % 2);
+    }while (__tx_obj_read_retry(int_obj_ptr, __prev_ver));
 
 // translates seqlock_version to actual object version for transaction commit
-#define GET_OBJ_VERSION(int_obj_ptr) ((int_obj_ptr)->hdr.version / 2)
+#define GET_OBJ_VERSION(int_obj_ptr) (__tx_obj_version(int_obj_ptr) / 2)
+
+#define TX_COMPILER_BARRIER() __asm__ __volatile__("" ::: "memory")
+#if defined(__x86_64__) || defined(__i386__)
+#define TX_CPU_RELAX() __builtin_ia32_pause()
+#else
+#define TX_CPU_RELAX() TX_COMPILER_BARRIER()
+#endif
+
+// (header fields are accessed via ptrs to the packed struct; the slab allocator keeps version / lock aligned)
+static inline uint32_t __tx_obj_version(tx_internal_obj_val_t* int_obj_ptr){
+    return __atomic_load_n(&int_obj_ptr->hdr.version, __ATOMIC_ACQUIRE);
+}
+
+static inline uint8_t __tx_obj_is_locked(tx_internal_obj_val_t* int_obj_ptr){
+    return __atomic_load_n(&int_obj_ptr->hdr.lock, __ATOMIC_ACQUIRE);
+}
+
+#define TX_OBJ_RETIRED 2 // lock of a freed / replaced obj (never released)
+
+static inline uint8_t __tx_obj_is_retired(tx_internal_obj_val_t* int_obj_ptr){
+    return __atomic_load_n(&int_obj_ptr->hdr.lock, __ATOMIC_ACQUIRE) == TX_OBJ_RETIRED;
+}
+
+// freed / replaced objs stay locked w/ a bumped (even) version so that txs that opened them fail on commit
+// (the caller holds the lock or the obj is a placeholder of an insert)
+static inline void __tx_obj_mark_retired(tx_internal_obj_val_t* int_obj_ptr){
+    __atomic_store_n(&int_obj_ptr->hdr.lock, TX_OBJ_RETIRED, __ATOMIC_RELAXED);
+    __atomic_store_n(&int_obj_ptr->hdr.version, (__tx_obj_version(int_obj_ptr) | 1) + 1, __ATOMIC_RELEASE);
+}
+
+// writer lock used by the commit (no-wait: caller aborts if it fails) and single ops (which spin)
+static inline uint8_t __tx_obj_try_lock(tx_internal_obj_val_t* int_obj_ptr){
+    uint8_t unlocked = 0;
+    return __atomic_compare_exchange_n(&int_obj_ptr->hdr.lock, &unlocked, 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
+}
+
+static inline void __tx_obj_unlock(tx_internal_obj_val_t* int_obj_ptr){
+    __atomic_store_n(&int_obj_ptr->hdr.lock, 0, __ATOMIC_RELEASE);
+}
+
+// seqlock read side: waits for an even version and returns it
+static inline uint32_t __tx_obj_read_begin(tx_internal_obj_val_t* int_obj_ptr){
+    uint32_t version;
+    while((version = __tx_obj_version(int_obj_ptr)) % 2) { TX_CPU_RELAX(); }
+    return version;
+}
+
+// seqlock read side: returns non-zero if a writer installed a value while reading (i.e., must retry)
+static inline uint8_t __tx_obj_read_retry(tx_internal_obj_val_t* int_obj_ptr, uint32_t version){
+    __atomic_thread_fence(__ATOMIC_ACQUIRE); // orders the (plain) reads of the value before the version check
+    return __atomic_load_n(&int_obj_ptr->hdr.version, __ATOMIC_RELAXED) != version;
+}
+
+// Copies header (+ current value unless hdr_only) following the seqlock protocol
+// and returns the (even) version of the copy
+static inline uint32_t __tx_obj_seqlock_copy(tx_internal_obj_val_t* dst, tx_internal_obj_val_t* src, uint8_t hdr_only){
+    uint32_t version;
+    do{
+        version = __tx_obj_read_begin(src);
+        dst->hdr = src->hdr;
+        if(!hdr_only){
+            memcpy(dst->val, src->val, dst->hdr.curr_len);
+        }
+    }while(__tx_obj_read_retry(src, version));
+    dst->hdr.lock = 0;
+    dst->hdr.version = version;
+    return version;
+}
+
+// Allocates len bytes (8B aligned) in the arena; the slow path moves to the next (or a new) chunk
+void* __tx_arena_alloc_slow(tx_arena_t* arena, uint32_t len);
+
+static inline void* __tx_arena_alloc(tx_arena_t* arena, uint32_t len){
+    len = (len + 7) & ~7U;
+    if(__builtin_expect(arena->curr == NULL || arena->used + len > arena->curr->size, 0)){
+        return __tx_arena_alloc_slow(arena, len);
+    }
+    void* ptr = &arena->curr->data[arena->used];
+    arena->used += len;
+    return ptr;
+}
+
+static inline void __tx_arena_reset(tx_arena_t* arena){
+    arena->curr = arena->head;
+    arena->used = 0;
+}
+
+// Installs a new value on a locked (or exclusively owned) object (readers retry while the version is odd)
+static inline void __tx_obj_install(tx_internal_obj_val_t* int_obj_ptr, void* val_ptr, uint32_t val_len){
+    assert(val_len <= int_obj_ptr->hdr.alloc_len);
+    uint32_t version = int_obj_ptr->hdr.version; // (only the lock holder / owner writes it)
+    if(version % 2 == 0){ // placeholders of inserts are already odd
+        __atomic_store_n(&int_obj_ptr->hdr.version, ++version, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_RELEASE); // odd version is visible before any write of the value
+    }
+    memcpy(int_obj_ptr->val, val_ptr, val_len);
+    int_obj_ptr->hdr.curr_len = val_len;
+    __atomic_store_n(&int_obj_ptr->hdr.version, version + 1, __ATOMIC_RELEASE);
+}
+
+static inline uint32_t __tx_add_len(uint8_t add_type){
+    static const uint8_t lens[] = { 0, 1, 2, 4, 8, 4, 8 };
+    assert(add_type > TX_ADD_NONE && add_type <= TX_ADD_F64);
+    return lens[add_type];
+}
+
+// *field += *operand (both unaligned) -- ints wrap around
+#define __TX_ADD_AS(T) do{ T x, y; memcpy(&x, field_ptr, sizeof(T)); memcpy(&y, operand_ptr, sizeof(T)); \
+                           x += y; memcpy(field_ptr, &x, sizeof(T)); }while(0)
+static inline void __tx_add_apply(uint8_t* field_ptr, uint8_t add_type, const void* operand_ptr){
+    switch(add_type){
+        case TX_ADD_I8:  __TX_ADD_AS(uint8_t);  break;
+        case TX_ADD_I16: __TX_ADD_AS(uint16_t); break;
+        case TX_ADD_I32: __TX_ADD_AS(uint32_t); break;
+        case TX_ADD_I64: __TX_ADD_AS(uint64_t); break;
+        case TX_ADD_F32: __TX_ADD_AS(float);    break;
+        case TX_ADD_F64: __TX_ADD_AS(double);   break;
+        default: assert(0);
+    }
+}
+#undef __TX_ADD_AS
+
+static inline void __tx_delta_apply(uint8_t* val, tx_trans_delta_t* delta){
+    if(delta->add_type == TX_ADD_NONE) { memcpy(val + delta->offset, delta->data, delta->len); }
+    else { __tx_add_apply(val + delta->offset, delta->add_type, delta->data); }
+}
+
+// as __tx_obj_install but writes only the byte ranges of the deltas (the rest of the value and its len are unchanged)
+static inline void __tx_obj_install_deltas(tx_internal_obj_val_t* int_obj_ptr, tx_trans_delta_t* deltas){
+    assert(int_obj_ptr->hdr.version % 2 == 0);
+    uint32_t version = int_obj_ptr->hdr.version + 1;
+    __atomic_store_n(&int_obj_ptr->hdr.version, version, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    for(tx_trans_delta_t* delta = deltas; delta != NULL; delta = delta->next){
+        __tx_delta_apply(int_obj_ptr->val, delta);
+    }
+    __atomic_store_n(&int_obj_ptr->hdr.version, version + 1, __ATOMIC_RELEASE);
+}
+
+
 
 
 
+/// KVS dispatch: calls to the built-in hash table are direct (no indirect call per key);
+/// -DTX_KVS_HT_ONLY drops the vtable altogether
+#ifdef TX_KVS_HT_ONLY
+#define __TX_KVS_CALL(tx_ctx, op, ...) tx_kvs_ht_##op((tx_ctx)->kvs, __VA_ARGS__)
+#else
+#define __TX_KVS_CALL(tx_ctx, op, ...) \
+    (__builtin_expect((tx_ctx)->kvs_ops == &tx_kvs_ht_ops, 1) ? \
+        tx_kvs_ht_##op((tx_ctx)->kvs, __VA_ARGS__) : (tx_ctx)->kvs_ops->op((tx_ctx)->kvs, __VA_ARGS__))
+#endif
+
+static inline tx_internal_obj_val_t* __lookup(tx_ctx_t *tx_ctx, void* key_ptr, uint32_t key_len){
+    return __TX_KVS_CALL(tx_ctx, get, key_ptr, key_len);
+}
+
+static inline tx_internal_obj_val_t* __insert(tx_ctx_t *tx_ctx, void* key_ptr, uint32_t key_len,
+                                              uint32_t alloc_len, uint32_t unique_alloc_id){
+    return __TX_KVS_CALL(tx_ctx, insert, key_ptr, key_len, alloc_len, unique_alloc_id);
+}
+
+static inline int __set(tx_ctx_t *tx_ctx, void* key_ptr, uint32_t key_len, void* val_ptr, uint32_t val_len){
+    return __TX_KVS_CALL(tx_ctx, put, key_ptr, key_len, val_ptr, val_len);
+}
+
+static inline int __del(tx_ctx_t *tx_ctx, void* key_ptr, uint32_t key_len){
+    return __TX_KVS_CALL(tx_ctx, del, key_ptr, key_len);
+}
+
+// Copies header + value to buf_ptr; returns length of object or < 0 if object does not exists (or does not fit)
+static inline int __get(tx_ctx_t *tx_ctx, void* key_ptr, uint32_t key_len, void* buf_ptr, uint32_t buf_len){
+    tx_internal_obj_val_t* int_obj_ptr = __lookup(tx_ctx, key_ptr, key_len);
+    if(int_obj_ptr == NULL) { return -1; }
+    if(INT_OBJ_LEN(int_obj_ptr->hdr.alloc_len) > buf_len) { return -2; }
+
+    __tx_obj_seqlock_copy((tx_internal_obj_val_t *) buf_ptr, int_obj_ptr, 0);
+    return ((tx_internal_obj_val_t *) buf_ptr)->hdr.curr_len;
+}
+
+#ifdef TX_KVS_HT_ONLY
+#define __TX_KVS_HAS_OP(tx_ctx, op) 0
+#else
+#define __TX_KVS_HAS_OP(tx_ctx, op) ((tx_ctx)->kvs_ops->op != NULL)
+#endif
+
+static inline uint8_t __lock(tx_ctx_t *tx_ctx, tx_internal_obj_val_t* int_obj_ptr){
+    if(__TX_KVS_HAS_OP(tx_ctx, lock)) { return tx_ctx->kvs_ops->lock(tx_ctx->kvs, int_obj_ptr); }
+    return __tx_obj_try_lock(int_obj_ptr);
+}
+
+static inline void __unlock(tx_ctx_t *tx_ctx, tx_internal_obj_val_t* int_obj_ptr){
+    if(__TX_KVS_HAS_OP(tx_ctx, unlock)) { tx_ctx->kvs_ops->unlock(tx_ctx->kvs, int_obj_ptr); return; }
+    __tx_obj_unlock(int_obj_ptr);
+}
+
+static inline uint8_t __validate(tx_ctx_t *tx_ctx, tx_internal_obj_val_t* int_obj_ptr, uint32_t version){
+    if(__TX_KVS_HAS_OP(tx_ctx, validate)) { return tx_ctx->kvs_ops->validate(tx_ctx->kvs, int_obj_ptr, version); }
+    return !__tx_obj_is_locked(int_obj_ptr) && __tx_obj_version(int_obj_ptr) == version;
+}
+
+static inline int __scan(tx_ctx_t *tx_ctx, void* from_key, uint32_t from_len, void* to_key, uint32_t to_len,
+                         tx_kvs_scan_cb cb, void* cb_arg){
+    if(!__TX_KVS_HAS_OP(tx_ctx, scan)) { return -1; }
+    return tx_ctx->kvs_ops->scan(tx_ctx->kvs, from_key, from_len, to_key, to_len, cb, cb_arg);
+}
+
+static inline void __prefetch(tx_ctx_t *tx_ctx, void* key_ptr, uint32_t key_len){
+#ifndef TX_KVS_HT_ONLY
+    if(__builtin_expect(tx_ctx->kvs_ops != &tx_kvs_ht_ops, 0)){
+        if(tx_ctx->kvs_ops->prefetch != NULL) { tx_ctx->kvs_ops->prefetch(tx_ctx->kvs, key_ptr, key_len); }
+        return;
+    }
+#endif
+    tx_kvs_ht_prefetch(tx_ctx->kvs, key_ptr, key_len);
+}
+
+// prefetches the header and the first len bytes of the value of an obj (for reading)
+static inline void __tx_obj_prefetch(tx_internal_obj_val_t* int_obj_ptr, uint32_t len){
+    const uint8_t* from = (const uint8_t *) int_obj_ptr;
+    for(uint32_t off = 0; off < INT_OBJ_LEN(len); off += 64) { __builtin_prefetch(from + off, 0, 3); }
+}
 
 
 static inline void* __internal_obj_ptr_2_obj_ptr(tx_internal_obj_val_t * obj_ptr){
@@ -284,5 +799,9 @@ static inline tx_internal_obj_val_t* __obj_ptr_2_internal_obj_ptr(void* obj_ptr)
 
 
 
+#ifdef __cplusplus
+}
+#endif
+
 #endif //UNTITLED_TX_SHIM_H
 
@@ -0,0 +1,305 @@
+//
+// C++20 coroutine executor: txs written as coroutines that co_await their kv accesses, up to MAX_CONCUR_TX of
+//  which (i.e., one per trans_arr slot of the ctx) are interleaved on the thread of the ctx
+//
+
+/// An access to a key that the tx has not opened yet (i.e., that would miss in the buffers of the tx) suspends the tx:
+/// -- on suspension the index entry of the key is prefetched
+/// -- the next time the executor gets to the tx it looks the key up and prefetches the obj (stage 2)
+/// -- the time after that it resumes the tx, which then runs the access (w/ the obj most likely cached)
+/// Meanwhile the executor resumes the other in-flight txs, so the memory stalls of one tx overlap w/ the work of the
+/// others (the suspension points are the same a remote backend would hide its round trips behind).
+/// Accesses to opened keys do not suspend and commits run to completion, so no tx holds locks while suspended.
+/// W/ a backend w/o a prefetch op (e.g., skiplist) accesses never suspend, i.e., the txs run one after the other.
+/// Suspending costs two extra turns of the executor and a second lookup of the key, so it only pays off when the keys
+/// miss in the LLC (not w/ a cache-resident dataset, e.g., the handover traces run ~0.6-0.75x as fast w/ 8 in flight).
+///
+/// e.g.
+///   tx_coro::task<int> transfer(tx_ctx_t* ctx, key_t* from, key_t* to)
+///   {
+///       tx_trans_t* trans = tx_trans_create(ctx);
+///       int64_t* balance;
+///       int len = co_await tx_coro::kv_get(trans, from, sizeof(key_t), (void**) &balance);
+///       if(len < 0) { ... }
+///       ...
+///       co_return tx_trans_commit(trans);
+///   }
+///   tx_coro::task<> client(tx_ctx_t* ctx, ...)
+///   {
+///       for(;;){ int res = co_await transfer(ctx, ...); if(res != failed) { break; } } // (retries)
+///   }
+///
+///   tx_coro::executor ex(ctx, 8);
+///   for(...) { ex.spawn(client(ctx, ...)); } // (steps the in-flight txs while all slots are taken)
+///   ex.drain();
+///
+/// Txs may co_await other tasks (e.g., a tx and its retries) but each spawned task must hold at most one trans at a
+/// time. The interleaved txs of a ctx are concurrent txs like those of other ctxs (i.e., they may conflict w/ each
+/// other) and a task must not assume that the txs spawned before it have finished (e.g., two txs of the same user).
+/// Frames are slab-allocated (i.e., one alloc per task, none per access).
+/// GCC 12 lays out the frame of a coroutine w/ a co_await in the condition of an if / while wrong (the promise is not
+/// where the handle expects it), i.e., await into a local first (asserted when the task starts).
+
+#ifndef TX_SHIM_CORO_H
+#define TX_SHIM_CORO_H
+
+#if __cplusplus < 202002L
+#error "tx_shim_coro.h needs C++20 (-std=c++20)"
+#endif
+
+#include <coroutine>
+#include <exception>
+#include <type_traits>
+#include <utility>
+#include <stdint.h>
+#include "tx_shim.h"
+#include "tx_shim_slab.h"
+
+namespace tx_coro
+{
+
+// the access a tx is suspended on (key_ptr: NULL --> its index entry and obj have been prefetched)
+struct __pending_t
+{
+    void* key_ptr;
+    uint32_t key_len;
+    uint32_t obj_len; // bytes of the value to prefetch (see tx_single_kv_prefetch)
+};
+
+struct __promise_base
+{
+    __promise_base* root = this;    // of the spawned task
+    std::coroutine_handle<> leaf;    // (root) the innermost awaiting task, i.e., the one to resume
+    std::coroutine_handle<> parent;  // the task awaiting this one (none for the root)
+    __pending_t pending = {};        // (root)
+
+    static void* operator new(std::size_t len) { return tx_slab_alloc((uint32_t) len); }
+    static void  operator delete(void* ptr) { tx_slab_free(ptr); }
+
+    struct initial_awaiter
+    {
+        void* self; // (the handle of get_return_object)
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> started) const noexcept
+        {
+            assert(started.address() == self); // (a miscompiled frame, see above)
+            (void) started;
+        }
+        void await_resume() const noexcept { }
+    };
+    initial_awaiter initial_suspend() noexcept { return { leaf.address() }; }
+    void unhandled_exception() noexcept { std::terminate(); }
+
+    // back to the awaiting task (or to the executor if this is the root)
+    struct final_awaiter
+    {
+        bool await_ready() const noexcept { return false; }
+        template<typename P>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<P> done) const noexcept
+        {
+            __promise_base& p = done.promise();
+            if(!p.parent) { return std::noop_coroutine(); }
+            p.root->leaf = p.parent;
+            return p.parent;
+        }
+        void await_resume() const noexcept { }
+    };
+    final_awaiter final_suspend() noexcept { return {}; }
+};
+
+template<typename T>
+struct __promise_value
+{
+    T value{};
+    void return_value(T val) { value = std::move(val); }
+};
+
+template<>
+struct __promise_value<void>
+{
+    void return_void() { }
+};
+
+template<typename T = void>
+class [[nodiscard]] task
+{
+public:
+    struct promise_type : __promise_base, __promise_value<T>
+    {
+        task get_return_object()
+        {
+            handle_t h = handle_t::from_promise(*this);
+            leaf = h;
+            return task(h);
+        }
+    };
+    using handle_t = std::coroutine_handle<promise_type>;
+
+    task(task&& other) noexcept : handle(std::exchange(other.handle, nullptr)) { }
+    task(const task&) = delete;
+    task& operator=(const task&) = delete;
+    ~task() { if(handle) { handle.destroy(); } }
+
+    // started (and run until its first suspension) by the awaiting task
+    bool await_ready() const noexcept { return false; }
+    template<typename P>
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<P> awaiting) noexcept
+    {
+        promise_type& p = handle.promise();
+        p.parent = awaiting;
+        p.root = awaiting.promise().root;
+        p.root->leaf = handle;
+        return handle;
+    }
+    T await_resume()
+    {
+        if constexpr (!std::is_void_v<T>) { return std::move(handle.promise().value); }
+    }
+
+    handle_t release() { return std::exchange(handle, nullptr); }
+
+private:
+    explicit task(handle_t h) : handle(h) { }
+    handle_t handle;
+};
+
+static inline bool __tx_coro_prefetches(tx_ctx_t* tx_ctx)
+{
+#ifndef TX_KVS_HT_ONLY
+    return tx_ctx->kvs_ops == &tx_kvs_ht_ops || tx_ctx->kvs_ops->prefetch != NULL;
+#else
+    return true;
+#endif
+}
+
+// runs op (the access) right away if the tx has opened the key, otherwise after the executor has prefetched it
+template<typename Op>
+class __access
+{
+public:
+    __access(tx_trans_t* trans, void* key_ptr, uint32_t key_len, uint32_t obj_len, Op op)
+        : trans(trans), key_ptr(key_ptr), key_len(key_len), obj_len(obj_len), op(op) { }
+
+    // (w/o a prefetch op of the backend, nothing would overlap w/ the other txs while suspended)
+    bool await_ready() const
+    {
+        return !__tx_coro_prefetches(trans->parent) || __tx_trans_kv_opened(trans, key_ptr, key_len);
+    }
+    template<typename P>
+    void await_suspend(std::coroutine_handle<P> awaiting) const
+    {
+        tx_single_kv_prefetch(trans->parent, key_ptr, key_len, 0); // the index entry
+        awaiting.promise().root->pending = { key_ptr, key_len, obj_len };
+    }
+    auto await_resume() { return op(); }
+
+private:
+    tx_trans_t* trans;
+    void* key_ptr;
+    uint32_t key_len;
+    uint32_t obj_len;
+    Op op;
+};
+
+///////////////////////////////
+/// Accesses (as tx_trans_kv_*)
+///////////////////////////////
+// writes prefetch only the header of the obj (i.e., 1B of the value), reads the bytes they return
+#define TX_CORO_READ_LEN 64 // (the first cache line of values of unknown size)
+
+inline auto kv_get(tx_trans_t* trans, void* key_ptr, uint32_t key_len, void** value_ptr)
+{
+    return __access(trans, key_ptr, key_len, TX_CORO_READ_LEN,
+                    [=] { return tx_trans_kv_get(trans, key_ptr, key_len, value_ptr); });
+}
+
+inline auto kv_get_range(tx_trans_t* trans, void* key_ptr, uint32_t key_len, uint32_t offset, uint32_t len,
+                         void** value_ptr)
+{
+    return __access(trans, key_ptr, key_len, offset + len,
+                    [=] { return tx_trans_kv_get_range(trans, key_ptr, key_len, offset, len, value_ptr); });
+}
+
+inline auto kv_set(tx_trans_t* trans, void* key_ptr, uint32_t key_len, void* val_ptr, uint32_t val_len)
+{
+    return __access(trans, key_ptr, key_len, 1, [=] { tx_trans_kv_set(trans, key_ptr, key_len, val_ptr, val_len); });
+}
+
+inline auto kv_del(tx_trans_t* trans, void* key_ptr, uint32_t key_len)
+{
+    return __access(trans, key_ptr, key_len, 1, [=] { return tx_trans_kv_del(trans, key_ptr, key_len); });
+}
+
+inline auto kv_update_range(tx_trans_t* trans, void* key_ptr, uint32_t key_len, uint32_t offset, void* val_ptr,
+                            uint32_t len)
+{
+    return __access(trans, key_ptr, key_len, 1,
+                    [=] { return tx_trans_kv_update_range(trans, key_ptr, key_len, offset, val_ptr, len); });
+}
+
+inline auto kv_add(tx_trans_t* trans, void* key_ptr, uint32_t key_len, uint32_t offset, tx_add_type_t add_type,
+                   void* operand_ptr)
+{
+    return __access(trans, key_ptr, key_len, 1,
+                    [=] { return tx_trans_kv_add(trans, key_ptr, key_len, offset, add_type, operand_ptr); });
+}
+
+///////////////////////////////
+/// Executor
+///////////////////////////////
+// A ctx announces its epoch only while none of its txs is active (see __tx_epoch_enter), so the executor stops
+//  spawning every TX_EPOCH_BATCH tasks until the in-flight ones finish (otherwise nothing it retires is reclaimed)
+class executor
+{
+public:
+    executor(tx_ctx_t* tx_ctx, uint32_t max_in_flight)
+        : tx_ctx(tx_ctx), max_in_flight(max_in_flight < 1 ? 1 : max_in_flight > MAX_CONCUR_TX ? MAX_CONCUR_TX :
+                                                                                                 max_in_flight) { }
+    executor(const executor&) = delete;
+    executor& operator=(const executor&) = delete;
+    ~executor() { drain(); }
+
+    uint32_t num_in_flight() const { return num; }
+
+    // steps the in-flight tasks until there is a free slot for t (started by the next step)
+    void spawn(task<>&& t)
+    {
+        if(++num_spawned % TX_EPOCH_BATCH == 0) { drain(); }
+        while(num == max_in_flight) { step(); }
+        in_flight[num++] = t.release();
+    }
+
+    // advances every in-flight task once (i.e., its pending access or the task itself) -- false if none is left
+    bool step()
+    {
+        for(uint32_t i = 0; i < num; ){
+            __promise_base& p = in_flight[i].promise();
+            if(p.pending.key_ptr != NULL){
+                tx_single_kv_prefetch(tx_ctx, p.pending.key_ptr, p.pending.key_len, p.pending.obj_len);
+                p.pending.key_ptr = NULL;
+            }else{
+                p.leaf.resume();
+                if(in_flight[i].done()){
+                    in_flight[i].destroy();
+                    in_flight[i] = in_flight[--num];
+                    continue;
+                }
+            }
+            ++i;
+        }
+        return num > 0;
+    }
+
+    void drain() { while(step()) { } }
+
+private:
+    tx_ctx_t* tx_ctx;
+    uint32_t max_in_flight;
+    uint32_t num = 0;
+    uint64_t num_spawned = 0;
+    task<>::handle_t in_flight[MAX_CONCUR_TX];
+};
+
+} // namespace tx_coro
+
+#endif //TX_SHIM_CORO_H
@@ -0,0 +1,295 @@
+//
+// Built-in hash-table KVS backend of the shim (see tx_shim_kvs.h)
+//
+
+#include <stdlib.h>
+#include <memory.h>
+#include <assert.h>
+#include "tx_shim.h"
+#include "tx_shim_kvs.h"
+
+#define TX_KVS_MAX_LOAD_FACTOR 0.75
+
+
+void* tx_kvs_ht_create(uint64_t max_keys)
+{
+    uint64_t min_buckets = (uint64_t) (max_keys / (TX_KVS_BUCKET_SLOTS * TX_KVS_MAX_LOAD_FACTOR)) + 1;
+    uint64_t num_buckets = 1;
+    while(num_buckets < min_buckets){
+        num_buckets <<= 1;
+    }
+
+    tx_kvs_ht_t* kvs = malloc(sizeof(tx_kvs_ht_t));
+    kvs->num_keys = 0;
+    kvs->num_buckets = num_buckets;
+    kvs->bucket_mask = num_buckets - 1;
+    kvs->buckets = aligned_alloc(TX_CACHE_LINE_SIZE, num_buckets * sizeof(tx_kvs_bucket_t));
+    assert(kvs->buckets != NULL);
+    memset(kvs->buckets, 0, num_buckets * sizeof(tx_kvs_bucket_t));
+    return kvs;
+}
+
+void tx_kvs_ht_destroy(void* kvs_ptr)
+{
+    tx_kvs_ht_t* kvs = (tx_kvs_ht_t *) kvs_ptr;
+    for(uint64_t i = 0; i < kvs->num_buckets; ++i){
+        for(int s = 0; s < TX_KVS_BUCKET_SLOTS; ++s){
+            if(kvs->buckets[i].meta.tags[s] > TX_KVS_TAG_TOMBSTONE){
+                tx_slab_free(kvs->buckets[i].meta.vals[s]);
+            }
+        }
+    }
+    free(kvs->buckets);
+    free(kvs);
+}
+
+
+
+///////////////////////////////////////////////////////
+//////// Bucket seqlocks
+///////////////////////////////////////////////////////
+
+static inline uint32_t __tx_kvs_bucket_version(tx_kvs_bucket_t* bucket)
+{
+    return ((volatile tx_kvs_bucket_meta_t *) &bucket->meta)->version;
+}
+
+static inline uint32_t __tx_kvs_bucket_read_begin(tx_kvs_bucket_t* bucket)
+{
+    uint32_t version;
+    do{ version = __tx_kvs_bucket_version(bucket); } while(version % 2);
+    TX_COMPILER_BARRIER();
+    return version;
+}
+
+static inline uint8_t __tx_kvs_bucket_read_retry(tx_kvs_bucket_t* bucket, uint32_t version)
+{
+    TX_COMPILER_BARRIER();
+    return __tx_kvs_bucket_version(bucket) != version;
+}
+
+static inline void __tx_kvs_bucket_lock(tx_kvs_bucket_t* bucket)
+{
+    uint32_t version;
+    do{
+        version = __tx_kvs_bucket_read_begin(bucket);
+    }while(!__sync_bool_compare_and_swap(&bucket->meta.version, version, version + 1));
+}
+
+static inline void __tx_kvs_bucket_unlock(tx_kvs_bucket_t* bucket)
+{
+    TX_COMPILER_BARRIER();
+    ((volatile tx_kvs_bucket_meta_t *) &bucket->meta)->version++;
+}
+
+
+
+///////////////////////////////////////////////////////
+//////// Probing
+///////////////////////////////////////////////////////
+
+typedef struct
+{
+    tx_kvs_bucket_t* bucket;
+    int slot;
+    tx_internal_obj_val_t* val;
+} tx_kvs_slot_t;
+
+// Lock-free probing; returns the slot of the key or a NULL bucket if the key does not exist
+// (owned is a bucket locked by the caller or NULL)
+static inline tx_kvs_slot_t __tx_kvs_find(tx_kvs_ht_t* kvs, uint64_t hash, void* key_ptr, uint32_t key_len,
+                                          tx_kvs_bucket_t* owned)
+{
+    uint16_t tag = __tx_kvs_tag(hash);
+    uint64_t idx = hash & kvs->bucket_mask;
+
+    for(uint64_t probes = 0; probes < kvs->num_buckets; ++probes){
+        tx_kvs_bucket_t* bucket = &kvs->buckets[idx];
+        tx_internal_obj_val_t* found_val;
+        int found_slot, has_empty;
+        uint32_t version = 0;
+        do{
+            found_val = NULL;
+            found_slot = -1;
+            has_empty = 0;
+            if(bucket != owned) { version = __tx_kvs_bucket_read_begin(bucket); }
+            for(int s = 0; s < TX_KVS_BUCKET_SLOTS; ++s){
+                uint16_t slot_tag = bucket->meta.tags[s];
+                if(slot_tag == TX_KVS_TAG_EMPTY) { has_empty = 1; continue; }
+                if(slot_tag != tag || bucket->meta.key_lens[s] != key_len) { continue; }
+                if(__tx_kvs_key_eq(bucket->keys[s], key_ptr, key_len)) {
+                    found_slot = s;
+                    found_val = bucket->meta.vals[s];
+                    break;
+                }
+            }
+        }while(bucket != owned && __tx_kvs_bucket_read_retry(bucket, version));
+
+        if(found_slot >= 0) { return (tx_kvs_slot_t) { bucket, found_slot, found_val }; }
+        // keys overflow to the next bucket only if all slots were occupied
+        if(has_empty) { break; }
+        idx = (idx + 1) & kvs->bucket_mask;
+    }
+    return (tx_kvs_slot_t) { NULL, -1, NULL };
+}
+
+// Writers serialize on the home bucket of the key (i.e., the first bucket of its probing sequence)
+static inline tx_kvs_bucket_t* __tx_kvs_home_bucket(tx_kvs_ht_t* kvs, uint64_t hash)
+{
+    return &kvs->buckets[hash & kvs->bucket_mask];
+}
+
+static inline void __tx_kvs_lock_other(tx_kvs_bucket_t* home, tx_kvs_bucket_t* bucket)
+{
+    if(bucket != home) { __tx_kvs_bucket_lock(bucket); }
+}
+
+static inline void __tx_kvs_unlock_other(tx_kvs_bucket_t* home, tx_kvs_bucket_t* bucket)
+{
+    if(bucket != home) { __tx_kvs_bucket_unlock(bucket); }
+}
+
+// home bucket must be locked and key must not exist -- returns 0 if the table is full
+static uint8_t __tx_kvs_add(tx_kvs_ht_t* kvs, uint64_t hash, void* key_ptr, uint32_t key_len,
+                         tx_internal_obj_val_t* int_obj_ptr)
+{
+    tx_kvs_bucket_t* home = __tx_kvs_home_bucket(kvs, hash);
+    uint64_t idx = hash & kvs->bucket_mask;
+
+    for(uint64_t probes = 0; probes < kvs->num_buckets; ++probes){
+        tx_kvs_bucket_t* bucket = &kvs->buckets[idx];
+        __tx_kvs_lock_other(home, bucket);
+        for(int s = 0; s < TX_KVS_BUCKET_SLOTS; ++s){
+            if(bucket->meta.tags[s] > TX_KVS_TAG_TOMBSTONE) { continue; }
+            memcpy(bucket->keys[s], key_ptr, key_len);
+            bucket->meta.key_lens[s] = key_len;
+            bucket->meta.vals[s] = int_obj_ptr;
+            bucket->meta.tags[s] = __tx_kvs_tag(hash);
+            __tx_kvs_unlock_other(home, bucket);
+            __sync_fetch_and_add(&kvs->num_keys, 1);
+            return 1;
+        }
+        __tx_kvs_unlock_other(home, bucket);
+        idx = (idx + 1) & kvs->bucket_mask;
+    }
+    return 0;
+}
+
+///////////////////////////////////////////////////////
+//////// KVS interface of the shim
+///////////////////////////////////////////////////////
+
+tx_internal_obj_val_t* tx_kvs_ht_get(void* kvs, void* key_ptr, uint32_t key_len)
+{
+    assert(key_len <= MAX_KEY_LEN);
+    uint64_t hash = __tx_kvs_hash(key_ptr, key_len);
+    return __tx_kvs_find((tx_kvs_ht_t *) kvs, hash, key_ptr, key_len, NULL).val;
+}
+
+// (the metadata line of the home bucket, where probing starts)
+void tx_kvs_ht_prefetch(void* kvs_ptr, void* key_ptr, uint32_t key_len)
+{
+    tx_kvs_ht_t* kvs = (tx_kvs_ht_t *) kvs_ptr;
+    __builtin_prefetch(&__tx_kvs_home_bucket(kvs, __tx_kvs_hash(key_ptr, key_len))->meta, 0, 3);
+}
+
+tx_internal_obj_val_t* tx_kvs_ht_insert(void* kvs_ptr, void* key_ptr, uint32_t key_len,
+                                        uint32_t alloc_len, uint32_t unique_alloc_id)
+{
+    assert(key_len <= MAX_KEY_LEN && alloc_len <= MAX_VAL_LEN);
+    tx_kvs_ht_t* kvs = (tx_kvs_ht_t *) kvs_ptr;
+    uint64_t hash = __tx_kvs_hash(key_ptr, key_len);
+    tx_kvs_bucket_t* home = __tx_kvs_home_bucket(kvs, hash);
+
+    __tx_kvs_bucket_lock(home);
+    if(__tx_kvs_find(kvs, hash, key_ptr, key_len, home).bucket != NULL){
+        __tx_kvs_bucket_unlock(home);
+        return NULL;
+    }
+
+    tx_internal_obj_val_t* int_obj_ptr = __tx_kvs_obj_alloc(alloc_len, unique_alloc_id);
+    int_obj_ptr->hdr.lock = 1;
+    int_obj_ptr->hdr.version = 1; // readers wait for the value to be installed
+
+    if(!__tx_kvs_add(kvs, hash, key_ptr, key_len, int_obj_ptr)){
+        tx_slab_free(int_obj_ptr); // (never visible to others)
+        int_obj_ptr = NULL;
+    }
+    __tx_kvs_bucket_unlock(home);
+    return int_obj_ptr;
+}
+
+// Inserts or replaces (never in-place) the value of a key
+int tx_kvs_ht_put(void* kvs_ptr, void* key_ptr, uint32_t key_len, void* val_ptr, uint32_t val_len)
+{
+    assert(key_len <= MAX_KEY_LEN && val_len <= MAX_VAL_LEN);
+    tx_kvs_ht_t* kvs = (tx_kvs_ht_t *) kvs_ptr;
+    uint64_t hash = __tx_kvs_hash(key_ptr, key_len);
+    tx_kvs_bucket_t* home = __tx_kvs_home_bucket(kvs, hash);
+
+    tx_internal_obj_val_t* int_obj_ptr = __tx_kvs_obj_alloc(val_len, 0);
+    memcpy(int_obj_ptr->val, val_ptr, val_len);
+    int_obj_ptr->hdr.curr_len = val_len;
+
+    __tx_kvs_bucket_lock(home);
+    tx_kvs_slot_t slot = __tx_kvs_find(kvs, hash, key_ptr, key_len, home);
+    if(slot.bucket == NULL){
+        if(!__tx_kvs_add(kvs, hash, key_ptr, key_len, int_obj_ptr)){
+            __tx_kvs_bucket_unlock(home);
+            tx_slab_free(int_obj_ptr); // (never visible to others)
+            return -1;
+        }
+    }else{
+        tx_internal_obj_val_t* old_obj_ptr = slot.val;
+        int_obj_ptr->hdr.unique_alloc_id = old_obj_ptr->hdr.unique_alloc_id;
+        int_obj_ptr->hdr.version = (__tx_obj_version(old_obj_ptr) | 1) + 1;
+
+        __tx_kvs_lock_other(home, slot.bucket);
+        slot.bucket->meta.vals[slot.slot] = int_obj_ptr;
+        __tx_kvs_unlock_other(home, slot.bucket);
+        __tx_kvs_obj_retire(old_obj_ptr);
+    }
+    __tx_kvs_bucket_unlock(home);
+    return val_len;
+}
+
+int tx_kvs_ht_del(void* kvs_ptr, void* key_ptr, uint32_t key_len)
+{
+    assert(key_len <= MAX_KEY_LEN);
+    tx_kvs_ht_t* kvs = (tx_kvs_ht_t *) kvs_ptr;
+    uint64_t hash = __tx_kvs_hash(key_ptr, key_len);
+    tx_kvs_bucket_t* home = __tx_kvs_home_bucket(kvs, hash);
+
+    __tx_kvs_bucket_lock(home);
+    tx_kvs_slot_t slot = __tx_kvs_find(kvs, hash, key_ptr, key_len, home);
+    if(slot.bucket == NULL){
+        __tx_kvs_bucket_unlock(home);
+        return -1;
+    }
+
+    tx_internal_obj_val_t* int_obj_ptr = slot.val;
+    __tx_kvs_lock_other(home, slot.bucket);
+    slot.bucket->meta.tags[slot.slot] = TX_KVS_TAG_TOMBSTONE;
+    slot.bucket->meta.vals[slot.slot] = NULL;
+    __tx_kvs_unlock_other(home, slot.bucket);
+    __tx_kvs_bucket_unlock(home);
+
+    __tx_kvs_obj_retire(int_obj_ptr);
+    __sync_fetch_and_sub(&kvs->num_keys, 1);
+    return 0;
+}
+
+const tx_kvs_ops_t tx_kvs_ht_ops = {
+    .name     = "ht",
+    .create   = tx_kvs_ht_create,
+    .destroy  = tx_kvs_ht_destroy,
+    .get      = tx_kvs_ht_get,
+    .insert   = tx_kvs_ht_insert,
+    .put      = tx_kvs_ht_put,
+    .del      = tx_kvs_ht_del,
+    .lock     = NULL,
+    .unlock   = NULL,
+    .validate = NULL,
+    .scan     = NULL,
+    .prefetch = tx_kvs_ht_prefetch,
+};
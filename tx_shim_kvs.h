@@ -0,0 +1,154 @@
+//
+// KVS backends of the shim (see tx_kvs_ops_t) -- shared helpers and the built-in hash table
+//
+
+/// Built-in hash table (tx_kvs_ht_ops)
+/// Open-addressing hash table w/ linear probing over cache-line aligned buckets
+/// -- 1st cache line of a bucket keeps the seqlock, tags, key lengths and ptrs to the values
+/// -- each of the next cache lines keeps one (inlined) key of up to MAX_KEY_LEN bytes
+/// Values are separately allocated objs (tx_header_t + val) so lookups return a ptr to them
+/// (i.e., a hit touches the metadata line, the line of the matching key and the object itself)
+
+/// Writers (insert / delete / replace) lock the bucket via its seqlock version,
+/// readers never write and simply retry if the bucket changed while they were probing it.
+/// The table is sized at creation and does not grow (i.e., inserts and puts of new keys fail once it is full).
+
+#ifndef TX_SHIM_KVS_H
+#define TX_SHIM_KVS_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include "tx_shim.h"
+#include "tx_shim_slab.h"
+
+#define TX_CACHE_LINE_SIZE 64
+#define TX_KVS_BUCKET_SLOTS 4 // + 1 metadata line --> 5 cache lines per bucket
+
+// tags are derived by the key hash; 0 and 1 are reserved
+#define TX_KVS_TAG_EMPTY     0 // never used slot --> terminates probing
+#define TX_KVS_TAG_TOMBSTONE 1 // deleted slot     --> may be reused but probing continues
+
+typedef struct
+{
+    uint32_t version;                          // seqlock (odd while a writer modifies the bucket)
+    uint16_t tags    [TX_KVS_BUCKET_SLOTS];
+    uint16_t key_lens[TX_KVS_BUCKET_SLOTS];
+    tx_internal_obj_val_t* vals[TX_KVS_BUCKET_SLOTS];
+} __attribute__((aligned(TX_CACHE_LINE_SIZE))) tx_kvs_bucket_meta_t;
+
+typedef struct
+{
+    tx_kvs_bucket_meta_t meta;
+    uint8_t keys[TX_KVS_BUCKET_SLOTS][MAX_KEY_LEN];
+} __attribute__((aligned(TX_CACHE_LINE_SIZE))) tx_kvs_bucket_t;
+
+typedef struct
+{
+    uint64_t num_buckets; // power of 2
+    uint64_t bucket_mask;
+    uint64_t num_keys;    // (approximate under concurrent writers)
+    tx_kvs_bucket_t* buckets;
+} tx_kvs_ht_t;
+
+
+
+/// Short keys (e.g., the fixed-width binary keys of TPC-C) are loaded as (at most) two possibly overlapping words
+/// (never reading past key_len), so they are hashed and compared w/o loops or variable-length memcpys.
+#define TX_KVS_SHORT_KEY_LEN 16
+
+static inline uint64_t __tx_kvs_load(const uint8_t* p, uint32_t n) // n <= 8
+{
+    uint64_t word = 0;
+    memcpy(&word, p, n);
+    return word;
+}
+
+// folds a key of up to TX_KVS_SHORT_KEY_LEN bytes into two words (equal iff the keys -- of the same len -- are equal)
+static inline void __tx_kvs_short_key_words(const uint8_t* key, uint32_t key_len, uint64_t* w0, uint64_t* w1)
+{
+    if(key_len >= 8){
+        *w0 = __tx_kvs_load(key, 8);
+        *w1 = __tx_kvs_load(key + key_len - 8, 8);
+    }else if(key_len >= 4){
+        *w0 = __tx_kvs_load(key, 4);
+        *w1 = __tx_kvs_load(key + key_len - 4, 4);
+    }else{
+        *w0 = key_len > 0 ? ((uint64_t) key[0] << 16) | ((uint64_t) key[key_len / 2] << 8) | key[key_len - 1] : 0;
+        *w1 = 0;
+    }
+}
+
+static inline uint8_t __tx_kvs_key_eq(const void* key_a, const void* key_b, uint32_t key_len)
+{
+    if(key_len > TX_KVS_SHORT_KEY_LEN) { return memcmp(key_a, key_b, key_len) == 0; }
+    uint64_t a0, a1, b0, b1;
+    __tx_kvs_short_key_words((const uint8_t *) key_a, key_len, &a0, &a1);
+    __tx_kvs_short_key_words((const uint8_t *) key_b, key_len, &b0, &b1);
+    return ((a0 ^ b0) | (a1 ^ b1)) == 0;
+}
+
+static inline uint64_t __tx_kvs_hash(const void* key_ptr, uint32_t key_len)
+{
+    const uint8_t* key = (const uint8_t *) key_ptr;
+    uint64_t h = 0x9E3779B97F4A7C15ULL ^ (key_len * 0xC2B2AE3D27D4EB4FULL);
+    uint64_t word;
+    uint32_t i = 0;
+    if(key_len <= TX_KVS_SHORT_KEY_LEN){
+        uint64_t w0, w1;
+        __tx_kvs_short_key_words(key, key_len, &w0, &w1);
+        h = (h ^ (w0 * 0x87C37B91114253D5ULL)) * 0x4CF5AD432745937FULL;
+        h ^= h >> 31;
+        h = (h ^ (w1 * 0x87C37B91114253D5ULL)) * 0x4CF5AD432745937FULL;
+        h ^= h >> 33;
+        h *= 0xFF51AFD7ED558CCDULL;
+        h ^= h >> 33;
+        return h;
+    }
+    for(; i + 8 <= key_len; i += 8){
+        memcpy(&word, key + i, 8);
+        h = (h ^ (word * 0x87C37B91114253D5ULL)) * 0x4CF5AD432745937FULL;
+        h ^= h >> 31;
+    }
+    if(i < key_len){
+        word = 0;
+        memcpy(&word, key + i, key_len - i);
+        h = (h ^ (word * 0x87C37B91114253D5ULL)) * 0x4CF5AD432745937FULL;
+    }
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDULL;
+    h ^= h >> 33;
+    return h;
+}
+
+static inline uint16_t __tx_kvs_tag(uint64_t hash)
+{
+    uint16_t tag = (uint16_t) (hash >> 48);
+    return tag > TX_KVS_TAG_TOMBSTONE ? tag : tag + 2;
+}
+
+
+
+///////////////////////////////////////////////////////
+//////// Objs (header + value) of the backends
+///////////////////////////////////////////////////////
+
+static inline tx_internal_obj_val_t* __tx_kvs_obj_alloc(uint32_t alloc_len, uint32_t unique_alloc_id)
+{
+    tx_internal_obj_val_t* int_obj_ptr = (tx_internal_obj_val_t *) tx_slab_alloc(INT_OBJ_LEN(alloc_len));
+    int_obj_ptr->hdr.lock = 0;
+    int_obj_ptr->hdr.version = 0;
+    int_obj_ptr->hdr.curr_len = 0;
+    int_obj_ptr->hdr.alloc_len = alloc_len;
+    int_obj_ptr->hdr.unique_alloc_id = unique_alloc_id;
+    return int_obj_ptr;
+}
+
+// Retired objs stay locked w/ a bumped (even) version so that txs that opened them fail on commit
+// and are freed once the txs that may still hold ptrs to them are over
+static inline void __tx_kvs_obj_retire(tx_internal_obj_val_t* int_obj_ptr)
+{
+    __tx_obj_mark_retired(int_obj_ptr);
+    __tx_epoch_retire(NULL, int_obj_ptr);
+}
+
+#endif //TX_SHIM_KVS_H
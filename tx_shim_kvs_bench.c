@@ -0,0 +1,124 @@
+//
+// Microbenchmark of the built-in KVS: lookups per second per core
+//
+// usage: ./kvs_bench [num_keys] [key_len] [val_len] [threads] [secs] [backend: ht | skiplist]
+// e.g. gcc -O3 -pthread tx_shim_kvs_bench.c tx_shim.c tx_shim_single.c tx_shim_trans.c tx_shim_slab.c
+//          tx_shim_kvs.c tx_shim_kvs_skiplist.c -o kvs_bench
+//
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include "tx_shim.h"
+#include "tx_shim_kvs.h"
+
+typedef struct
+{
+    tx_ctx_t* ctx;
+    int thread_id;
+    uint64_t num_keys;
+    uint32_t key_len;
+    double secs;
+    volatile uint8_t* stop;
+    uint64_t lookups;
+    uint64_t checksum;
+} bench_thread_t;
+
+// keys are the (zero-padded) little-endian id so that any key_len >= 8 is valid
+static inline void bench_key(uint8_t* key, uint32_t key_len, uint64_t id)
+{
+    memset(key, 0, key_len);
+    memcpy(key, &id, sizeof(uint64_t));
+}
+
+static inline uint64_t xorshift64(uint64_t* state)
+{
+    uint64_t x = *state;
+    x ^= x << 13; x ^= x >> 7; x ^= x << 17;
+    return *state = x;
+}
+
+static void* bench_lookups(void* arg)
+{
+    bench_thread_t* t = (bench_thread_t *) arg;
+
+    cpu_set_t cpuset;
+    CPU_ZERO(&cpuset);
+    CPU_SET(t->thread_id, &cpuset);
+    pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset);
+
+    uint8_t key[MAX_KEY_LEN];
+    uint64_t rand_state = 0x9E3779B97F4A7C15ULL * (t->thread_id + 1);
+    uint64_t lookups = 0, checksum = 0;
+
+    while(!*t->stop){
+        for(int i = 0; i < 1024; ++i){
+            bench_key(key, t->key_len, xorshift64(&rand_state) % t->num_keys);
+            tx_internal_obj_val_t* int_obj_ptr = __lookup(t->ctx, key, t->key_len);
+            checksum += int_obj_ptr->val[0];
+        }
+        lookups += 1024;
+    }
+
+    t->lookups = lookups;
+    t->checksum = checksum;
+    return NULL;
+}
+
+int main(int argc, char* argv[])
+{
+    uint64_t num_keys = argc > 1 ? strtoull(argv[1], NULL, 10) : 10000000;
+    uint32_t key_len  = argc > 2 ? atoi(argv[2]) : 16;
+    uint32_t val_len  = argc > 3 ? atoi(argv[3]) : 64;
+    int num_threads   = argc > 4 ? atoi(argv[4]) : 1;
+    double secs       = argc > 5 ? atof(argv[5]) : 5;
+    const tx_kvs_ops_t* kvs_ops = tx_kvs_ops_by_name(argc > 6 ? argv[6] : "ht");
+    assert(key_len >= sizeof(uint64_t) && key_len <= MAX_KEY_LEN && val_len <= MAX_VAL_LEN);
+    assert(kvs_ops != NULL);
+
+    void* kvs = kvs_ops->create(num_keys);
+    tx_ctx_t* ctx = malloc(sizeof(tx_ctx_t));
+    tx_ctx_init(ctx, kvs_ops, kvs);
+
+    uint8_t key[MAX_KEY_LEN];
+    uint8_t val[MAX_VAL_LEN] = {0};
+    for(uint64_t i = 0; i < num_keys; ++i){
+        bench_key(key, key_len, i);
+        val[0] = (uint8_t) i;
+        __set(ctx, key, key_len, val, val_len);
+    }
+    printf("Populated %lu keys (%s)\n", num_keys, kvs_ops->name);
+
+    volatile uint8_t stop = 0;
+    pthread_t threads[num_threads];
+    bench_thread_t args[num_threads];
+    for(int i = 0; i < num_threads; ++i){
+        args[i] = (bench_thread_t) { ctx, i, num_keys, key_len, secs, &stop, 0, 0 };
+        pthread_create(&threads[i], NULL, bench_lookups, &args[i]);
+    }
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    struct timespec duration = { (time_t) secs, (long) ((secs - (time_t) secs) * 1e9) };
+    nanosleep(&duration, NULL);
+    stop = 1;
+
+    uint64_t total_lookups = 0;
+    for(int i = 0; i < num_threads; ++i){
+        pthread_join(threads[i], NULL);
+        total_lookups += args[i].lookups;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double elapsed = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+    printf("Lookups: %.2f M/s total, %.2f M/s per core (%d threads, %u B keys, %u B values)\n",
+           total_lookups / elapsed / 1e6, total_lookups / elapsed / 1e6 / num_threads,
+           num_threads, key_len, val_len);
+
+    tx_ctx_destroy(ctx);
+    kvs_ops->destroy(kvs);
+    return 0;
+}
@@ -0,0 +1,315 @@
+//
+// Lock-free skiplist KVS backend of the shim (tx_kvs_skiplist_ops)
+//
+
+/// Ordered backend (supports scans) based on the lock-free skiplist of Herlihy & Shavit:
+/// -- nodes are linked into level 0 with a CAS (the linearization point of an insert) and then into higher levels
+/// -- deletes mark the next ptrs of a node (level 0 last, its linearization point) and
+///    the node is unlinked (snipped) by whoever traverses it next
+/// -- lookups and scans never write
+/// Keys (up to MAX_KEY_LEN bytes) are inlined in the nodes and ordered by memcmp (shorter first on ties).
+/// Values are objs (tx_header_t + val) as in the hash table; a put replaces the value ptr of the node.
+
+#include <stdlib.h>
+#include <memory.h>
+#include <assert.h>
+#include "tx_shim.h"
+#include "tx_shim_kvs.h"
+
+#define TX_SL_MAX_LEVEL 24
+
+typedef struct _tx_sl_node_t
+{
+    tx_internal_obj_val_t* volatile val;
+    uint16_t key_len;
+    uint8_t  top_level;
+    uint8_t  key[MAX_KEY_LEN];
+    struct _tx_sl_node_t* volatile next[]; // LSB set --> node is logically deleted (at that level)
+} tx_sl_node_t;
+
+typedef struct
+{
+    tx_sl_node_t* head; // -inf (tail is NULL / +inf)
+} tx_kvs_skiplist_t;
+
+
+static inline uint8_t        __tx_sl_is_marked(tx_sl_node_t* ptr) { return ((uintptr_t) ptr) & 1; }
+static inline tx_sl_node_t*  __tx_sl_mark     (tx_sl_node_t* ptr) { return (tx_sl_node_t *) (((uintptr_t) ptr) | 1); }
+static inline tx_sl_node_t*  __tx_sl_unmark   (tx_sl_node_t* ptr) { return (tx_sl_node_t *) (((uintptr_t) ptr) & ~(uintptr_t) 1); }
+
+static inline int __tx_sl_cmp(tx_sl_node_t* node, void* key_ptr, uint32_t key_len)
+{
+    uint32_t min_len = node->key_len < key_len ? node->key_len : key_len;
+    int cmp = memcmp(node->key, key_ptr, min_len);
+    if(cmp != 0) { return cmp; }
+    return (int) node->key_len - (int) key_len;
+}
+
+static inline uint8_t __tx_sl_random_level(void)
+{
+    static __thread uint64_t rand_state = 0;
+    if(rand_state == 0) { rand_state = (uintptr_t) &rand_state | 1; }
+    rand_state ^= rand_state << 13; rand_state ^= rand_state >> 7; rand_state ^= rand_state << 17;
+
+    // P(level >= l) = 1 / 4^l
+    uint8_t level = 0;
+    uint64_t bits = rand_state;
+    while(level < TX_SL_MAX_LEVEL - 1 && (bits & 3) == 0){
+        level++;
+        bits >>= 2;
+    }
+    return level;
+}
+
+static tx_sl_node_t* __tx_sl_node_alloc(uint8_t top_level, void* key_ptr, uint32_t key_len)
+{
+    tx_sl_node_t* node = tx_slab_alloc(sizeof(tx_sl_node_t) + (top_level + 1) * sizeof(tx_sl_node_t*));
+    node->val = NULL;
+    node->top_level = top_level;
+    node->key_len = key_len;
+    if(key_len > 0) { memcpy(node->key, key_ptr, key_len); } // (the head has no key)
+    return node;
+}
+
+
+
+///////////////////////////////////////////////////////
+//////// Traversals
+///////////////////////////////////////////////////////
+
+// Fills preds / succs of the key at every level (snipping any marked nodes on the way)
+// returns 1 if key is found (i.e., succs[0])
+static uint8_t __tx_sl_find(tx_kvs_skiplist_t* sl, void* key_ptr, uint32_t key_len,
+                            tx_sl_node_t** preds, tx_sl_node_t** succs)
+{
+retry:
+    {
+        tx_sl_node_t* pred = sl->head;
+        tx_sl_node_t* curr = NULL;
+        for(int level = TX_SL_MAX_LEVEL - 1; level >= 0; --level){
+            curr = __tx_sl_unmark(pred->next[level]);
+            while(curr != NULL){
+                tx_sl_node_t* succ = curr->next[level];
+                while(__tx_sl_is_marked(succ)){
+                    if(!__sync_bool_compare_and_swap(&pred->next[level], curr, __tx_sl_unmark(succ))) { goto retry; }
+                    curr = __tx_sl_unmark(succ);
+                    if(curr == NULL) { break; }
+                    succ = curr->next[level];
+                }
+                if(curr == NULL || __tx_sl_cmp(curr, key_ptr, key_len) >= 0) { break; }
+                pred = curr;
+                curr = __tx_sl_unmark(succ);
+            }
+            preds[level] = pred;
+            succs[level] = curr;
+        }
+        return curr != NULL && __tx_sl_cmp(curr, key_ptr, key_len) == 0;
+    }
+}
+
+// Read-only traversal; returns the first unmarked node with key >= key_ptr (NULL if none)
+static tx_sl_node_t* __tx_sl_lower_bound(tx_kvs_skiplist_t* sl, void* key_ptr, uint32_t key_len)
+{
+    tx_sl_node_t* pred = sl->head;
+    tx_sl_node_t* curr = NULL;
+    for(int level = TX_SL_MAX_LEVEL - 1; level >= 0; --level){
+        curr = __tx_sl_unmark(pred->next[level]);
+        while(curr != NULL){
+            tx_sl_node_t* succ = curr->next[level];
+            while(__tx_sl_is_marked(succ)){ // skip deleted nodes
+                curr = __tx_sl_unmark(succ);
+                if(curr == NULL) { break; }
+                succ = curr->next[level];
+            }
+            if(curr == NULL || __tx_sl_cmp(curr, key_ptr, key_len) >= 0) { break; }
+            pred = curr;
+            curr = __tx_sl_unmark(succ);
+        }
+    }
+    return curr;
+}
+
+// links an (unlinked) node; returns the existing node if key already exists
+static tx_sl_node_t* __tx_sl_link(tx_kvs_skiplist_t* sl, tx_sl_node_t* node)
+{
+    tx_sl_node_t* preds[TX_SL_MAX_LEVEL];
+    tx_sl_node_t* succs[TX_SL_MAX_LEVEL];
+
+    while(1){
+        if(__tx_sl_find(sl, node->key, node->key_len, preds, succs)) { return succs[0]; }
+
+        for(int level = 0; level <= node->top_level; ++level){
+            node->next[level] = succs[level];
+        }
+        if(__sync_bool_compare_and_swap(&preds[0]->next[0], succs[0], node)) { break; }
+    }
+
+    for(int level = 1; level <= node->top_level; ++level){
+        while(1){
+            tx_sl_node_t* next = node->next[level];
+            if(__tx_sl_is_marked(next)) { return NULL; } // deleted in the meantime
+            if(next != succs[level] && !__sync_bool_compare_and_swap(&node->next[level], next, succs[level])) { continue; }
+            if(__sync_bool_compare_and_swap(&preds[level]->next[level], succs[level], node)) {
+                // deleted (and maybe retired) right before getting linked here --> snip it before returning
+                if(__tx_sl_is_marked(node->next[level])) { __tx_sl_find(sl, node->key, node->key_len, preds, succs); }
+                break;
+            }
+            __tx_sl_find(sl, node->key, node->key_len, preds, succs);
+        }
+    }
+    return NULL;
+}
+
+
+
+///////////////////////////////////////////////////////
+//////// KVS interface of the shim
+///////////////////////////////////////////////////////
+
+static void* tx_kvs_skiplist_create(uint64_t max_keys)
+{
+    (void) max_keys; // (grows w/ the keys, i.e., no presizing)
+    tx_kvs_skiplist_t* sl = malloc(sizeof(tx_kvs_skiplist_t));
+    sl->head = __tx_sl_node_alloc(TX_SL_MAX_LEVEL - 1, NULL, 0);
+    for(int level = 0; level < TX_SL_MAX_LEVEL; ++level){
+        sl->head->next[level] = NULL;
+    }
+    return sl;
+}
+
+static void tx_kvs_skiplist_destroy(void* kvs)
+{
+    tx_kvs_skiplist_t* sl = (tx_kvs_skiplist_t *) kvs;
+    tx_sl_node_t* node = __tx_sl_unmark(sl->head->next[0]);
+    while(node != NULL){
+        tx_sl_node_t* next = __tx_sl_unmark(node->next[0]);
+        if(!__tx_sl_is_marked(node->next[0])) { // (deleted nodes are already retired)
+            tx_slab_free(node->val);
+            tx_slab_free(node);
+        }
+        node = next;
+    }
+    tx_slab_free(sl->head);
+    free(sl);
+}
+
+static tx_internal_obj_val_t* tx_kvs_skiplist_get(void* kvs, void* key_ptr, uint32_t key_len)
+{
+    assert(key_len <= MAX_KEY_LEN);
+    tx_sl_node_t* node = __tx_sl_lower_bound((tx_kvs_skiplist_t *) kvs, key_ptr, key_len);
+    if(node == NULL || __tx_sl_cmp(node, key_ptr, key_len) != 0) { return NULL; }
+    return node->val;
+}
+
+static tx_internal_obj_val_t* tx_kvs_skiplist_insert(void* kvs, void* key_ptr, uint32_t key_len,
+                                                     uint32_t alloc_len, uint32_t unique_alloc_id)
+{
+    assert(key_len <= MAX_KEY_LEN && alloc_len <= MAX_VAL_LEN);
+    tx_internal_obj_val_t* int_obj_ptr = __tx_kvs_obj_alloc(alloc_len, unique_alloc_id);
+    int_obj_ptr->hdr.lock = 1;
+    int_obj_ptr->hdr.version = 1; // readers wait for the value to be installed
+
+    tx_sl_node_t* node = __tx_sl_node_alloc(__tx_sl_random_level(), key_ptr, key_len);
+    node->val = int_obj_ptr;
+    if(__tx_sl_link((tx_kvs_skiplist_t *) kvs, node) != NULL){
+        tx_slab_free(int_obj_ptr);
+        tx_slab_free(node);
+        return NULL;
+    }
+    return int_obj_ptr;
+}
+
+// Inserts or replaces (never in-place) the value of a key
+static int tx_kvs_skiplist_put(void* kvs, void* key_ptr, uint32_t key_len, void* val_ptr, uint32_t val_len)
+{
+    assert(key_len <= MAX_KEY_LEN && val_len <= MAX_VAL_LEN);
+    tx_kvs_skiplist_t* sl = (tx_kvs_skiplist_t *) kvs;
+
+    tx_internal_obj_val_t* int_obj_ptr = __tx_kvs_obj_alloc(val_len, 0);
+    memcpy(int_obj_ptr->val, val_ptr, val_len);
+    int_obj_ptr->hdr.curr_len = val_len;
+
+    tx_sl_node_t* node = __tx_sl_node_alloc(__tx_sl_random_level(), key_ptr, key_len);
+    node->val = int_obj_ptr;
+
+    while(1){
+        tx_sl_node_t* existing = __tx_sl_link(sl, node);
+        if(existing == NULL) { return val_len; }
+
+        tx_internal_obj_val_t* old_obj_ptr = existing->val;
+        if(old_obj_ptr == NULL) { continue; } // being deleted
+        int_obj_ptr->hdr.unique_alloc_id = old_obj_ptr->hdr.unique_alloc_id;
+        int_obj_ptr->hdr.version = (__tx_obj_version(old_obj_ptr) | 1) + 1;
+        if(__tx_sl_is_marked(existing->next[0])) { continue; } // being deleted --> insert a new node
+        if(__sync_bool_compare_and_swap(&existing->val, old_obj_ptr, int_obj_ptr)){
+            __tx_kvs_obj_retire(old_obj_ptr);
+            tx_slab_free(node);
+            return val_len;
+        }
+    }
+}
+
+static int tx_kvs_skiplist_del(void* kvs, void* key_ptr, uint32_t key_len)
+{
+    assert(key_len <= MAX_KEY_LEN);
+    tx_kvs_skiplist_t* sl = (tx_kvs_skiplist_t *) kvs;
+    tx_sl_node_t* preds[TX_SL_MAX_LEVEL];
+    tx_sl_node_t* succs[TX_SL_MAX_LEVEL];
+
+    if(!__tx_sl_find(sl, key_ptr, key_len, preds, succs)) { return -1; }
+    tx_sl_node_t* victim = succs[0];
+
+    for(int level = victim->top_level; level >= 1; --level){
+        tx_sl_node_t* next = victim->next[level];
+        while(!__tx_sl_is_marked(next)){
+            __sync_bool_compare_and_swap(&victim->next[level], next, __tx_sl_mark(next));
+            next = victim->next[level];
+        }
+    }
+
+    while(1){
+        tx_sl_node_t* next = victim->next[0];
+        if(__tx_sl_is_marked(next)) { return -1; } // deleted by someone else
+        if(__sync_bool_compare_and_swap(&victim->next[0], next, __tx_sl_mark(next))) { break; }
+    }
+
+    // (swapped out so that a racing put cannot replace -- and retire -- the same value)
+    __tx_kvs_obj_retire(__sync_lock_test_and_set(&victim->val, NULL));
+    __tx_sl_find(sl, key_ptr, key_len, preds, succs); // snip it (from all levels)
+    __tx_epoch_retire(NULL, victim);                  // others may still traverse it
+    return 0;
+}
+
+static int tx_kvs_skiplist_scan(void* kvs, void* from_key, uint32_t from_len, void* to_key, uint32_t to_len,
+                                tx_kvs_scan_cb cb, void* cb_arg)
+{
+    int scanned = 0;
+    tx_sl_node_t* node = __tx_sl_lower_bound((tx_kvs_skiplist_t *) kvs, from_key, from_len);
+    while(node != NULL){
+        if(to_key != NULL && __tx_sl_cmp(node, to_key, to_len) >= 0) { break; }
+
+        tx_sl_node_t* next = node->next[0];
+        tx_internal_obj_val_t* val = node->val;
+        if(!__tx_sl_is_marked(next) && val != NULL){
+            scanned++;
+            if(cb(node->key, node->key_len, val, cb_arg)) { break; }
+        }
+        node = __tx_sl_unmark(next);
+    }
+    return scanned;
+}
+
+const tx_kvs_ops_t tx_kvs_skiplist_ops = {
+    .name     = "skiplist",
+    .create   = tx_kvs_skiplist_create,
+    .destroy  = tx_kvs_skiplist_destroy,
+    .get      = tx_kvs_skiplist_get,
+    .insert   = tx_kvs_skiplist_insert,
+    .put      = tx_kvs_skiplist_put,
+    .del      = tx_kvs_skiplist_del,
+    .lock     = NULL,
+    .unlock   = NULL,
+    .validate = NULL,
+    .scan     = tx_kvs_skiplist_scan,
+    .prefetch = NULL, // (the path to a key is a chain of dependent loads)
+};
@@ -0,0 +1,111 @@
+//
+// Deterministic partitioned execution (see tx_shim_part.h)
+//
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <sched.h>
+#include "tx_shim_part.h"
+
+void tx_part_sched_init(tx_part_sched_t* sched, uint32_t num_parts)
+{
+    assert(num_parts > 0 && num_parts <= TX_PART_MAX);
+    sched->num_parts = num_parts;
+    sched->num_finished = 0;
+    pthread_mutex_init(&sched->seq_lock, NULL);
+    sched->next_seq = 0;
+    sched->num_sequenced = 0;
+    sched->parts = aligned_alloc(64, num_parts * sizeof(tx_part_t));
+    memset(sched->parts, 0, num_parts * sizeof(tx_part_t));
+}
+
+void tx_part_sched_destroy(tx_part_sched_t* sched)
+{
+    pthread_mutex_destroy(&sched->seq_lock);
+    free(sched->parts);
+    sched->parts = NULL;
+}
+
+void tx_part_attach(tx_part_sched_t* sched, uint32_t part_id, tx_ctx_t* tx_ctx)
+{
+    assert(part_id < sched->num_parts);
+    tx_ctx->exclusive = 1;
+    __atomic_store_n(&sched->parts[part_id].tx_ctx, tx_ctx, __ATOMIC_RELEASE);
+}
+
+static inline void __tx_part_relax(uint32_t* spins)
+{
+    if(++*spins % TX_PART_SPINS == 0) { sched_yield(); }
+    else { TX_CPU_RELAX(); }
+}
+
+// the worker of the partition reached the tx in its queue: runs it if every other partition is parked on it,
+// otherwise parks until it is done
+static void __tx_part_arrive(tx_part_t* part, tx_part_req_t* req)
+{
+    if(__atomic_add_fetch(&req->arrived, 1, __ATOMIC_ACQ_REL) == req->num_parts){
+        req->result = req->fn(part->tx_ctx, req->arg);
+        __atomic_store_n(&req->done, 1, __ATOMIC_RELEASE);
+        return;
+    }
+    uint32_t spins = 0;
+    while(!__atomic_load_n(&req->done, __ATOMIC_ACQUIRE)) { __tx_part_relax(&spins); }
+    __atomic_sub_fetch(&req->parked, 1, __ATOMIC_RELEASE); // (the last access to the req)
+}
+
+void tx_part_poll(tx_part_sched_t* sched, uint32_t part_id)
+{
+    tx_part_t* part = &sched->parts[part_id];
+    while(part->head != __atomic_load_n(&part->tail, __ATOMIC_ACQUIRE)){
+        tx_part_req_t* req = part->queue[part->head % TX_PART_QUEUE_LEN];
+        __atomic_store_n(&part->head, part->head + 1, __ATOMIC_RELEASE);
+        __tx_part_arrive(part, req);
+    }
+}
+
+// appends the tx to the queues of its partitions, in the order of its sequence number
+static void __tx_part_sequence(tx_part_sched_t* sched, const tx_part_set_t* parts, tx_part_req_t* req)
+{
+    pthread_mutex_lock(&sched->seq_lock);
+    req->seq = sched->next_seq++;
+    sched->num_sequenced++;
+    for(uint32_t p = 0; p < sched->num_parts; ++p){
+        if(!tx_part_set_has(parts, p)) { continue; }
+        tx_part_t* part = &sched->parts[p];
+        assert(part->tail - __atomic_load_n(&part->head, __ATOMIC_ACQUIRE) < TX_PART_QUEUE_LEN);
+        part->queue[part->tail % TX_PART_QUEUE_LEN] = req;
+        __atomic_store_n(&part->tail, part->tail + 1, __ATOMIC_RELEASE);
+    }
+    pthread_mutex_unlock(&sched->seq_lock);
+}
+
+int tx_part_exec(tx_part_sched_t* sched, uint32_t part_id, const tx_part_set_t* parts, tx_part_fn fn, void* arg)
+{
+    if(tx_part_set_is_local(parts, part_id)) { return fn(sched->parts[part_id].tx_ctx, arg); }
+
+    uint32_t num_parts = tx_part_set_count(parts);
+    tx_part_req_t req = { .fn = fn, .arg = arg, .num_parts = num_parts, .parked = num_parts - 1 };
+    __tx_part_sequence(sched, parts, &req);
+
+    // serves the queue meanwhile (i.e., incl. the req itself if it is of this partition too)
+    uint32_t spins = 0;
+    while(!__atomic_load_n(&req.done, __ATOMIC_ACQUIRE) || __atomic_load_n(&req.parked, __ATOMIC_ACQUIRE) > 0){
+        tx_part_poll(sched, part_id);
+        __tx_part_relax(&spins);
+    }
+    return req.result;
+}
+
+void tx_part_finish(tx_part_sched_t* sched, uint32_t part_id)
+{
+    __atomic_add_fetch(&sched->num_finished, 1, __ATOMIC_ACQ_REL);
+    uint32_t spins = 0;
+    while(__atomic_load_n(&sched->num_finished, __ATOMIC_ACQUIRE) < sched->num_parts){
+        tx_part_poll(sched, part_id);
+        __tx_part_relax(&spins);
+    }
+    tx_part_poll(sched, part_id);
+    assert(sched->parts[part_id].head == sched->parts[part_id].tail);
+    sched->parts[part_id].tx_ctx->exclusive = 0;
+}
@@ -0,0 +1,123 @@
+//
+// Deterministic partitioned execution (H-Store / Calvin style): the keys are split into partitions, each owned by the
+//  ctx of one worker, which runs the txs of its partition serially and commits them w/o locks or validation
+//
+
+/// A tx declares the partitions of all the keys it accesses before it runs (from its input or, if it looks keys up
+/// by the values of others, from a reconnaissance read of those which it then checks while it runs -- OLLP):
+/// -- a tx of the partition of its worker only runs right away on the ctx of the worker
+/// -- every other tx is sequenced: it gets the next (global) sequence number and is appended, in that order, to the
+///    queue of each of its partitions. A worker that reaches a tx in its queue parks on it (i.e., grants its partition
+///    to it) and the last of its partitions to arrive runs it on its ctx, while the others wait for it to finish.
+/// Partitions are granted in the order of the sequence (i.e., there are no deadlocks) and a tx runs while it holds all
+/// its partitions (i.e., it never conflicts), so the outcome of the txs only depends on their order.
+/// A worker waits for the txs it submits while serving its queue and has at most one of them in flight, so:
+/// -- workers call tx_part_poll before each of their txs (a local tx runs w/o serving the queue, i.e., the partition
+///    does not change between the poll and the tx, e.g., after a reconnaissance read of its keys) and tx_part_finish
+///    once they have no more txs to submit (which serves the queue until every worker is done)
+/// -- a queue holds at most one tx per worker (i.e., TX_MAX_THREADS)
+/// The ctxs of the workers are exclusive (see tx_trans_commit) from tx_part_attach to tx_part_finish: the txs of a
+/// partitioned run must not access the keys of partitions they did not declare and no other txs (or single ops that
+/// write) may run concurrently on the keys of the partitions.
+
+#ifndef TX_SHIM_PART_H
+#define TX_SHIM_PART_H
+
+#include <pthread.h>
+#include <stdint.h>
+#include "tx_shim.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TX_PART_MAX TX_MAX_THREADS          // (one per worker)
+#define TX_PART_QUEUE_LEN TX_MAX_THREADS    // (a tx in flight per worker)
+#define TX_PART_SPINS 1024                  // a waiting worker yields after that many spins (e.g., if oversubscribed)
+
+// runs a tx on the ctx of one of its partitions (i.e., incl. its retries) -- the result is returned by tx_part_exec
+typedef int (*tx_part_fn)(tx_ctx_t* tx_ctx, void* arg);
+
+// the partitions of a tx
+typedef struct
+{
+    uint64_t bits[TX_PART_MAX / 64];
+} tx_part_set_t;
+
+// a sequenced tx (on the stack of its submitter)
+typedef struct
+{
+    tx_part_fn fn;
+    void*      arg;
+    uint64_t   seq;
+    uint32_t   num_parts;
+    uint32_t   arrived;   // partitions that reached it in their queue
+    uint32_t   parked;    // partitions still waiting on it (i.e., all but the one that runs it)
+    uint8_t    done;
+    int        result;
+} tx_part_req_t;
+
+typedef struct
+{
+    tx_ctx_t* tx_ctx;          // of the worker that owns the partition
+    uint32_t head;             // (the owner)
+    uint32_t tail;             // (the sequencer)
+    tx_part_req_t* queue[TX_PART_QUEUE_LEN];
+} __attribute__((aligned(64))) tx_part_t;
+
+typedef struct
+{
+    uint32_t num_parts;
+    uint32_t num_finished;     // workers w/ no more txs to submit
+    pthread_mutex_t seq_lock;
+    uint64_t next_seq;
+    uint64_t num_sequenced;    // (stats) txs of more than one partition or of another worker
+    tx_part_t* parts;
+} tx_part_sched_t;
+
+static inline void tx_part_set_clear(tx_part_set_t* set){
+    memset(set, 0, sizeof(*set));
+}
+
+static inline void tx_part_set_add(tx_part_set_t* set, uint32_t part_id){
+    assert(part_id < TX_PART_MAX);
+    set->bits[part_id / 64] |= 1ULL << (part_id % 64);
+}
+
+static inline uint8_t tx_part_set_has(const tx_part_set_t* set, uint32_t part_id){
+    return (set->bits[part_id / 64] >> (part_id % 64)) & 1;
+}
+
+static inline uint32_t tx_part_set_count(const tx_part_set_t* set){
+    uint32_t num = 0;
+    for(uint32_t i = 0; i < TX_PART_MAX / 64; ++i) { num += __builtin_popcountll(set->bits[i]); }
+    return num;
+}
+
+// a tx of (at most) the partition only, i.e., that its worker runs right away
+static inline uint8_t tx_part_set_is_local(const tx_part_set_t* set, uint32_t part_id){
+    uint32_t num = tx_part_set_count(set);
+    return num == 0 || (num == 1 && tx_part_set_has(set, part_id));
+}
+
+void tx_part_sched_init(tx_part_sched_t* sched, uint32_t num_parts);
+void tx_part_sched_destroy(tx_part_sched_t* sched);
+
+// called by the worker of the partition (w/ its ctx) before it submits or serves txs -- the ctx becomes exclusive
+void tx_part_attach(tx_part_sched_t* sched, uint32_t part_id, tx_ctx_t* tx_ctx);
+
+// runs a tx of the partitions parts (submitted by the worker of part_id) and returns fn's result -- right away if it
+// is local, otherwise once it is sequenced and holds its partitions (serving the queue of part_id meanwhile)
+int tx_part_exec(tx_part_sched_t* sched, uint32_t part_id, const tx_part_set_t* parts, tx_part_fn fn, void* arg);
+
+// runs / parks on the txs in the queue of the partition (by its worker)
+void tx_part_poll(tx_part_sched_t* sched, uint32_t part_id);
+
+// serves the queue of the partition until the workers of all partitions are done (the ctx is no longer exclusive)
+void tx_part_finish(tx_part_sched_t* sched, uint32_t part_id);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //TX_SHIM_PART_H
@@ -6,6 +6,7 @@
 #include <memory.h>
 #include <assert.h>
 #include "tx_shim.h"
+#include "tx_shim_slab.h"
 
 
 
@@ -15,7 +16,8 @@
 
 void* tx_single_obj_alloc(tx_ctx_t *tx_ctx, uint32_t max_obj_len, uint32_t unique_alloc_id)
 {
-    tx_internal_obj_val_t* obj_ptr = malloc(INT_OBJ_LEN(max_obj_len));
+    (void) tx_ctx; // (mem objs do not go through the kvs of the ctx)
+    tx_internal_obj_val_t* obj_ptr = tx_slab_alloc(INT_OBJ_LEN(max_obj_len));
     obj_ptr->hdr.lock = 0;
     obj_ptr->hdr.version = 0;
     obj_ptr->hdr.curr_len = 0;
@@ -25,37 +27,59 @@ void* tx_single_obj_alloc(tx_ctx_t *tx_ctx, uint32_t max_obj_len, uint32_t uniqu
 }
 
 
+// the memory is recycled once no tx (of any ctx) that may have accessed the obj is active
 tx_op_result tx_single_obj_free(tx_ctx_t *tx_ctx, void* obj_ptr)
 {
     tx_internal_obj_val_t* int_obj_ptr = __obj_ptr_2_internal_obj_ptr(obj_ptr);
-    free(int_obj_ptr);
+    __tx_epoch_retire(tx_ctx, int_obj_ptr);
+    return successful;
 }
 
 
 tx_op_result tx_single_obj_read(tx_ctx_t *tx_ctx, void* obj_ptr, void* ret_buf, uint32_t bytes_to_read)
 {
+    (void) tx_ctx; // (mem objs do not go through the kvs of the ctx)
     tx_internal_obj_val_t* int_obj_ptr = __obj_ptr_2_internal_obj_ptr(obj_ptr);
-    // Lock
+    uint16_t curr_len;
     LOCK_FREE_READ_BEGIN();
-    assert(bytes_to_read <= int_obj_ptr->hdr.curr_len);
-    memcpy(ret_buf, int_obj_ptr->val, bytes_to_read);
+    curr_len = int_obj_ptr->hdr.curr_len;
+    if(bytes_to_read <= curr_len){
+        memcpy(ret_buf, int_obj_ptr->val, bytes_to_read);
+    }
     LOCK_FREE_READ_END();
-    // Unlock
+    return bytes_to_read <= curr_len ? successful : err_exceeds_internal_allocated_space;
 }
 
 
 tx_op_result tx_single_obj_write(tx_ctx_t *tx_ctx, void* obj_ptr, void* val_ptr, uint32_t bytes_to_write)
 {
+    (void) tx_ctx; // (mem objs do not go through the kvs of the ctx)
     tx_internal_obj_val_t* int_obj_ptr = __obj_ptr_2_internal_obj_ptr(obj_ptr);
-    // Lock
-    int_obj_ptr->hdr.version++;
+    if(bytes_to_write > int_obj_ptr->hdr.alloc_len) { return err_exceeds_internal_allocated_space; }
+
+    // unlike the (no-wait) commit, wait for the writer lock (held only while a tx commits)
+    while(!__tx_obj_try_lock(int_obj_ptr)) { TX_CPU_RELAX(); }
+    __tx_obj_install(int_obj_ptr, val_ptr, bytes_to_write);
+    __tx_obj_unlock(int_obj_ptr);
+    return successful;
+}
 
-    assert(bytes_to_write <= int_obj_ptr->hdr.alloc_len);
-    memcpy(int_obj_ptr->val, val_ptr, bytes_to_write);
-    int_obj_ptr->hdr.curr_len = bytes_to_write;
 
-    int_obj_ptr->hdr.version++;
-    // Unlock
+
+///////////////////////////////////////////////////////
+//////// Sequences
+///////////////////////////////////////////////////////
+
+tx_seq_t* tx_seq_create(uint64_t first)
+{
+    tx_seq_t* seq = tx_slab_alloc(sizeof(tx_seq_t));
+    seq->next = first;
+    return seq;
+}
+
+void tx_seq_free(tx_ctx_t *tx_ctx, tx_seq_t* seq)
+{
+    __tx_epoch_retire(tx_ctx, seq);
 }
 
 
@@ -64,31 +88,97 @@ tx_op_result tx_single_obj_write(tx_ctx_t *tx_ctx, void* obj_ptr, void* val_ptr,
 //////// Single KV Implementation
 ///////////////////////////////////////////////////////
 
-tx_op_result tx_single_get(tx_ctx_t *tx_ctx, void* key_ptr, uint32_t key_len,
-                           tx_internal_obj_val_t *ret_obj, uint32_t buf_len)
+/// Items are replaced or removed by the backends only while their writer lock is held and stay locked afterwards,
+/// so a locked item is re-looked up before it is trusted and writers re-look up the key if locking fails.
+/// Accesses are wrapped in an epoch, since the item may be retired concurrently.
+
+tx_op_result tx_single_kv_get(tx_ctx_t *tx_ctx, void* key_ptr, uint32_t key_len, void* buf_ptr, uint32_t* val_len)
+{
+    tx_op_result res;
+    __tx_epoch_enter(tx_ctx);
+    for(;;){
+        tx_internal_obj_val_t* int_obj_ptr = __lookup(tx_ctx, key_ptr, key_len);
+        if(int_obj_ptr == NULL) { res = non_existent; break; }
+
+        uint16_t curr_len;
+        LOCK_FREE_READ_BEGIN();
+        curr_len = int_obj_ptr->hdr.curr_len;
+        if(curr_len <= *val_len){
+            memcpy(buf_ptr, int_obj_ptr->val, curr_len);
+        }
+        LOCK_FREE_READ_END();
+
+        // the item may have been removed (or replaced) after we looked it up
+        if(__tx_obj_is_locked(int_obj_ptr) && __lookup(tx_ctx, key_ptr, key_len) != int_obj_ptr) { continue; }
+
+        res = curr_len <= *val_len ? successful : err_exceeds_provided_allocated_space;
+        *val_len = curr_len;
+        break;
+    }
+    __tx_epoch_exit(tx_ctx);
+    return res;
+}
+
+void tx_single_kv_prefetch(tx_ctx_t *tx_ctx, void* key_ptr, uint32_t key_len, uint32_t obj_len)
 {
-    // TODO locking might be required if the same object can be accessed by the TX API
-    /// I.E. May need to retry if ret_obj->hdr.version % 2 == 1; (seqlocks)
-    __get(tx_ctx, key_ptr, key_len, ret_obj, INT_OBJ_LEN(ret_obj->hdr.alloc_len));
+    if(obj_len == 0) { __prefetch(tx_ctx, key_ptr, key_len); return; }
+#ifndef TX_KVS_HT_ONLY
+    // w/o a prefetch op, the index entry is not cached and the lookup would wait on its misses (i.e., no overlap)
+    if(tx_ctx->kvs_ops != &tx_kvs_ht_ops && tx_ctx->kvs_ops->prefetch == NULL) { return; }
+#endif
+
+    __tx_epoch_enter(tx_ctx);
+    tx_internal_obj_val_t* int_obj_ptr = __lookup(tx_ctx, key_ptr, key_len);
+    if(int_obj_ptr != NULL) { __tx_obj_prefetch(int_obj_ptr, obj_len); }
+    __tx_epoch_exit(tx_ctx);
 }
 
-tx_op_result tx_single_set(tx_ctx_t *tx_ctx, void* key_ptr, uint32_t key_len,
-                           tx_internal_obj_val_t *val_obj, uint32_t val_len)
+tx_op_result tx_single_kv_set(tx_ctx_t *tx_ctx, void* key_ptr, uint32_t key_len, void* val_ptr, uint32_t val_len)
 {
-    // TODO locking might be required if the same object can be accessed by the TX API
-    uint8_t __tmp_buff[INT_OBJ_LEN(MAX_VAL_LEN)];
-    tx_internal_obj_val_t *max_val_obj = (tx_internal_obj_val_t *) __tmp_buff;
-    max_val_obj->hdr.alloc_len = MAX_VAL_LEN;
-    int length = __get(tx_ctx, key_ptr, key_len, max_val_obj, INT_OBJ_LEN(max_val_obj->hdr.alloc_len));
-    if(length < 0){ // object does not exists
-        // TODO see trans of KV implementation of creating a header
+    if(val_len > MAX_VAL_LEN) { return err_exceeds_internal_allocated_space; }
+
+    tx_op_result res = successful;
+    __tx_epoch_enter(tx_ctx);
+    for(;;){
+        tx_internal_obj_val_t* int_obj_ptr = __lookup(tx_ctx, key_ptr, key_len);
+        if(int_obj_ptr == NULL){
+            // insert a (locked) placeholder -- fails if the key was inserted concurrently (or the kvs is full)
+            int_obj_ptr = __insert(tx_ctx, key_ptr, key_len, val_len, 0);
+            if(int_obj_ptr == NULL){
+                if(__lookup(tx_ctx, key_ptr, key_len) != NULL) { continue; } // (otherwise the kvs is full)
+                res = err_other;
+                break;
+            }
+        }else if(!__tx_obj_try_lock(int_obj_ptr)){
+            TX_CPU_RELAX();
+            continue;
+        }
+
+        if(val_len <= int_obj_ptr->hdr.alloc_len){
+            __tx_obj_install(int_obj_ptr, val_ptr, val_len);
+            __tx_obj_unlock(int_obj_ptr);
+        }else{
+            // does not fit -- the backend replaces the (still locked) item which is never unlocked
+            __set(tx_ctx, key_ptr, key_len, val_ptr, val_len);
+        }
+        break;
     }
-    val_obj->hdr.alloc_len = max_val_obj->hdr.alloc_len;
-    val_obj->hdr.alloc_len = max_val_obj->hdr.alloc_len;
-    __del(tx_ctx, key_ptr, key_len);
+    __tx_epoch_exit(tx_ctx);
+    return res;
 }
 
-tx_op_result tx_single_del(tx_ctx_t *tx_ctx, void* key_ptr, uint32_t key_len)
+tx_op_result tx_single_kv_del(tx_ctx_t *tx_ctx, void* key_ptr, uint32_t key_len)
 {
-    __del(tx_ctx, key_ptr, key_len);
+    tx_op_result res = successful;
+    __tx_epoch_enter(tx_ctx);
+    for(;;){
+        tx_internal_obj_val_t* int_obj_ptr = __lookup(tx_ctx, key_ptr, key_len);
+        if(int_obj_ptr == NULL) { res = non_existent; break; }
+        if(!__tx_obj_try_lock(int_obj_ptr)) { TX_CPU_RELAX(); continue; }
+
+        __del(tx_ctx, key_ptr, key_len); // retires the (still locked) item
+        break;
+    }
+    __tx_epoch_exit(tx_ctx);
+    return res;
 }
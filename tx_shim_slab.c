@@ -0,0 +1,101 @@
+//
+// Per-thread size-class slab allocator (see tx_shim_slab.h)
+//
+
+#include <stdlib.h>
+#include <assert.h>
+#include <sys/mman.h>
+#include "tx_shim_slab.h"
+
+#ifdef __SANITIZE_ADDRESS__ // (free slots are poisoned, i.e., ASAN reports accesses to reclaimed objs)
+#include <sanitizer/asan_interface.h>
+#define TX_SLAB_POISON(ptr, len)   ASAN_POISON_MEMORY_REGION(ptr, len)
+#define TX_SLAB_UNPOISON(ptr, len) ASAN_UNPOISON_MEMORY_REGION(ptr, len)
+#else
+#define TX_SLAB_POISON(ptr, len)
+#define TX_SLAB_UNPOISON(ptr, len)
+#endif
+
+typedef struct
+{
+    void*    free_list[TX_SLAB_NUM_CLASSES]; // linked through the first word of the free slots
+    uint8_t* bump     [TX_SLAB_NUM_CLASSES]; // next never-used slot of the current slab of each class
+    uint8_t* bump_end [TX_SLAB_NUM_CLASSES];
+} tx_slab_cache_t;
+
+static __thread tx_slab_cache_t tx_slab_cache;
+
+static inline tx_slab_t* __tx_slab_of(void* ptr)
+{
+    return (tx_slab_t *) ((uintptr_t) ptr & ~((uintptr_t) TX_SLAB_SIZE - 1));
+}
+
+// size must be a multiple of TX_SLAB_SIZE
+static tx_slab_t* __tx_slab_create(uint32_t class_id, uint64_t size)
+{
+    tx_slab_t* slab = NULL;
+    uint8_t is_mmaped = 0;
+#ifdef TX_SLAB_HUGETLB
+    void* addr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if(addr != MAP_FAILED) {
+        slab = (tx_slab_t *) addr; // hugepage mappings are hugepage aligned
+        is_mmaped = 1;
+    }
+#endif
+    if(slab == NULL){ // no (free) hugetlb pages --> fallback to (transparent) hugepages
+        slab = aligned_alloc(TX_SLAB_SIZE, size);
+        assert(slab != NULL);
+        madvise(slab, size, MADV_HUGEPAGE);
+    }
+    slab->class_id = class_id;
+    slab->is_mmaped = is_mmaped;
+    slab->size = size;
+    return slab;
+}
+
+static void* __tx_slab_alloc_large(uint32_t len)
+{
+    uint64_t size = ((uint64_t) len + TX_SLAB_HDR_SIZE + TX_SLAB_SIZE - 1) & ~((uint64_t) TX_SLAB_SIZE - 1);
+    return (uint8_t *) __tx_slab_create(TX_SLAB_LARGE, size) + TX_SLAB_HDR_SIZE;
+}
+
+void* tx_slab_alloc(uint32_t len)
+{
+    uint32_t class_id = __tx_slab_class(len);
+    if(class_id >= TX_SLAB_NUM_CLASSES) { return __tx_slab_alloc_large(len); }
+
+    tx_slab_cache_t* cache = &tx_slab_cache;
+    void* ptr = cache->free_list[class_id];
+    if(ptr != NULL){
+        TX_SLAB_UNPOISON(ptr, __tx_slab_class_size(class_id));
+        cache->free_list[class_id] = *(void **) ptr;
+        return ptr;
+    }
+
+    uint32_t class_size = __tx_slab_class_size(class_id);
+    if(cache->bump[class_id] == NULL || cache->bump[class_id] + class_size > cache->bump_end[class_id]){
+        uint8_t* slab = (uint8_t *) __tx_slab_create(class_id, TX_SLAB_SIZE);
+        cache->bump[class_id] = slab + TX_SLAB_HDR_SIZE;
+        cache->bump_end[class_id] = slab + TX_SLAB_SIZE;
+    }
+    ptr = cache->bump[class_id];
+    cache->bump[class_id] += class_size;
+    return ptr;
+}
+
+void tx_slab_free(void* ptr)
+{
+    if(ptr == NULL) { return; }
+
+    tx_slab_t* slab = __tx_slab_of(ptr);
+    if(slab->class_id == TX_SLAB_LARGE){
+        if(slab->is_mmaped) { munmap(slab, slab->size); }
+        else { free(slab); }
+        return;
+    }
+
+    tx_slab_cache_t* cache = &tx_slab_cache;
+    *(void **) ptr = cache->free_list[slab->class_id];
+    cache->free_list[slab->class_id] = ptr;
+    TX_SLAB_POISON(ptr, __tx_slab_class_size(slab->class_id));
+}
@@ -0,0 +1,55 @@
+//
+// Per-thread size-class slab allocator for objs (header + value), kvs items and benchmark rows
+//
+
+/// Memory is carved out of TX_SLAB_SIZE-aligned slabs, each dedicated to a single size class:
+/// -- size classes are multiples of 64B up to 1KiB (i.e., row-sized) and of 512B up to INT_OBJ_LEN(MAX_VAL_LEN)
+///    so every allocation (and thus every tx_header_t) is 64B aligned
+/// -- every thread allocates from its own slabs and free lists (no locks / atomics)
+/// -- frees go to the free list of the calling thread (e.g., the thread that reclaims a retired obj)
+/// -- larger allocations get a dedicated (multi-)slab which is released on free
+/// Slabs are never returned to the OS. Build w/ -DTX_SLAB_HUGETLB to back them by (reserved) 2MB hugepages,
+/// otherwise transparent hugepages are requested via madvise.
+
+#ifndef TX_SHIM_SLAB_H
+#define TX_SHIM_SLAB_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TX_SLAB_SIZE (2 * 1024 * 1024) // (a hugepage)
+#define TX_SLAB_HDR_SIZE 64
+#define TX_SLAB_NUM_CLASSES 23         // 16 x 64B (<= 1KiB) + 7 x 512B (<= 4.5KiB)
+#define TX_SLAB_LARGE TX_SLAB_NUM_CLASSES
+
+// first TX_SLAB_HDR_SIZE bytes of every slab (slots follow)
+typedef struct
+{
+    uint32_t class_id; // TX_SLAB_LARGE for dedicated slabs
+    uint8_t  is_mmaped;
+    uint64_t size;     // of the slab (incl. header)
+} tx_slab_t;
+
+static inline uint32_t __tx_slab_class(uint32_t len)
+{
+    if(len <= 64)   { return 0; }
+    if(len <= 1024) { return (len + 63) / 64 - 1; }
+    return 15 + (len - 1024 + 511) / 512;
+}
+
+static inline uint32_t __tx_slab_class_size(uint32_t class_id)
+{
+    return class_id < 16 ? (class_id + 1) * 64 : 1024 + (class_id - 15) * 512;
+}
+
+void* tx_slab_alloc(uint32_t len); // 64B aligned
+void  tx_slab_free (void* ptr);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //TX_SHIM_SLAB_H
@@ -0,0 +1,190 @@
+//
+// Merge / dump of the tx shim stats (see tx_shim_stats.h)
+//
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <time.h>
+#include "tx_shim_stats.h"
+
+static const char* tx_stat_op_names[TX_STAT_NUM_OPS] = {
+    [TX_STAT_TX]              = "tx",
+    [TX_STAT_COMMIT]          = "commit",
+    [TX_STAT_ABORT]           = "abort",
+    [TX_STAT_OBJ_ALLOC]       = "obj_alloc",
+    [TX_STAT_OBJ_FREE]        = "obj_free",
+    [TX_STAT_OBJ_READ]        = "obj_read",
+    [TX_STAT_OBJ_WRITE]       = "obj_write",
+    [TX_STAT_OBJ_ADD]         = "obj_add",
+    [TX_STAT_KV_GET]          = "kv_get",
+    [TX_STAT_KV_SET]          = "kv_set",
+    [TX_STAT_KV_DEL]          = "kv_del",
+    [TX_STAT_KV_GET_RANGE]    = "kv_get_range",
+    [TX_STAT_KV_UPDATE_RANGE] = "kv_update_range",
+    [TX_STAT_KV_ADD]          = "kv_add",
+    [TX_STAT_KV_SCAN]         = "kv_scan",
+    [TX_STAT_KV_MULTI_GET]    = "kv_multi_get"
+};
+
+static const char* tx_abort_cause_names[TX_ABORT_NUM_CAUSES] = {
+    [TX_ABORT_LOCK]       = "lock",
+    [TX_ABORT_VALIDATION] = "validation",
+    [TX_ABORT_PHANTOM]    = "phantom",
+    [TX_ABORT_USER]       = "user"
+};
+
+tx_stats_t* tx_stats_create(void)
+{
+    return calloc(1, sizeof(tx_stats_t));
+}
+
+void tx_stats_free(tx_stats_t* stats)
+{
+    free(stats);
+}
+
+void tx_hot_keys_add(tx_hot_keys_t* hot_keys, void* obj_ptr, const uint8_t* key_ptr, uint32_t key_len,
+                     uint64_t count, uint64_t error)
+{
+    assert(key_len <= MAX_KEY_LEN);
+    tx_hot_key_t* min = NULL;
+    for(uint32_t i = 0; i < hot_keys->num; ++i){ // (only on failed commits)
+        tx_hot_key_t* hk = &hot_keys->keys[i];
+        if(hk->obj_ptr == obj_ptr && hk->key_len == key_len && memcmp(hk->key, key_ptr, key_len) == 0){
+            hk->count += count;
+            hk->error += error;
+            return;
+        }
+        if(min == NULL || hk->count < min->count) { min = hk; }
+    }
+
+    tx_hot_key_t* hk;
+    if(hot_keys->num < TX_HOT_KEYS){
+        hk = &hot_keys->keys[hot_keys->num++];
+        hk->count = count;
+        hk->error = error;
+    }else{ // the new key may have had up to the evicted count
+        hk = min;
+        hk->error = hk->count + error;
+        hk->count += count;
+    }
+    hk->obj_ptr = obj_ptr;
+    hk->key_len = (uint16_t) key_len;
+    memcpy(hk->key, key_ptr, key_len);
+}
+
+void tx_hist_merge(tx_hist_t* dst, const tx_hist_t* src)
+{
+    if(src->count == 0) { return; }
+    for(int i = 0; i < TX_HIST_BUCKETS; ++i) { dst->buckets[i] += src->buckets[i]; }
+    dst->count += src->count;
+    dst->sum += src->sum;
+    if(src->max > dst->max) { dst->max = src->max; }
+}
+
+void tx_stats_merge(tx_stats_t* dst, const tx_stats_t* src)
+{
+    if(src == NULL) { return; }
+
+    for(int op = 0; op < TX_STAT_NUM_OPS; ++op){
+        tx_hist_merge(&dst->ops[op], &src->ops[op]);
+    }
+    for(int cause = 0; cause < TX_ABORT_NUM_CAUSES; ++cause){
+        dst->aborts[cause] += src->aborts[cause];
+    }
+    for(uint32_t i = 0; i < src->hot_keys.num; ++i){
+        const tx_hot_key_t* hk = &src->hot_keys.keys[i];
+        tx_hot_keys_add(&dst->hot_keys, hk->obj_ptr, hk->key, hk->key_len, hk->count, hk->error);
+    }
+    dst->obj_cap_grows += src->obj_cap_grows;
+    dst->trans_exhausted += src->trans_exhausted;
+}
+
+// the midpoint of the bucket of the pct-th percentile value (capped by the max)
+uint64_t tx_hist_percentile(const tx_hist_t* hist, double pct)
+{
+    if(hist->count == 0) { return 0; }
+
+    uint64_t rank = (uint64_t) (pct / 100 * hist->count + 0.5);
+    if(rank < 1) { rank = 1; }
+    uint64_t seen = 0;
+    for(uint32_t i = 0; i < TX_HIST_BUCKETS; ++i){
+        seen += hist->buckets[i];
+        if(seen < rank) { continue; }
+        uint64_t lo = __tx_hist_bucket_val(i);
+        uint64_t mid = lo + (__tx_hist_bucket_val(i + 1) - lo) / 2;
+        return mid < hist->max ? mid : hist->max;
+    }
+    return hist->max;
+}
+
+static inline double __tx_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+double tx_stats_cycles_per_ns(void)
+{
+    static double cycles_per_ns = 0;
+    if(cycles_per_ns > 0) { return cycles_per_ns; }
+
+    // spin for ~10ms (long enough to make the cost of the clock reads negligible)
+    double start_ns = __tx_now_ns(), end_ns;
+    uint64_t start = __tx_rdtsc();
+    while((end_ns = __tx_now_ns()) - start_ns < 10e6) { }
+    cycles_per_ns = (__tx_rdtsc() - start) / (end_ns - start_ns);
+    return cycles_per_ns;
+}
+
+static int __tx_hot_key_cmp(const void* a, const void* b)
+{
+    uint64_t ca = ((const tx_hot_key_t *) a)->count, cb = ((const tx_hot_key_t *) b)->count;
+    return ca < cb ? 1 : ca > cb ? -1 : 0;
+}
+
+static void __tx_hot_key_str(const tx_hot_key_t* hk, tx_stats_key_fmt key_fmt, char* out, uint32_t out_len)
+{
+    if(hk->key_len == 0){
+        snprintf(out, out_len, "obj:%p", hk->obj_ptr);
+    }else if(key_fmt != NULL){
+        key_fmt(hk->key, hk->key_len, out, out_len);
+    }else{
+        for(uint32_t i = 0; i < hk->key_len && 2 * i + 2 < out_len; ++i) { sprintf(out + 2 * i, "%02x", hk->key[i]); }
+    }
+}
+
+void tx_stats_dump_json(FILE* out, const tx_stats_t* stats, tx_stats_key_fmt key_fmt)
+{
+    double cpn = tx_stats_cycles_per_ns();
+
+    fprintf(out, "{\n  \"cycles_per_ns\": %.3f,\n  \"ops\": {\n", cpn);
+    for(int op = 0; op < TX_STAT_NUM_OPS; ++op){
+        const tx_hist_t* h = &stats->ops[op];
+        fprintf(out, "    \"%s\": {\"count\": %lu, \"mean_ns\": %.1f, \"p50_ns\": %.1f, \"p99_ns\": %.1f,"
+                     " \"p999_ns\": %.1f, \"max_ns\": %.1f}%s\n", tx_stat_op_names[op], (unsigned long) h->count,
+                h->count == 0 ? 0 : (double) h->sum / h->count / cpn, tx_hist_percentile(h, 50) / cpn,
+                tx_hist_percentile(h, 99) / cpn, tx_hist_percentile(h, 99.9) / cpn, h->max / cpn,
+                op < TX_STAT_NUM_OPS - 1 ? "," : "");
+    }
+    fprintf(out, "  },\n  \"aborts\": {");
+    for(int cause = 0; cause < TX_ABORT_NUM_CAUSES; ++cause){
+        fprintf(out, "%s\"%s\": %lu", cause > 0 ? ", " : "", tx_abort_cause_names[cause],
+                (unsigned long) stats->aborts[cause]);
+    }
+    tx_hot_key_t hot[TX_HOT_KEYS];
+    uint32_t num_hot = stats->hot_keys.num;
+    memcpy(hot, stats->hot_keys.keys, num_hot * sizeof(tx_hot_key_t));
+    qsort(hot, num_hot, sizeof(tx_hot_key_t), __tx_hot_key_cmp);
+    fprintf(out, "},\n  \"hot_keys\": [");
+    for(uint32_t i = 0; i < num_hot; ++i){
+        char key_str[4 * MAX_KEY_LEN] = "";
+        __tx_hot_key_str(&hot[i], key_fmt, key_str, sizeof(key_str));
+        fprintf(out, "%s\n    {\"key\": \"%s\", \"count\": %lu, \"error\": %lu}", i > 0 ? "," : "", key_str,
+                (unsigned long) hot[i].count, (unsigned long) hot[i].error);
+    }
+    fprintf(out, "%s],\n  \"obj_cap_grows\": %lu,\n  \"trans_exhausted\": %lu\n}\n", num_hot > 0 ? "\n  " : "",
+            (unsigned long) stats->obj_cap_grows, (unsigned long) stats->trans_exhausted);
+}
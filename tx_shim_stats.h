@@ -0,0 +1,212 @@
+//
+// Built-in instrumentation of the tx shim: per-ctx latency histograms of txs / ops and abort counters
+//
+
+/// Build w/ -DTX_STATS to enable it, otherwise the TX_STATS_* hooks compile to nothing (and tx_ctx_t::stats is NULL)
+/// -- latencies are TSC cycles (rdtsc, i.e., w/o serialization) recorded in log-linear (HDR-style) histograms:
+///    2^TX_HIST_SUB_BITS linear sub-buckets per power of two --> constant-time records w/ <= 1/16 relative error
+/// -- every ctx records to its own tx_stats_t (no atomics / sharing); merge those of the ctxs of a run
+///    (before they are destroyed) and dump the merged stats, which converts cycles to ns
+/// -- commit / abort are the latencies of successful / failed tx_trans_commit calls and tx the time
+///    from tx_trans_create to a successful commit
+/// -- the objs / keys on which commits fail are counted in a top-K (Space-Saving) sketch of TX_HOT_KEYS entries
+///    (the range start key for phantoms): a key w/ more than 1/TX_HOT_KEYS of the conflicts is always in it and
+///    its count is overestimated by at most its error
+
+#ifndef TX_SHIM_STATS_H
+#define TX_SHIM_STATS_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+#include "tx_shim.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TX_HIST_SUB_BITS 4
+#define TX_HIST_SUB_BUCKETS (1 << TX_HIST_SUB_BITS)
+#define TX_HIST_BUCKETS ((64 - TX_HIST_SUB_BITS + 1) * TX_HIST_SUB_BUCKETS)
+#define TX_HOT_KEYS 32
+
+typedef enum
+{
+    TX_STAT_TX,
+    TX_STAT_COMMIT,
+    TX_STAT_ABORT,
+    TX_STAT_OBJ_ALLOC,
+    TX_STAT_OBJ_FREE,
+    TX_STAT_OBJ_READ,
+    TX_STAT_OBJ_WRITE,
+    TX_STAT_OBJ_ADD,
+    TX_STAT_KV_GET,
+    TX_STAT_KV_SET,
+    TX_STAT_KV_DEL,
+    TX_STAT_KV_GET_RANGE,
+    TX_STAT_KV_UPDATE_RANGE,
+    TX_STAT_KV_ADD,
+    TX_STAT_KV_SCAN,
+    TX_STAT_KV_MULTI_GET,
+    TX_STAT_NUM_OPS
+} tx_stat_op_t;
+
+// why a tx failed
+typedef enum
+{
+    TX_ABORT_LOCK,       // an obj to write was locked by another tx (or a new key was inserted by one)
+    TX_ABORT_VALIDATION, // an obj accessed by the tx changed (or was removed / inserted) before its commit
+    TX_ABORT_PHANTOM,    // a range scanned by the tx has different items
+    TX_ABORT_USER,       // tx_trans_abort_n_clear / tx_trans_destroy of an active tx
+    TX_ABORT_NUM_CAUSES
+} tx_abort_cause_t;
+
+typedef struct
+{
+    uint64_t count;
+    uint64_t sum;
+    uint64_t max;
+    uint64_t buckets[TX_HIST_BUCKETS];
+} tx_hist_t;
+
+typedef struct
+{
+    uint64_t count;
+    uint64_t error;                 // max overestimation of count
+    void*    obj_ptr;               // mem objs (key_len 0)
+    uint16_t key_len;
+    uint8_t  key[MAX_KEY_LEN];
+} tx_hot_key_t;
+
+typedef struct
+{
+    uint32_t     num;
+    tx_hot_key_t keys[TX_HOT_KEYS];
+} tx_hot_keys_t;
+
+typedef struct _tx_stats_t
+{
+    tx_hist_t ops[TX_STAT_NUM_OPS];
+    uint64_t  aborts[TX_ABORT_NUM_CAUSES];
+    tx_hot_keys_t hot_keys;    // of the aborts other than TX_ABORT_USER
+    uint64_t  obj_cap_grows;   // obj_ids of a tx reached their capacity (and were doubled)
+    uint64_t  trans_exhausted; // tx_trans_create w/o a free trans (i.e., MAX_CONCUR_TX active txs)
+} tx_stats_t;
+
+
+tx_stats_t* tx_stats_create(void); // zeroed
+void        tx_stats_free  (tx_stats_t* stats);
+void        tx_stats_merge (tx_stats_t* dst, const tx_stats_t* src); // (src NULL --> no-op)
+
+// adds count (w/ error) to the entry of the obj / key (evicting the one w/ the min count if the sketch is full)
+void        tx_hot_keys_add(tx_hot_keys_t* hot_keys, void* obj_ptr, const uint8_t* key_ptr, uint32_t key_len,
+                            uint64_t count, uint64_t error);
+
+void        tx_hist_merge     (tx_hist_t* dst, const tx_hist_t* src);
+uint64_t    tx_hist_percentile(const tx_hist_t* hist, double pct); // in cycles (0 if empty)
+double      tx_stats_cycles_per_ns(void);                          // (calibrated once)
+
+// writes a readable name of a key (e.g., its table and ids) to out (as snprintf)
+typedef int (*tx_stats_key_fmt)(const uint8_t* key_ptr, uint32_t key_len, char* out, uint32_t out_len);
+
+// {"cycles_per_ns": .., "ops": {"commit": {"count": .., "mean_ns": .., "p50_ns": .., "p99_ns": .., "p999_ns": ..,
+//  "max_ns": ..}, ...}, "aborts": {"lock": .., ...}, "hot_keys": [{"key": .., "count": .., "error": ..}, ...],
+//  "obj_cap_grows": .., "trans_exhausted": ..}
+// hot keys are in descending count order and named by key_fmt (NULL --> hex bytes) or "obj:<ptr>"
+void        tx_stats_dump_json(FILE* out, const tx_stats_t* stats, tx_stats_key_fmt key_fmt);
+
+
+static inline uint32_t __tx_hist_bucket(uint64_t val)
+{
+    if(val < TX_HIST_SUB_BUCKETS) { return (uint32_t) val; }
+    uint32_t shift = 63 - __builtin_clzll(val) - TX_HIST_SUB_BITS;
+    return (shift + 1) * TX_HIST_SUB_BUCKETS + (uint32_t) ((val >> shift) & (TX_HIST_SUB_BUCKETS - 1));
+}
+
+// smallest value of a bucket
+static inline uint64_t __tx_hist_bucket_val(uint32_t bucket)
+{
+    if(bucket < TX_HIST_SUB_BUCKETS) { return bucket; }
+    uint32_t shift = bucket / TX_HIST_SUB_BUCKETS - 1;
+    return (uint64_t) (TX_HIST_SUB_BUCKETS + bucket % TX_HIST_SUB_BUCKETS) << shift;
+}
+
+static inline void __tx_hist_record(tx_hist_t* hist, uint64_t val)
+{
+    hist->buckets[__tx_hist_bucket(val)]++;
+    hist->count++;
+    hist->sum += val;
+    if(val > hist->max) { hist->max = val; }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+static inline uint64_t __tx_rdtsc(void)
+{
+    return __builtin_ia32_rdtsc();
+}
+#elif defined(__aarch64__)
+static inline uint64_t __tx_rdtsc(void)
+{
+    uint64_t ticks;
+    __asm__ __volatile__("mrs %0, cntvct_el0" : "=r"(ticks));
+    return ticks;
+}
+#else // (ns)
+static inline uint64_t __tx_rdtsc(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+#endif
+
+
+/// Hooks (compile to nothing w/o -DTX_STATS)
+#ifdef TX_STATS
+
+typedef struct
+{
+    tx_stats_t*  stats;
+    tx_stat_op_t op;
+    uint64_t     start;
+} __tx_stats_timer_t;
+
+static inline void __tx_stats_timer_end(__tx_stats_timer_t* timer)
+{
+    __tx_hist_record(&timer->stats->ops[timer->op], __tx_rdtsc() - timer->start);
+}
+
+// times the rest of the enclosing block (i.e., until any return of an op)
+#define TX_STATS_TIME_OP(tx_ctx, op) \
+    __tx_stats_timer_t __tx_stats_timer __attribute__((cleanup(__tx_stats_timer_end))) = \
+        { (tx_ctx)->stats, op, __tx_rdtsc() }
+#define TX_STATS_TSC(var) uint64_t var = __tx_rdtsc()
+#define TX_STATS_RECORD(tx_ctx, op, start_tsc) \
+    __tx_hist_record(&(tx_ctx)->stats->ops[op], __tx_rdtsc() - (start_tsc))
+#define TX_STATS_ABORT(tx_ctx, cause) ((tx_ctx)->stats->aborts[cause]++)
+// a commit failed on an obj / key
+#define TX_STATS_CONFLICT(tx_ctx, cause, obj_ptr, key_ptr, key_len) do { \
+        (tx_ctx)->stats->aborts[cause]++; \
+        tx_hot_keys_add(&(tx_ctx)->stats->hot_keys, obj_ptr, key_ptr, key_len, 1, 0); } while(0)
+#define TX_STATS_CONFLICT_OBJ(tx_ctx, cause, obj_id) \
+    TX_STATS_CONFLICT(tx_ctx, cause, (obj_id)->is_mem ? (obj_id)->obj_ptr : NULL, (obj_id)->kv.key, \
+                      (obj_id)->is_mem ? 0 : (obj_id)->kv.key_len)
+#define TX_STATS_INC(tx_ctx, counter) ((tx_ctx)->stats->counter++)
+
+#else
+
+#define TX_STATS_TIME_OP(tx_ctx, op) do { } while(0)
+#define TX_STATS_TSC(var) do { } while(0)
+#define TX_STATS_RECORD(tx_ctx, op, start_tsc) do { } while(0)
+#define TX_STATS_ABORT(tx_ctx, cause) do { } while(0)
+#define TX_STATS_CONFLICT(tx_ctx, cause, obj_ptr, key_ptr, key_len) do { } while(0)
+#define TX_STATS_CONFLICT_OBJ(tx_ctx, cause, obj_id) do { } while(0)
+#define TX_STATS_INC(tx_ctx, counter) do { } while(0)
+
+#endif //TX_STATS
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //TX_SHIM_STATS_H
@@ -0,0 +1,175 @@
+//
+// Invariant check of the commutative adds: concurrent adds (and read-modify-writes) of the counters of a mem obj
+//  and of a kv item are never lost and the counters of both are always updated together
+//  (and an add to a mem obj freed by another tx fails instead of waiting for it forever)
+//
+// usage: ./test_add [threads] [secs] [backend: ht | skiplist]
+// e.g. gcc -O2 -pthread tx_shim_test_add.c tx_shim.c tx_shim_single.c tx_shim_trans.c tx_shim_slab.c
+//          tx_shim_kvs.c tx_shim_kvs_skiplist.c -o test_add
+//  (exits w/ 1 and prints FAILED on the first violation)
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <pthread.h>
+#include <time.h>
+#include "tx_shim.h"
+
+// every tx increments all the counters (of the obj and of the item) by one
+typedef struct
+{
+    int64_t i64;
+    int32_t i32;
+    int32_t pad;
+    double  f64;
+} counters_t;
+
+static const uint64_t item_key = 42;
+
+typedef struct
+{
+    const tx_kvs_ops_t* kvs_ops;
+    void* kvs;
+    counters_t* obj;
+    int thread_id;
+    volatile uint8_t* stop;
+    uint64_t increments; // (of committed txs)
+    uint64_t failed;
+} test_thread_t;
+
+static inline uint64_t xorshift64(uint64_t* state)
+{
+    uint64_t x = *state;
+    x ^= x << 13; x ^= x >> 7; x ^= x << 17;
+    return *state = x;
+}
+
+static inline void check_counters(const counters_t* c, const counters_t* other, const char* what)
+{
+    if(c->i32 != c->i64 || c->f64 != (double) c->i64 || other->i64 != c->i64){
+        printf("FAILED: %s counters at %ld / %d / %.0f and the other ones at %ld\n",
+               what, c->i64, c->i32, c->f64, other->i64);
+        exit(1);
+    }
+}
+
+static void* run_adds(void* arg)
+{
+    test_thread_t* t = (test_thread_t *) arg;
+    tx_ctx_t* ctx = malloc(sizeof(tx_ctx_t));
+    tx_ctx_init(ctx, t->kvs_ops, t->kvs);
+    uint64_t rand_state = 0x9E3779B97F4A7C15ULL * (t->thread_id + 1);
+    int64_t one_i64 = 1;
+    int32_t one_i32 = 1;
+    double one_f64 = 1;
+
+    while(!*t->stop){
+        uint64_t r = xorshift64(&rand_state) % 4;
+        tx_trans_t* trans = tx_trans_create(ctx);
+        counters_t *obj_val = NULL, *item_val = NULL;
+        if(r < 2){ // adds
+            tx_trans_obj_add(trans, t->obj, offsetof(counters_t, i64), TX_ADD_I64, &one_i64);
+            tx_trans_obj_add(trans, t->obj, offsetof(counters_t, i32), TX_ADD_I32, &one_i32);
+            tx_trans_obj_add(trans, t->obj, offsetof(counters_t, f64), TX_ADD_F64, &one_f64);
+            tx_trans_kv_add(trans, (void*) &item_key, sizeof(item_key), offsetof(counters_t, i64), TX_ADD_I64, &one_i64);
+            tx_trans_kv_add(trans, (void*) &item_key, sizeof(item_key), offsetof(counters_t, i32), TX_ADD_I32, &one_i32);
+            tx_trans_kv_add(trans, (void*) &item_key, sizeof(item_key), offsetof(counters_t, f64), TX_ADD_F64, &one_f64);
+        }else if(r == 2){ // read-modify-writes (of the same counters)
+            counters_t c;
+            c = *(counters_t *) tx_trans_obj_read(trans, t->obj);
+            c.i64++; c.i32++; c.f64++;
+            tx_trans_obj_write(trans, t->obj, (uint8_t *) &c, sizeof(c), 0);
+            tx_trans_kv_get(trans, (void*) &item_key, sizeof(item_key), (void**) &item_val);
+            c = *item_val;
+            c.i64++; c.i32++; c.f64++;
+            tx_trans_kv_set(trans, (void*) &item_key, sizeof(item_key), &c, sizeof(c));
+        }else{ // audit
+            obj_val = (counters_t *) tx_trans_obj_read(trans, t->obj);
+            tx_trans_kv_get(trans, (void*) &item_key, sizeof(item_key), (void**) &item_val);
+        }
+        if(tx_trans_commit(trans) == committed){ // (only committed reads must be consistent)
+            if(r < 3){
+                t->increments++;
+            }else{
+                check_counters(obj_val, item_val, "a committed audit read");
+                check_counters(item_val, obj_val, "a committed audit read");
+            }
+        }else{
+            t->failed++;
+        }
+        tx_trans_destroy(trans);
+    }
+
+    tx_ctx_destroy(ctx);
+    free(ctx);
+    return NULL;
+}
+
+int main(int argc, char* argv[])
+{
+    int num_threads = argc > 1 ? atoi(argv[1]) : 4;
+    double secs     = argc > 2 ? atof(argv[2]) : 2;
+    const tx_kvs_ops_t* kvs_ops = tx_kvs_ops_by_name(argc > 3 ? argv[3] : "ht");
+    assert(num_threads > 0 && num_threads < TX_MAX_THREADS);
+    assert(kvs_ops != NULL);
+
+    void* kvs = kvs_ops->create(16);
+    tx_ctx_t* ctx = malloc(sizeof(tx_ctx_t));
+    tx_ctx_init(ctx, kvs_ops, kvs);
+    counters_t zero = { 0 };
+    tx_single_kv_set(ctx, (void*) &item_key, sizeof(item_key), &zero, sizeof(zero));
+    tx_trans_t* trans = tx_trans_create(ctx);
+    counters_t* obj = (counters_t *) tx_trans_obj_alloc(trans, sizeof(counters_t));
+    tx_trans_obj_write(trans, obj, (uint8_t *) &zero, sizeof(zero), 1);
+    if(tx_trans_commit(trans) != committed) { printf("FAILED: the alloc of the obj failed\n"); return 1; }
+    tx_trans_destroy(trans);
+
+    volatile uint8_t stop = 0;
+    pthread_t threads[num_threads];
+    test_thread_t args[num_threads];
+    for(int i = 0; i < num_threads; ++i){
+        args[i] = (test_thread_t) { kvs_ops, kvs, obj, i, &stop, 0, 0 };
+        pthread_create(&threads[i], NULL, run_adds, &args[i]);
+    }
+    struct timespec duration = { (time_t) secs, (long) ((secs - (time_t) secs) * 1e9) };
+    nanosleep(&duration, NULL);
+    stop = 1;
+
+    uint64_t increments = 0, num_failed = 0;
+    for(int i = 0; i < num_threads; ++i){
+        pthread_join(threads[i], NULL);
+        increments += args[i].increments;
+        num_failed += args[i].failed;
+    }
+
+    counters_t obj_val, item_val;
+    uint32_t val_len = sizeof(item_val);
+    tx_single_obj_read(ctx, obj, &obj_val, sizeof(obj_val));
+    tx_single_kv_get(ctx, (void*) &item_key, sizeof(item_key), &item_val, &val_len);
+    check_counters(&obj_val, &item_val, "the end w/");
+    check_counters(&item_val, &obj_val, "the end w/");
+    if(obj_val.i64 != (int64_t) increments){
+        printf("FAILED: the counters are at %ld after %lu committed increments\n", obj_val.i64, increments);
+        return 1;
+    }
+
+    // an add pending on the obj while another tx frees it
+    tx_trans_t* add_trans = tx_trans_create(ctx);
+    int64_t one = 1;
+    tx_trans_obj_add(add_trans, obj, offsetof(counters_t, i64), TX_ADD_I64, &one);
+    trans = tx_trans_create(ctx);
+    tx_trans_obj_free(trans, obj);
+    if(tx_trans_commit(trans) != committed) { printf("FAILED: the free of the obj failed\n"); return 1; }
+    tx_trans_destroy(trans);
+    if(tx_trans_commit(add_trans) != failed) { printf("FAILED: an add to a freed obj committed\n"); return 1; }
+    tx_trans_destroy(add_trans);
+
+    printf("OK: %lu committed increments, %lu failed txs (%d threads, %s)\n",
+           increments, num_failed, num_threads, kvs_ops->name);
+
+    tx_ctx_destroy(ctx);
+    free(ctx);
+    kvs_ops->destroy(kvs);
+    return 0;
+}
@@ -0,0 +1,146 @@
+//
+// Invariant check of the OCC commit: concurrent transfers between accounts never change the sum of the balances
+//  (i.e., every committed tx, incl. the audits that read all the accounts, sees a serializable state)
+//
+// usage: ./test_bank [accounts] [threads] [secs] [backend: ht | skiplist]
+// e.g. gcc -O2 -pthread tx_shim_test_bank.c tx_shim.c tx_shim_single.c tx_shim_trans.c tx_shim_slab.c
+//          tx_shim_kvs.c tx_shim_kvs_skiplist.c -o test_bank
+//  (exits w/ 1 and prints FAILED on the first violation)
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <time.h>
+#include "tx_shim.h"
+
+#define INITIAL_BALANCE 1000
+
+typedef struct
+{
+    const tx_kvs_ops_t* kvs_ops;
+    void* kvs;
+    int thread_id;
+    uint64_t num_accounts;
+    volatile uint8_t* stop;
+    uint64_t committed;
+    uint64_t failed;
+} test_thread_t;
+
+static inline uint64_t xorshift64(uint64_t* state)
+{
+    uint64_t x = *state;
+    x ^= x << 13; x ^= x >> 7; x ^= x << 17;
+    return *state = x;
+}
+
+// the sum of all the balances as read by a tx (must be committed to be trusted)
+static int64_t audit(tx_trans_t* trans, uint64_t num_accounts)
+{
+    int64_t sum = 0;
+    for(uint64_t id = 0; id < num_accounts; ++id){
+        int64_t* balance;
+        if(tx_trans_kv_get(trans, &id, sizeof(id), (void**) &balance) != sizeof(int64_t)){
+            printf("FAILED: account %lu is missing\n", id);
+            exit(1);
+        }
+        sum += *balance;
+    }
+    return sum;
+}
+
+static void* run_transfers(void* arg)
+{
+    test_thread_t* t = (test_thread_t *) arg;
+    tx_ctx_t* ctx = malloc(sizeof(tx_ctx_t));
+    tx_ctx_init(ctx, t->kvs_ops, t->kvs);
+    uint64_t rand_state = 0x9E3779B97F4A7C15ULL * (t->thread_id + 1);
+    int64_t total = (int64_t) t->num_accounts * INITIAL_BALANCE;
+
+    while(!*t->stop){
+        uint64_t r = xorshift64(&rand_state);
+        if(r % 16 == 0){ // audit (every other one w/ zero-copy reads)
+            tx_trans_t* trans = r % 32 == 0 ? tx_rd_only_trans_create(ctx) : tx_trans_create(ctx);
+            int64_t sum = audit(trans, t->num_accounts);
+            if(tx_trans_commit(trans) == committed){
+                if(sum != total){
+                    printf("FAILED: a committed audit summed up to %ld instead of %ld\n", sum, total);
+                    exit(1);
+                }
+                t->committed++;
+            }else{
+                t->failed++;
+            }
+            tx_trans_destroy(trans);
+            continue;
+        }
+
+        uint64_t from = (r >> 8) % t->num_accounts, to = (r >> 32) % t->num_accounts;
+        int64_t amount = (int64_t) (r >> 56) % 100;
+        tx_trans_t* trans = tx_trans_create(ctx);
+        int64_t *from_balance, *to_balance;
+        tx_trans_kv_get(trans, &from, sizeof(from), (void**) &from_balance);
+        int64_t new_from = *from_balance - amount;
+        tx_trans_kv_set(trans, &from, sizeof(from), &new_from, sizeof(new_from));
+        tx_trans_kv_get(trans, &to, sizeof(to), (void**) &to_balance); // (the tx's own write if to == from)
+        int64_t new_to = *to_balance + amount;
+        tx_trans_kv_set(trans, &to, sizeof(to), &new_to, sizeof(new_to));
+        if(tx_trans_commit(trans) == committed) { t->committed++; } else { t->failed++; }
+        tx_trans_destroy(trans);
+    }
+
+    tx_ctx_destroy(ctx);
+    free(ctx);
+    return NULL;
+}
+
+int main(int argc, char* argv[])
+{
+    uint64_t num_accounts = argc > 1 ? strtoull(argv[1], NULL, 10) : 16;
+    int num_threads       = argc > 2 ? atoi(argv[2]) : 4;
+    double secs           = argc > 3 ? atof(argv[3]) : 2;
+    const tx_kvs_ops_t* kvs_ops = tx_kvs_ops_by_name(argc > 4 ? argv[4] : "ht");
+    assert(num_accounts > 0 && num_threads > 0 && num_threads < TX_MAX_THREADS);
+    assert(kvs_ops != NULL);
+
+    void* kvs = kvs_ops->create(num_accounts);
+    tx_ctx_t* ctx = malloc(sizeof(tx_ctx_t));
+    tx_ctx_init(ctx, kvs_ops, kvs);
+    for(uint64_t id = 0; id < num_accounts; ++id){
+        int64_t balance = INITIAL_BALANCE;
+        tx_single_kv_set(ctx, &id, sizeof(id), &balance, sizeof(balance));
+    }
+
+    volatile uint8_t stop = 0;
+    pthread_t threads[num_threads];
+    test_thread_t args[num_threads];
+    for(int i = 0; i < num_threads; ++i){
+        args[i] = (test_thread_t) { kvs_ops, kvs, i, num_accounts, &stop, 0, 0 };
+        pthread_create(&threads[i], NULL, run_transfers, &args[i]);
+    }
+    struct timespec duration = { (time_t) secs, (long) ((secs - (time_t) secs) * 1e9) };
+    nanosleep(&duration, NULL);
+    stop = 1;
+
+    uint64_t num_committed = 0, num_failed = 0;
+    for(int i = 0; i < num_threads; ++i){
+        pthread_join(threads[i], NULL);
+        num_committed += args[i].committed;
+        num_failed += args[i].failed;
+    }
+
+    tx_trans_t* trans = tx_trans_create(ctx);
+    int64_t sum = audit(trans, num_accounts), total = (int64_t) num_accounts * INITIAL_BALANCE;
+    if(tx_trans_commit(trans) != committed || sum != total){
+        printf("FAILED: the final balances sum up to %ld instead of %ld\n", sum, total);
+        return 1;
+    }
+    tx_trans_destroy(trans);
+    printf("OK: %lu committed, %lu failed txs over %lu accounts (%d threads, %s)\n",
+           num_committed, num_failed, num_accounts, num_threads, kvs_ops->name);
+
+    tx_ctx_destroy(ctx);
+    free(ctx);
+    kvs_ops->destroy(kvs);
+    return 0;
+}
@@ -0,0 +1,178 @@
+//
+// Check of the epoch-based reclamation: kv items and mem objs are removed / replaced while other threads read them,
+//  so a reader that copies a value from a reclaimed (i.e., reused) obj sees a value that is not its own, and
+//  most of the removed objs must have left the limbo lists by the end of the run (i.e., they are reclaimed)
+//
+// usage: ./test_ebr [threads] [secs] [backend: ht | skiplist]
+// e.g. gcc -O2 -pthread tx_shim_test_ebr.c tx_shim.c tx_shim_single.c tx_shim_trans.c tx_shim_slab.c
+//          tx_shim_kvs.c tx_shim_kvs_skiplist.c -o test_ebr
+//  (w/ -fsanitize=address, freed slab slots are poisoned, so an access to a reclaimed obj is reported as well)
+//  (exits w/ 1 and prints FAILED on the first violation)
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <time.h>
+#include "tx_shim.h"
+
+#define NUM_KEYS  64
+#define VAL_WORDS 16            // every word of a value is its stamp (unique per write)
+#define PTR_KEY   NUM_KEYS      // its value is { ptr to the current mem obj, its stamp }
+
+typedef struct
+{
+    uint64_t words[VAL_WORDS];
+} stamped_t;
+
+typedef struct
+{
+    stamped_t* obj;
+    uint64_t stamp;
+} obj_ref_t;
+
+typedef struct
+{
+    const tx_kvs_ops_t* kvs_ops;
+    void* kvs;
+    int thread_id;
+    volatile uint8_t* stop;
+    uint64_t removed; // kv items and mem objs removed by the committed txs of the thread (w/o the ones replaced)
+    uint64_t in_limbo; // retired objs not yet reclaimed at the end
+} test_thread_t;
+
+static inline uint64_t xorshift64(uint64_t* state)
+{
+    uint64_t x = *state;
+    x ^= x << 13; x ^= x >> 7; x ^= x << 17;
+    return *state = x;
+}
+
+static inline void stamp(stamped_t* val, uint64_t s)
+{
+    for(int i = 0; i < VAL_WORDS; ++i) { val->words[i] = s; }
+}
+
+// (checked right after the copy, i.e., even if the tx fails later: the copy is consistent unless the obj was reused)
+static inline void check_stamp(const stamped_t* val, const char* what)
+{
+    for(int i = 1; i < VAL_WORDS; ++i){
+        if(val->words[i] != val->words[0]){
+            printf("FAILED: a %s copied words %lx and %lx of different writes\n", what, val->words[0], val->words[i]);
+            exit(1);
+        }
+    }
+}
+
+static void* run_removes_n_reads(void* arg)
+{
+    test_thread_t* t = (test_thread_t *) arg;
+    tx_ctx_t* ctx = malloc(sizeof(tx_ctx_t));
+    tx_ctx_init(ctx, t->kvs_ops, t->kvs);
+    uint64_t rand_state = 0x9E3779B97F4A7C15ULL * (t->thread_id + 1);
+    uint64_t next_stamp = (uint64_t) (t->thread_id + 1) << 48;
+    stamped_t val;
+
+    while(!*t->stop){
+        uint64_t r = xorshift64(&rand_state);
+        uint64_t key = (r >> 8) % NUM_KEYS;
+        tx_trans_t* trans = tx_trans_create(ctx);
+        stamped_t* val_ptr;
+        obj_ref_t* ref;
+        uint64_t ptr_key = PTR_KEY;
+        uint8_t removes = 0; // (if the tx commits)
+        switch(r % 8){
+            case 0: case 1: case 2: // read
+                if(tx_trans_kv_get(trans, &key, sizeof(key), (void**) &val_ptr) == sizeof(stamped_t)){
+                    check_stamp(val_ptr, "tx get");
+                }
+                break;
+            case 3: // remove
+                removes = tx_trans_kv_del(trans, &key, sizeof(key)) == 0;
+                break;
+            case 4: // (re)insert or update
+                stamp(&val, next_stamp++);
+                tx_trans_kv_set(trans, &key, sizeof(key), &val, sizeof(val));
+                break;
+            case 5: // (re)insert or replace (put, outside of the tx)
+                stamp(&val, next_stamp++);
+                tx_single_kv_set(ctx, &key, sizeof(key), &val, sizeof(val));
+                break;
+            case 6: // read the current mem obj
+                tx_trans_kv_get(trans, &ptr_key, sizeof(ptr_key), (void**) &ref);
+                check_stamp((stamped_t *) tx_trans_obj_read(trans, ref->obj), "tx obj read");
+                break;
+            default: { // replace the current mem obj (freed once no tx may still read it)
+                tx_trans_kv_get(trans, &ptr_key, sizeof(ptr_key), (void**) &ref);
+                stamped_t* old_obj = ref->obj;
+                obj_ref_t new_ref = { (stamped_t *) tx_trans_obj_alloc(trans, sizeof(stamped_t)), next_stamp++ };
+                stamp(&val, new_ref.stamp);
+                tx_trans_obj_write(trans, new_ref.obj, (uint8_t *) &val, sizeof(val), 1);
+                tx_trans_kv_set(trans, &ptr_key, sizeof(ptr_key), &new_ref, sizeof(new_ref));
+                tx_trans_obj_free(trans, old_obj);
+                removes = 1;
+                break;
+            }
+        }
+        if(tx_trans_commit(trans) == committed) { t->removed += removes; }
+        tx_trans_destroy(trans);
+    }
+
+    t->in_limbo = ctx->epoch.num_retired;
+    tx_ctx_destroy(ctx);
+    free(ctx);
+    return NULL;
+}
+
+int main(int argc, char* argv[])
+{
+    int num_threads = argc > 1 ? atoi(argv[1]) : 4;
+    double secs     = argc > 2 ? atof(argv[2]) : 2;
+    const tx_kvs_ops_t* kvs_ops = tx_kvs_ops_by_name(argc > 3 ? argv[3] : "ht");
+    assert(num_threads > 0 && num_threads < TX_MAX_THREADS);
+    assert(kvs_ops != NULL);
+
+    void* kvs = kvs_ops->create(NUM_KEYS + 1);
+    tx_ctx_t* ctx = malloc(sizeof(tx_ctx_t));
+    tx_ctx_init(ctx, kvs_ops, kvs);
+    stamped_t val;
+    stamp(&val, 0);
+    tx_trans_t* trans = tx_trans_create(ctx);
+    obj_ref_t ref = { (stamped_t *) tx_trans_obj_alloc(trans, sizeof(stamped_t)), 0 };
+    tx_trans_obj_write(trans, ref.obj, (uint8_t *) &val, sizeof(val), 1);
+    uint64_t ptr_key = PTR_KEY;
+    tx_trans_kv_set(trans, &ptr_key, sizeof(ptr_key), &ref, sizeof(ref));
+    if(tx_trans_commit(trans) != committed) { printf("FAILED: the alloc of the obj failed\n"); return 1; }
+    tx_trans_destroy(trans);
+
+    volatile uint8_t stop = 0;
+    pthread_t threads[num_threads];
+    test_thread_t args[num_threads];
+    for(int i = 0; i < num_threads; ++i){
+        args[i] = (test_thread_t) { kvs_ops, kvs, i, &stop, 0, 0 };
+        pthread_create(&threads[i], NULL, run_removes_n_reads, &args[i]);
+    }
+    struct timespec duration = { (time_t) secs, (long) ((secs - (time_t) secs) * 1e9) };
+    nanosleep(&duration, NULL);
+    stop = 1;
+
+    uint64_t removed = 0, in_limbo = 0;
+    for(int i = 0; i < num_threads; ++i){
+        pthread_join(threads[i], NULL);
+        removed += args[i].removed;
+        in_limbo += args[i].in_limbo;
+    }
+    // (a ctx that is preempted in a tx holds back the reclamation of all the others, i.e., w/ more threads than cores
+    //  a limbo list may grow to several batches, but not along w/ the removed objs)
+    if(in_limbo > removed / 2){
+        printf("FAILED: %lu of the %lu removed objs were never reclaimed\n", in_limbo, removed);
+        return 1;
+    }
+    printf("OK: %lu objs removed, %lu left in the limbo lists (%d threads, %s)\n",
+           removed, in_limbo, num_threads, kvs_ops->name);
+
+    tx_ctx_destroy(ctx);
+    free(ctx);
+    kvs_ops->destroy(kvs);
+    return 0;
+}
@@ -0,0 +1,162 @@
+//
+// Invariant check of the phantom validation of range scans: txs insert into a range only while a scan of it finds
+//  fewer than MAX_ITEMS items, so the range never holds more (unless two txs miss each other's insert)
+//
+// usage: ./test_phantom [threads] [secs] [backend: skiplist]
+// e.g. gcc -O2 -pthread tx_shim_test_phantom.c tx_shim.c tx_shim_single.c tx_shim_trans.c tx_shim_slab.c
+//          tx_shim_kvs.c tx_shim_kvs_skiplist.c -o test_phantom
+//  (exits w/ 1 and prints FAILED on the first violation)
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <time.h>
+#include "tx_shim.h"
+
+#define RANGE_KEYS 64 // ids of the range (of which at most MAX_ITEMS exist)
+#define MAX_ITEMS  8
+
+typedef struct
+{
+    const tx_kvs_ops_t* kvs_ops;
+    void* kvs;
+    int thread_id;
+    volatile uint8_t* stop;
+    uint64_t committed;
+    uint64_t failed;
+} test_thread_t;
+
+// big-endian ids, i.e., memcmp-ordered (0 .. RANGE_KEYS - 1 and, outside of the range, RANGE_KEYS)
+static inline void test_key(uint8_t* key, uint64_t id)
+{
+    uint64_t be = __builtin_bswap64(id);
+    memcpy(key, &be, sizeof(be));
+}
+
+static inline uint64_t xorshift64(uint64_t* state)
+{
+    uint64_t x = *state;
+    x ^= x << 13; x ^= x >> 7; x ^= x << 17;
+    return *state = x;
+}
+
+typedef struct
+{
+    int n;
+    uint8_t keys[RANGE_KEYS][sizeof(uint64_t)];
+} range_items_t;
+
+static int collect_keys(void* key_ptr, uint32_t key_len, void* value_ptr, uint32_t val_len, void* cb_arg)
+{
+    (void) value_ptr; (void) val_len;
+    range_items_t* items = (range_items_t *) cb_arg;
+    if(key_len != sizeof(uint64_t) || items->n == RANGE_KEYS){
+        printf("FAILED: a key out of the range was scanned\n");
+        exit(1);
+    }
+    memcpy(items->keys[items->n++], key_ptr, sizeof(uint64_t));
+    return 0;
+}
+
+static void scan_range(tx_trans_t* trans, range_items_t* items)
+{
+    uint8_t from[sizeof(uint64_t)], to[sizeof(uint64_t)];
+    test_key(from, 0);
+    test_key(to, RANGE_KEYS);
+    items->n = 0;
+    if(tx_trans_kv_scan(trans, from, sizeof(from), to, sizeof(to), 0, collect_keys, items) < 0){
+        printf("FAILED: the backend is unordered (no scans)\n");
+        exit(1);
+    }
+}
+
+static void* run_inserts_n_deletes(void* arg)
+{
+    test_thread_t* t = (test_thread_t *) arg;
+    tx_ctx_t* ctx = malloc(sizeof(tx_ctx_t));
+    tx_ctx_init(ctx, t->kvs_ops, t->kvs);
+    uint64_t rand_state = 0x9E3779B97F4A7C15ULL * (t->thread_id + 1);
+    range_items_t items;
+
+    while(!*t->stop){
+        uint64_t r = xorshift64(&rand_state);
+        tx_trans_t* trans = tx_trans_create(ctx);
+        scan_range(trans, &items);
+        if(r % 4 != 0 && items.n < MAX_ITEMS){ // insert (if its key does not exist)
+            uint8_t key[sizeof(uint64_t)];
+            test_key(key, (r >> 8) % RANGE_KEYS);
+            void* val;
+            if(tx_trans_kv_get(trans, key, sizeof(key), &val) < 0){
+                tx_trans_kv_set(trans, key, sizeof(key), &r, sizeof(r));
+            }
+        }else if(items.n > 0){ // delete
+            tx_trans_kv_del(trans, items.keys[(r >> 8) % items.n], sizeof(uint64_t));
+        }
+        if(tx_trans_commit(trans) == committed){ // (only the scans of committed txs must be consistent)
+            if(items.n > MAX_ITEMS){
+                printf("FAILED: a committed scan found %d items (at most %d may exist)\n", items.n, MAX_ITEMS);
+                exit(1);
+            }
+            t->committed++;
+        }else{
+            t->failed++;
+        }
+        tx_trans_destroy(trans);
+    }
+
+    tx_ctx_destroy(ctx);
+    free(ctx);
+    return NULL;
+}
+
+int main(int argc, char* argv[])
+{
+    int num_threads = argc > 1 ? atoi(argv[1]) : 4;
+    double secs     = argc > 2 ? atof(argv[2]) : 2;
+    const tx_kvs_ops_t* kvs_ops = tx_kvs_ops_by_name(argc > 3 ? argv[3] : "skiplist");
+    assert(num_threads > 0 && num_threads < TX_MAX_THREADS);
+    assert(kvs_ops != NULL);
+
+    void* kvs = kvs_ops->create(RANGE_KEYS + 1);
+    tx_ctx_t* ctx = malloc(sizeof(tx_ctx_t));
+    tx_ctx_init(ctx, kvs_ops, kvs);
+    uint8_t key[sizeof(uint64_t)];
+    test_key(key, RANGE_KEYS); // (a neighbor right after the range)
+    uint64_t val = 0;
+    tx_single_kv_set(ctx, key, sizeof(key), &val, sizeof(val));
+
+    volatile uint8_t stop = 0;
+    pthread_t threads[num_threads];
+    test_thread_t args[num_threads];
+    for(int i = 0; i < num_threads; ++i){
+        args[i] = (test_thread_t) { kvs_ops, kvs, i, &stop, 0, 0 };
+        pthread_create(&threads[i], NULL, run_inserts_n_deletes, &args[i]);
+    }
+    struct timespec duration = { (time_t) secs, (long) ((secs - (time_t) secs) * 1e9) };
+    nanosleep(&duration, NULL);
+    stop = 1;
+
+    uint64_t num_committed = 0, num_failed = 0;
+    for(int i = 0; i < num_threads; ++i){
+        pthread_join(threads[i], NULL);
+        num_committed += args[i].committed;
+        num_failed += args[i].failed;
+    }
+
+    range_items_t items;
+    tx_trans_t* trans = tx_trans_create(ctx);
+    scan_range(trans, &items);
+    if(tx_trans_commit(trans) != committed || items.n > MAX_ITEMS){
+        printf("FAILED: the range holds %d items in the end (at most %d may exist)\n", items.n, MAX_ITEMS);
+        return 1;
+    }
+    tx_trans_destroy(trans);
+    printf("OK: %lu committed, %lu failed txs, %d items in the end (%d threads, %s)\n",
+           num_committed, num_failed, items.n, num_threads, kvs_ops->name);
+
+    tx_ctx_destroy(ctx);
+    free(ctx);
+    kvs_ops->destroy(kvs);
+    return 0;
+}
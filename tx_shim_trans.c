@@ -7,55 +7,203 @@
 #include <assert.h>
 #include <stdio.h>
 #include "tx_shim.h"
+#include "tx_shim_kvs.h" // __tx_kvs_hash / __tx_kvs_key_eq
+#include "tx_shim_stats.h"
 
 
 // Check if KV/object is already part of our tx
 // otherwise copy it from memory or kvs to our temporary trans buff expose the copy to the app
 
+//////////////////////////////////////////////////////////////////////////
+/// Index of opened objs / kvs
+//////////////////////////////////////////////////////////////////////////
+
+// Open addressing w/ linear probing; entries are never removed within a tx (obj_ids only grow)
+// and the index is grown along w/ obj_ids (load factor <= 1/4), so probing always reaches a free slot
+
+static inline uint64_t __tx_trans_obj_hash(void* obj_ptr)
+{
+    uint64_t h = (uint64_t) (uintptr_t) obj_ptr * 0x9E3779B97F4A7C15ULL;
+    return h ^ (h >> 29);
+}
+
+// returns the slot of the obj (key_ptr == NULL) or kv item (obj_ptr == NULL) or the free slot that ends its probing
+static inline tx_trans_idx_slot_t* __tx_trans_idx_find(tx_trans_t* trans, uint64_t hash, void* obj_ptr,
+                                                       uint8_t* key_ptr, uint16_t key_len)
+{
+    uint32_t hash_tag = (uint32_t) (hash >> 32);
+    for(uint32_t i = hash & trans->idx_mask; ; i = (i + 1) & trans->idx_mask){
+        tx_trans_idx_slot_t* slot = &trans->idx[i];
+        if(slot->epoch != trans->idx_epoch) { return slot; }
+        if(slot->hash_tag != hash_tag) { continue; }
+
+        tx_bufed_obj_id* obj_id = &trans->obj_ids[slot->obj_idx];
+        if(key_ptr == NULL){
+            if(obj_id->is_mem && obj_id->obj_ptr == obj_ptr) { return slot; }
+        }else if(!obj_id->is_mem && obj_id->kv.key_len == key_len &&
+                 __tx_kvs_key_eq(obj_id->kv.key, key_ptr, key_len))
+        {
+            return slot;
+        }
+    }
+}
+
+static inline void __tx_trans_idx_add(tx_trans_t* trans, tx_trans_idx_slot_t* free_slot, uint64_t hash, int obj_idx)
+{
+    assert(free_slot->epoch != trans->idx_epoch);
+    free_slot->epoch = trans->idx_epoch;
+    free_slot->obj_idx = (uint16_t) obj_idx;
+    free_slot->hash_tag = (uint32_t) (hash >> 32);
+}
+
+// doubles obj_ids (and rebuilds the index w/ 4x slots) if a tx is about to exceed its capacity
+static void __tx_trans_reserve_obj(tx_trans_t* trans)
+{
+    if(__builtin_expect(trans->curr_num_objs_in_tx < trans->max_objs_in_tx, 1)) { return; }
+    assert(trans->max_objs_in_tx <= UINT16_MAX / 2);
+    TX_STATS_INC(trans->parent, obj_cap_grows);
+
+    trans->max_objs_in_tx *= 2;
+    trans->obj_ids = realloc(trans->obj_ids, trans->max_objs_in_tx * sizeof(tx_bufed_obj_id));
+    free(trans->idx);
+    trans->idx_epoch = 1;
+    trans->idx_mask = 4 * trans->max_objs_in_tx - 1;
+    trans->idx = calloc(trans->idx_mask + 1, sizeof(tx_trans_idx_slot_t));
+
+    for(int i = 0; i < trans->curr_num_objs_in_tx; ++i){
+        tx_bufed_obj_id* obj_id = &trans->obj_ids[i];
+        uint64_t hash = obj_id->is_mem ? __tx_trans_obj_hash(obj_id->obj_ptr) :
+                                         __tx_kvs_hash(obj_id->kv.key, obj_id->kv.key_len);
+        tx_trans_idx_slot_t* slot = obj_id->is_mem ? __tx_trans_idx_find(trans, hash, obj_id->obj_ptr, NULL, 0) :
+                                    __tx_trans_idx_find(trans, hash, NULL, obj_id->kv.key, obj_id->kv.key_len);
+        if(slot->epoch == trans->idx_epoch){ // memory of a DELETED obj reused by a later ALLOCATE
+            slot->obj_idx = i;
+        }else{
+            __tx_trans_idx_add(trans, slot, hash, i);
+        }
+    }
+}
+
 //////////////////////////////////////////////////////////////////////////
 /// Transactional API
 //////////////////////////////////////////////////////////////////////////
 
+// An ADD obj accessed otherwise by the tx is read after all: its value is copied (and validated on commit),
+// the adds are applied on the copy and it becomes an UPDATE of the whole value
+static void __tx_trans_fold_adds(tx_trans_t* trans, tx_bufed_obj_id* obj_id)
+{
+    assert(obj_id->type == ADD);
+    if(!obj_id->is_mem){ // the item may have been replaced or removed since the adds
+        obj_id->int_obj_ptr = __lookup(trans->parent, obj_id->kv.key, obj_id->kv.key_len);
+        if(obj_id->int_obj_ptr == NULL){ // i.e., read as missing (as by __tx_trans_add_kv_item)
+            obj_id->buf_len = 0;
+            obj_id->buf = __tx_arena_alloc(&trans->arena, INT_OBJ_LEN(0));
+            memset(&obj_id->buf->hdr, 0, sizeof(obj_id->buf->hdr));
+            obj_id->buf->hdr.unique_alloc_id = trans->tx_id;
+            obj_id->existed_prior_tx = 0;
+            obj_id->deltas = NULL;
+            obj_id->type = READ;
+            return;
+        }
+    }
+
+    obj_id->buf_len = obj_id->int_obj_ptr->hdr.alloc_len;
+    obj_id->buf = __tx_arena_alloc(&trans->arena, INT_OBJ_LEN(obj_id->buf_len));
+    obj_id->version = __tx_obj_seqlock_copy(obj_id->buf, obj_id->int_obj_ptr, 0);
+    for(tx_trans_delta_t* delta = obj_id->deltas; delta != NULL; delta = delta->next){
+        if(delta->offset + delta->len <= obj_id->buf->hdr.curr_len) { __tx_delta_apply(obj_id->buf->val, delta); }
+    }
+    obj_id->deltas = NULL;
+    obj_id->type = UPDATE;
+}
+
+// appends a delta of len bytes (w/o its data) to the deltas of the obj
+static tx_trans_delta_t* __tx_trans_add_delta(tx_trans_t* trans, tx_bufed_obj_id* obj_id, uint32_t offset,
+                                              uint32_t len, uint8_t add_type)
+{
+    tx_trans_delta_t* delta = __tx_arena_alloc(&trans->arena, sizeof(tx_trans_delta_t) + len);
+    delta->next = NULL;
+    delta->offset = offset;
+    delta->len = len;
+    delta->add_type = add_type;
+
+    if(obj_id->deltas == NULL) { obj_id->deltas = delta; }
+    else{
+        tx_trans_delta_t* tail = obj_id->deltas;
+        while(tail->next != NULL) { tail = tail->next; }
+        tail->next = delta;
+    }
+    return delta;
+}
+
 // returns -1 if not in tx or obj idx of obj_id array if found
+static int __tx_trans_obj_idx(tx_trans_t* trans, void* obj_ptr) {
+    tx_trans_idx_slot_t* slot = __tx_trans_idx_find(trans, __tx_trans_obj_hash(obj_ptr), obj_ptr, NULL, 0);
+    if(slot->epoch != trans->idx_epoch) { return -1; }
+
+    assert(trans->obj_ids[slot->obj_idx].type != DELETED && trans->obj_ids[slot->obj_idx].type != TO_DELETE);
+    return slot->obj_idx;
+}
+
+// as __tx_trans_obj_idx but an ADD obj is read (see __tx_trans_fold_adds)
 static int __tx_trans_obj_in_tx(tx_trans_t* trans, void* obj_ptr) {
-    for(int i = 0; i < trans->curr_num_objs_in_tx; ++i){
-        if(!trans->obj_ids[i].is_mem) { continue; }
-        if(trans->obj_ids[i].obj_ptr == obj_ptr) {
-            assert(trans->obj_ids[i].type != DELETED && trans->obj_ids[i].type != TO_DELETE);
-            return i;
-        }
+    int obj_id_idx = __tx_trans_obj_idx(trans, obj_ptr);
+    if(obj_id_idx >= 0 && trans->obj_ids[obj_id_idx].type == ADD){
+        __tx_trans_fold_adds(trans, &trans->obj_ids[obj_id_idx]);
     }
-    return -1;
+    return obj_id_idx;
+}
+
+// Read-only txs known a priori (tx_rd_only_trans_create) open READs in place (i.e., zero-copy):
+// the app gets a ptr to the value in memory / kvs and the tx keeps only the (even) version it observed.
+// The value may change under the app until the commit, which then fails (i.e., the app must tolerate
+// the inconsistent reads of a doomed tx), while the epoch of the tx keeps the value alive.
+static inline uint8_t __tx_trans_read_in_place(tx_trans_t* trans, uint8_t type)
+{
+    return type == READ && trans->state == TX_READ_ONLY;
 }
 
 static int __tx_trans_add_obj(tx_trans_t* trans, void* obj_ptr, uint8_t type, uint32_t upd_len, uint8_t is_blind_upd) {
-    assert(__tx_trans_obj_in_tx(trans, obj_ptr) == -1);
-    assert(trans->curr_num_objs_in_tx < MAX_OBJ_IN_TX);
+    __tx_trans_reserve_obj(trans);
+    uint64_t hash = __tx_trans_obj_hash(obj_ptr);
+    tx_trans_idx_slot_t* slot = __tx_trans_idx_find(trans, hash, obj_ptr, NULL, 0);
+    assert(slot->epoch != trans->idx_epoch); // i.e., not already in tx
     assert(type != UPDATE || upd_len > 0 || is_blind_upd);
-    assert(type == READ || type == UPDATE || type == TO_DELETE);
+    assert(type == READ || type == UPDATE || type == TO_DELETE || type == ADD);
 
 
     tx_bufed_obj_id* tx_id_position = &trans->obj_ids[trans->curr_num_objs_in_tx];
 
     tx_id_position->is_mem = 1;
+    tx_id_position->is_partial = 0;
+    tx_id_position->deltas = NULL;
+    tx_id_position->is_locked = 0;
     tx_id_position->type = type;
     tx_id_position->obj_ptr = obj_ptr;
     tx_id_position->existed_prior_tx = 1;
 
-    // Copy the value
-    tx_max_internal_obj_val_t* tx_val_position = &trans->obj_vals[trans->curr_num_objs_in_tx];
     tx_internal_obj_val_t* int_obj_ptr = __obj_ptr_2_internal_obj_ptr(obj_ptr);
+    if(__tx_trans_read_in_place(trans, type) || type == ADD){ // (ADDs do not read the value)
+        tx_id_position->int_obj_ptr = int_obj_ptr;
+        tx_id_position->buf = type == ADD ? NULL : int_obj_ptr;
+        tx_id_position->buf_len = 0; // (never written)
+        tx_id_position->version = type == ADD ? 0 : __tx_obj_read_begin(int_obj_ptr);
+        __tx_trans_idx_add(trans, slot, hash, trans->curr_num_objs_in_tx);
+        return trans->curr_num_objs_in_tx++;
+    }
+
+    // Copy the value (the buf fits any write up to the -- immutable -- alloc_len of the obj)
     uint32_t curr_len = int_obj_ptr->hdr.curr_len;
+    tx_id_position->buf_len = int_obj_ptr->hdr.alloc_len;
+    tx_id_position->buf = __tx_arena_alloc(&trans->arena, INT_OBJ_LEN(tx_id_position->buf_len));
 
-    if(type == TO_DELETE || (type == UPDATE && (is_blind_upd || upd_len >= curr_len))){
-        // for pre-tx alloc values or updates that are either blind (change curr length) or try to write equal or higher
-        // number of bytes that already exist we copy only the header as an optimization
-        memcpy(tx_val_position, int_obj_ptr, sizeof(tx_internal_obj_val_t));
-    }else{
-        // copy of header + current length of object
-        memcpy(tx_val_position, int_obj_ptr, INT_OBJ_LEN(int_obj_ptr->hdr.curr_len));
-    }
+    // for pre-tx alloc values or updates that are either blind (change curr length) or try to write equal or higher
+    // number of bytes that already exist we copy only the header as an optimization
+    uint8_t hdr_only = type == TO_DELETE || (type == UPDATE && (is_blind_upd || upd_len >= curr_len));
+    tx_id_position->int_obj_ptr = int_obj_ptr;
+    tx_id_position->version = __tx_obj_seqlock_copy(tx_id_position->buf, int_obj_ptr, hdr_only);
 
+    __tx_trans_idx_add(trans, slot, hash, trans->curr_num_objs_in_tx);
     return trans->curr_num_objs_in_tx++;
 }
 
@@ -63,20 +211,36 @@ static int __tx_trans_add_obj(tx_trans_t* trans, void* obj_ptr, uint8_t type, ui
 
 void* tx_trans_obj_alloc(tx_trans_t* trans, uint32_t obj_len)
 {
+    TX_STATS_TIME_OP(trans->parent, TX_STAT_OBJ_ALLOC);
+    __tx_trans_reserve_obj(trans);
 
     void* ret_ptr = tx_single_obj_alloc(trans->parent, obj_len, trans->tx_id);
 
     tx_bufed_obj_id* tx_id_position = &trans->obj_ids[trans->curr_num_objs_in_tx];
     tx_id_position->is_mem = 1;
+    tx_id_position->is_partial = 0;
+    tx_id_position->deltas = NULL;
+    tx_id_position->is_locked = 0;
     tx_id_position->type = ALLOCATE;
     tx_id_position->obj_ptr = ret_ptr;
+    tx_id_position->int_obj_ptr = __obj_ptr_2_internal_obj_ptr(ret_ptr);
+    tx_id_position->version = 0;
     tx_id_position->existed_prior_tx = 0;
 
-    tx_max_internal_obj_val_t* tx_val_position = &trans->obj_vals[trans->curr_num_objs_in_tx];
-    tx_val_position->hdr = ((tx_internal_obj_val_t*) ret_ptr)->hdr;
+    tx_id_position->buf_len = obj_len;
+    tx_id_position->buf = __tx_arena_alloc(&trans->arena, INT_OBJ_LEN(obj_len));
+    tx_id_position->buf->hdr = tx_id_position->int_obj_ptr->hdr;
 
     __tx_trans_state_update(trans, ALLOCATE);
 
+    uint64_t hash = __tx_trans_obj_hash(ret_ptr);
+    tx_trans_idx_slot_t* slot = __tx_trans_idx_find(trans, hash, ret_ptr, NULL, 0);
+    if(slot->epoch == trans->idx_epoch){ // memory of an obj allocated and freed earlier by this tx is reused
+        assert(trans->obj_ids[slot->obj_idx].type == DELETED);
+        slot->obj_idx = trans->curr_num_objs_in_tx;
+    }else{
+        __tx_trans_idx_add(trans, slot, hash, trans->curr_num_objs_in_tx);
+    }
     trans->curr_num_objs_in_tx++;
     return ret_ptr;
 }
@@ -84,6 +248,7 @@ void* tx_trans_obj_alloc(tx_trans_t* trans, uint32_t obj_len)
 // If an object is found opened by tx and in DELETE or NOOP state then error
 void tx_trans_obj_free(tx_trans_t* trans, void* obj_ptr)
 {
+    TX_STATS_TIME_OP(trans->parent, TX_STAT_OBJ_FREE);
     assert(obj_ptr != NULL);
 
     int obj_id_idx = __tx_trans_obj_in_tx(trans, obj_ptr);
@@ -107,6 +272,7 @@ void tx_trans_obj_free(tx_trans_t* trans, void* obj_ptr)
 
 void* tx_trans_obj_read(tx_trans_t* trans, void* obj_ptr)
 {
+    TX_STATS_TIME_OP(trans->parent, TX_STAT_OBJ_READ);
     assert(obj_ptr != NULL);
 
     int obj_id_idx = __tx_trans_obj_in_tx(trans, obj_ptr);
@@ -115,12 +281,13 @@ void* tx_trans_obj_read(tx_trans_t* trans, void* obj_ptr)
         obj_id_idx = __tx_trans_add_obj(trans, obj_ptr, READ, 0, 0);
     }
 
-    return __internal_obj_ptr_2_obj_ptr((tx_internal_obj_val_t *) &trans->obj_vals[obj_id_idx]);
+    return __internal_obj_ptr_2_obj_ptr(trans->obj_ids[obj_id_idx].buf);
 }
 
 // TODO may add support for starting an update with padding i.e., avoid updating X first bytes
 void tx_trans_obj_write(tx_trans_t* trans, void* obj_ptr, uint8_t* val_ptr, uint32_t upd_len, uint8_t is_blind)
 {
+    TX_STATS_TIME_OP(trans->parent, TX_STAT_OBJ_WRITE);
     assert(obj_ptr != NULL && val_ptr != NULL);
     assert(upd_len <= MAX_VAL_LEN);
 
@@ -129,19 +296,43 @@ void tx_trans_obj_write(tx_trans_t* trans, void* obj_ptr, uint8_t* val_ptr, uint
     if(obj_id_idx >= 0) { // object was in tx
         assert(trans->obj_ids[obj_id_idx].type != DELETED &&
                trans->obj_ids[obj_id_idx].type != TO_DELETE);
-        trans->obj_ids[obj_id_idx].type = UPDATE;
+        if(trans->obj_ids[obj_id_idx].type != ALLOCATE){ // allocated objs are simply copied on commit
+            trans->obj_ids[obj_id_idx].type = UPDATE;
+        }
 
     }else { // object was NOT in tx
         obj_id_idx = __tx_trans_add_obj(trans, obj_ptr, UPDATE, upd_len, is_blind);
     }
+    __tx_trans_state_update(trans, UPDATE); // (before writing the buf, which is in place for read-only txs)
 
-    assert(upd_len <= trans->obj_vals[obj_id_idx].hdr.alloc_len);
-    memcpy(trans->obj_vals[obj_id_idx].val, val_ptr, upd_len);
-    if(is_blind || upd_len > trans->obj_vals[obj_id_idx].hdr.curr_len){
-        trans->obj_vals[obj_id_idx].hdr.curr_len = upd_len;
+    tx_internal_obj_val_t* buf = trans->obj_ids[obj_id_idx].buf;
+    assert(upd_len <= trans->obj_ids[obj_id_idx].buf_len);
+    memcpy(buf->val, val_ptr, upd_len);
+    if(is_blind || upd_len > buf->hdr.curr_len){
+        buf->hdr.curr_len = upd_len;
     }
+}
 
-    __tx_trans_state_update(trans, UPDATE);
+void tx_trans_obj_add(tx_trans_t* trans, void* obj_ptr, uint32_t offset, tx_add_type_t add_type, void* operand_ptr)
+{
+    TX_STATS_TIME_OP(trans->parent, TX_STAT_OBJ_ADD);
+    assert(obj_ptr != NULL && operand_ptr != NULL);
+    uint32_t len = __tx_add_len(add_type);
+    __tx_trans_state_update(trans, ADD);
+
+    int obj_id_idx = __tx_trans_obj_idx(trans, obj_ptr);
+    if(obj_id_idx >= 0 && trans->obj_ids[obj_id_idx].type != ADD){ // already read / written --> add to the copy
+        tx_bufed_obj_id* obj_id = &trans->obj_ids[obj_id_idx];
+        assert(offset + len <= obj_id->buf_len);
+        __tx_add_apply(obj_id->buf->val + offset, add_type, operand_ptr);
+        if(obj_id->type == READ) { obj_id->type = UPDATE; }
+        return;
+    }
+
+    if(obj_id_idx < 0) { obj_id_idx = __tx_trans_add_obj(trans, obj_ptr, ADD, 0, 0); }
+    assert(offset + len <= __obj_ptr_2_internal_obj_ptr(obj_ptr)->hdr.alloc_len);
+    tx_trans_delta_t* delta = __tx_trans_add_delta(trans, &trans->obj_ids[obj_id_idx], offset, len, add_type);
+    memcpy(delta->data, operand_ptr, len);
 }
 
 
@@ -155,37 +346,80 @@ void tx_trans_obj_write(tx_trans_t* trans, void* obj_ptr, uint8_t* val_ptr, uint
 
 
 // returns -1 if not in tx or obj idx of obj_id array if found
+static int __tx_trans_kv_idx(tx_trans_t* trans, uint8_t* key_ptr, uint16_t key_len)
+{
+    tx_trans_idx_slot_t* slot = __tx_trans_idx_find(trans, __tx_kvs_hash(key_ptr, key_len), NULL, key_ptr, key_len);
+    return slot->epoch == trans->idx_epoch ? slot->obj_idx : -1;
+}
+
+// as __tx_trans_kv_idx but an ADD item is read (see __tx_trans_fold_adds)
 static int __tx_trans_kv_in_tx(tx_trans_t* trans, uint8_t* key_ptr, uint16_t key_len)
 {
-    for(int i = 0; i < trans->curr_num_objs_in_tx; ++i){
-        if(trans->obj_ids[i].is_mem) { continue; }
-        if(trans->obj_ids[i].kv.key_len != key_len) { continue; }
-        if(memcmp(trans->obj_ids[i].kv.key, key_ptr, key_len) == 0) { return i; }
+    int obj_id_idx = __tx_trans_kv_idx(trans, key_ptr, key_len);
+    if(obj_id_idx >= 0 && trans->obj_ids[obj_id_idx].type == ADD){
+        __tx_trans_fold_adds(trans, &trans->obj_ids[obj_id_idx]);
     }
-    return -1;
+    return obj_id_idx;
 }
 
-static int __tx_trans_add_kv(tx_trans_t* trans, uint8_t* key_ptr, uint16_t key_len, uint8_t type)
+// whether the tx already has an item of the key (i.e., accessing it again touches only the buffers of the tx)
+uint8_t __tx_trans_kv_opened(tx_trans_t* trans, void* key_ptr, uint32_t key_len)
 {
-    assert(__tx_trans_kv_in_tx(trans, key_ptr, key_len) == -1);
-    assert(trans->curr_num_objs_in_tx < MAX_OBJ_IN_TX);
-    assert(type == READ || type == UPDATE || type == TO_DELETE);
+    return __tx_trans_kv_idx(trans, key_ptr, key_len) >= 0;
+}
+
+// val_len: len of the value to be written by an UPDATE; int_obj_ptr: the item of the key in the kvs (NULL if none)
+// partial: a READ by a range op (only the header is copied, see tx_trans_kv_get_range)
+static int __tx_trans_add_kv_item(tx_trans_t* trans, uint8_t* key_ptr, uint16_t key_len, uint8_t type, uint32_t val_len,
+                                  tx_internal_obj_val_t* int_obj_ptr, uint8_t partial)
+{
+    __tx_trans_reserve_obj(trans);
+    uint64_t hash = __tx_kvs_hash(key_ptr, key_len);
+    tx_trans_idx_slot_t* slot = __tx_trans_idx_find(trans, hash, NULL, key_ptr, key_len);
+    assert(slot->epoch != trans->idx_epoch); // i.e., not already in tx
+    assert(type == READ || type == UPDATE || type == TO_DELETE || (type == ADD && int_obj_ptr != NULL));
 
     tx_bufed_obj_id* tx_id_position = &trans->obj_ids[trans->curr_num_objs_in_tx];
 
     tx_id_position->is_mem = 0;
+    tx_id_position->is_partial = 0;
+    tx_id_position->deltas = NULL;
+    tx_id_position->is_locked = 0;
     tx_id_position->type = type;
-    tx_id_position->obj_ptr = NULL;
     tx_id_position->existed_prior_tx = 1; // Being optimistic
     tx_id_position->kv.key_len = key_len;
     memcpy(&tx_id_position->kv.key, key_ptr, key_len);
 
-    // Copy the value to tx buf
-    tx_max_internal_obj_val_t* tx_val_position = &trans->obj_vals[trans->curr_num_objs_in_tx];
-    int length = __get(trans->parent, key_ptr, key_len, tx_val_position, INT_OBJ_LEN(MAX_KEY_LEN));
-
+    tx_id_position->int_obj_ptr = int_obj_ptr;
+    tx_id_position->version = 0;
+    if(type == ADD){ // the value is not read
+        tx_id_position->buf = NULL;
+        tx_id_position->buf_len = 0;
+        __tx_trans_idx_add(trans, slot, hash, trans->curr_num_objs_in_tx);
+        return trans->curr_num_objs_in_tx++;
+    }
+    if(__tx_trans_read_in_place(trans, type)){
+        tx_id_position->buf = int_obj_ptr; // NULL if not found (never exposed)
+        tx_id_position->buf_len = 0;
+        if(int_obj_ptr != NULL) { tx_id_position->version = __tx_obj_read_begin(int_obj_ptr); }
+        else { tx_id_position->existed_prior_tx = 0; }
+        __tx_trans_idx_add(trans, slot, hash, trans->curr_num_objs_in_tx);
+        return trans->curr_num_objs_in_tx++;
+    }
 
-    if(length < 0){  // Key not found
+    // Copy the value to tx buf (UPDATEs overwrite the whole value and partial READs copy the ranges they access
+    // so only the header is copied)
+    tx_id_position->buf_len = type == UPDATE ? val_len :
+                              type == READ && tx_id_position->int_obj_ptr != NULL ?
+                              tx_id_position->int_obj_ptr->hdr.alloc_len : 0;
+    tx_internal_obj_val_t* tx_val_position = __tx_arena_alloc(&trans->arena, INT_OBJ_LEN(tx_id_position->buf_len));
+    tx_id_position->buf = tx_val_position;
+
+    if(tx_id_position->int_obj_ptr != NULL){
+        tx_id_position->is_partial = partial;
+        tx_id_position->version = __tx_obj_seqlock_copy(tx_val_position, tx_id_position->int_obj_ptr,
+                                                        type != READ || partial);
+    }else{  // Key not found
         tx_id_position->existed_prior_tx = 0;
         if(type == TO_DELETE){
             tx_id_position->type = DELETED;
@@ -200,36 +434,121 @@ static int __tx_trans_add_kv(tx_trans_t* trans, uint8_t* key_ptr, uint16_t key_l
 
     }
 
+    __tx_trans_idx_add(trans, slot, hash, trans->curr_num_objs_in_tx);
     return trans->curr_num_objs_in_tx++;
 }
 
+static inline int __tx_trans_add_kv(tx_trans_t* trans, uint8_t* key_ptr, uint16_t key_len, uint8_t type, uint32_t val_len)
+{
+    return __tx_trans_add_kv_item(trans, key_ptr, key_len, type, val_len, __lookup(trans->parent, key_ptr, key_len), 0);
+}
+
+// copies [offset, offset + len) of the value of a partially opened kv item to its buf (following the seqlock protocol)
+// and re-applies the deltas of the tx on it (if the value changed since it was opened the commit fails anyway)
+static void __tx_trans_kv_load_range(tx_bufed_obj_id* obj_id, uint32_t offset, uint32_t len)
+{
+    tx_internal_obj_val_t* int_obj_ptr = obj_id->int_obj_ptr;
+    uint32_t version;
+    do{
+        version = __tx_obj_read_begin(int_obj_ptr);
+        memcpy(obj_id->buf->val + offset, int_obj_ptr->val + offset, len);
+    }while(__tx_obj_read_retry(int_obj_ptr, version));
+
+    for(tx_trans_delta_t* delta = obj_id->deltas; delta != NULL; delta = delta->next){
+        uint32_t from = delta->offset > offset ? delta->offset : offset;
+        uint32_t to = delta->offset + delta->len < offset + len ? delta->offset + delta->len : offset + len;
+        if(from < to) { memcpy(obj_id->buf->val + from, delta->data + (from - delta->offset), to - from); }
+    }
+}
+
+// buf of a kv item w/ its whole value (i.e., a partially opened item is copied whole)
+static inline tx_internal_obj_val_t* __tx_trans_kv_buf(tx_bufed_obj_id* obj_id)
+{
+    if(obj_id->is_partial){
+        __tx_trans_kv_load_range(obj_id, 0, obj_id->buf->hdr.curr_len);
+        obj_id->is_partial = 0;
+    }
+    return obj_id->buf;
+}
+
 //////////////////////////////////////////////////////////////////////////
 
+// the value (or NULL) of a kv item opened by a get
+static inline int __tx_trans_kv_get_val(tx_trans_t* trans, int obj_id_idx, void** value_ptr)
+{
+    tx_bufed_obj_id* tx_id_position = &trans->obj_ids[obj_id_idx];
+    if(tx_id_position->type == TO_DELETE || tx_id_position->type == DELETED ||
+       (!tx_id_position->existed_prior_tx && tx_id_position->type == READ))
+    {
+        *value_ptr = NULL;
+        return -1;
+    }
+
+    *value_ptr = __internal_obj_ptr_2_obj_ptr(__tx_trans_kv_buf(tx_id_position));
+    return tx_id_position->buf->hdr.curr_len;
+}
+
 // returns value length (-1 if not found) and value_ptr (NULL if not found)
 int tx_trans_kv_get(tx_trans_t* trans, void* key_ptr, uint32_t key_len, void** value_ptr)
 {
+    TX_STATS_TIME_OP(trans->parent, TX_STAT_KV_GET);
     assert(key_ptr != NULL);
 
     int obj_id_idx = __tx_trans_kv_in_tx(trans, key_ptr, key_len);
 
     if(obj_id_idx < 0) { // if object was not in tx
-        obj_id_idx = __tx_trans_add_kv(trans, key_ptr, key_len, READ);
+        obj_id_idx = __tx_trans_add_kv(trans, key_ptr, key_len, READ, 0);
     }
 
-    tx_bufed_obj_id* tx_id_position = &trans->obj_ids[obj_id_idx];
-    if(!tx_id_position->existed_prior_tx &&
-       (tx_id_position->type == READ || tx_id_position->type == TO_DELETE))
-    {
-        *value_ptr = NULL;
-        return -1;
-    }
+    return __tx_trans_kv_get_val(trans, obj_id_idx, value_ptr);
+}
 
-    *value_ptr = __internal_obj_ptr_2_obj_ptr((tx_internal_obj_val_t *) &trans->obj_vals[obj_id_idx]);
-    return trans->obj_vals[obj_id_idx].hdr.curr_len;
+// Each stage runs over a batch of keys before the next one, so the misses of a stage overlap (keys already in the
+// tx are neither prefetched nor looked up)
+int tx_trans_kv_multi_get(tx_trans_t* trans, tx_trans_kv_get_t* gets, uint32_t num_gets)
+{
+    TX_STATS_TIME_OP(trans->parent, TX_STAT_KV_MULTI_GET);
+    tx_ctx_t* tx_ctx = trans->parent;
+    int obj_id_idxs[TX_MULTI_GET_BATCH];
+    tx_internal_obj_val_t* int_obj_ptrs[TX_MULTI_GET_BATCH];
+    int num_found = 0;
+
+    for(uint32_t from = 0; from < num_gets; from += TX_MULTI_GET_BATCH){
+        tx_trans_kv_get_t* batch = &gets[from];
+        uint32_t batch_len = num_gets - from < TX_MULTI_GET_BATCH ? num_gets - from : TX_MULTI_GET_BATCH;
+
+        // 1) the index entries of the keys
+        for(uint32_t i = 0; i < batch_len; ++i){
+            assert(batch[i].key_ptr != NULL);
+            obj_id_idxs[i] = __tx_trans_kv_in_tx(trans, batch[i].key_ptr, batch[i].key_len);
+            if(obj_id_idxs[i] < 0) { __prefetch(tx_ctx, batch[i].key_ptr, batch[i].key_len); }
+        }
+        // 2) the objs of the keys (the lookups hit the prefetched entries)
+        for(uint32_t i = 0; i < batch_len; ++i){
+            if(obj_id_idxs[i] >= 0) { continue; }
+            int_obj_ptrs[i] = __lookup(tx_ctx, batch[i].key_ptr, batch[i].key_len);
+            if(int_obj_ptrs[i] != NULL) { __tx_obj_prefetch(int_obj_ptrs[i], TX_CACHE_LINE_SIZE); }
+        }
+        // 3) open the items (copying the prefetched values)
+        for(uint32_t i = 0; i < batch_len; ++i){
+            int obj_id_idx = obj_id_idxs[i];
+            if(obj_id_idx < 0){ // (unless an earlier key of the batch was the same)
+                obj_id_idx = __tx_trans_kv_in_tx(trans, batch[i].key_ptr, batch[i].key_len);
+            }
+            if(obj_id_idx < 0){
+                obj_id_idx = __tx_trans_add_kv_item(trans, batch[i].key_ptr, batch[i].key_len, READ, 0,
+                                                    int_obj_ptrs[i], 0);
+            }
+            batch[i].val_len = __tx_trans_kv_get_val(trans, obj_id_idx, &batch[i].value_ptr);
+            if(batch[i].val_len >= 0) { num_found++; }
+        }
+    }
+    return num_found;
 }
 
 void tx_trans_kv_set(tx_trans_t* trans, void* key_ptr, uint32_t key_len, void* val_ptr, uint32_t val_len)
 {
+    TX_STATS_TIME_OP(trans->parent, TX_STAT_KV_SET);
     assert(key_ptr != NULL && val_ptr != NULL);
     assert(val_len <= MAX_VAL_LEN);
 
@@ -241,13 +560,23 @@ void tx_trans_kv_set(tx_trans_t* trans, void* key_ptr, uint32_t key_len, void* v
         trans->obj_ids[obj_id_idx].type = UPDATE;
 
     }else { // object was NOT in tx
-        obj_id_idx = __tx_trans_add_kv(trans, key_ptr, key_len, UPDATE);
+        obj_id_idx = __tx_trans_add_kv(trans, key_ptr, key_len, UPDATE, val_len);
+    }
+
+    tx_bufed_obj_id* tx_id_position = &trans->obj_ids[obj_id_idx];
+    if(val_len > tx_id_position->buf_len){ // does not fit --> move to a larger buf (ptrs from earlier gets are stale)
+        tx_internal_obj_val_t* buf = __tx_arena_alloc(&trans->arena, INT_OBJ_LEN(val_len));
+        buf->hdr = tx_id_position->buf->hdr;
+        tx_id_position->buf = buf;
+        tx_id_position->buf_len = val_len;
     }
 
     // Always treated as overwriting the whole value
-    memcpy(trans->obj_vals[obj_id_idx].val, val_ptr, val_len);
-    trans->obj_vals[obj_id_idx].hdr.curr_len = val_len;
-    trans->obj_vals[obj_id_idx].hdr.alloc_len = val_len;
+    memcpy(tx_id_position->buf->val, val_ptr, val_len);
+    tx_id_position->buf->hdr.curr_len = val_len;
+    tx_id_position->buf->hdr.alloc_len = val_len;
+    tx_id_position->is_partial = 0;
+    tx_id_position->deltas = NULL;
 
     __tx_trans_state_update(trans, UPDATE);
 }
@@ -255,6 +584,7 @@ void tx_trans_kv_set(tx_trans_t* trans, void* key_ptr, uint32_t key_len, void* v
 // If an object is found opened by tx and in DELETE or NOOP state then error
 int tx_trans_kv_del(tx_trans_t* trans, void* key_ptr, uint32_t key_len)
 {
+    TX_STATS_TIME_OP(trans->parent, TX_STAT_KV_DEL);
     assert(key_ptr != NULL);
 
     int obj_id_idx = __tx_trans_kv_in_tx(trans, key_ptr, key_len);
@@ -268,12 +598,260 @@ int tx_trans_kv_del(tx_trans_t* trans, void* key_ptr, uint32_t key_len)
         }
 
     }else{ // object was NOT in tx
-        __tx_trans_add_kv(trans, key_ptr, key_len, TO_DELETE);
+        __tx_trans_add_kv(trans, key_ptr, key_len, TO_DELETE, 0);
     }
 
     __tx_trans_state_update(trans, TO_DELETE); // Note passing either TO_DELETE or DELETED is same
+    return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////
+/// Byte ranges of kv items
+//////////////////////////////////////////////////////////////////////////
+
+// returns the obj idx of the (existing) kv item if [offset, offset + len) is within its value or -1
+static int __tx_trans_kv_open_range(tx_trans_t* trans, uint8_t* key_ptr, uint32_t key_len, uint32_t offset, uint32_t len)
+{
+    int obj_id_idx = __tx_trans_kv_in_tx(trans, key_ptr, key_len);
+    if(obj_id_idx < 0){
+        obj_id_idx = __tx_trans_add_kv_item(trans, key_ptr, key_len, READ, 0, __lookup(trans->parent, key_ptr, key_len), 1);
+    }
+
+    tx_bufed_obj_id* obj_id = &trans->obj_ids[obj_id_idx];
+    if(obj_id->type == TO_DELETE || obj_id->type == DELETED ||
+       (!obj_id->existed_prior_tx && obj_id->type == READ) ||
+       (uint64_t) offset + len > obj_id->buf->hdr.curr_len)
+    {
+        return -1;
+    }
+    return obj_id_idx;
+}
+
+int tx_trans_kv_get_range(tx_trans_t* trans, void* key_ptr, uint32_t key_len, uint32_t offset, uint32_t len,
+                          void** value_ptr)
+{
+    TX_STATS_TIME_OP(trans->parent, TX_STAT_KV_GET_RANGE);
+    assert(key_ptr != NULL);
+
+    int obj_id_idx = __tx_trans_kv_open_range(trans, key_ptr, key_len, offset, len);
+    if(obj_id_idx < 0){
+        *value_ptr = NULL;
+        return -1;
+    }
+
+    tx_bufed_obj_id* obj_id = &trans->obj_ids[obj_id_idx];
+    if(obj_id->is_partial) { __tx_trans_kv_load_range(obj_id, offset, len); }
+    *value_ptr = __internal_obj_ptr_2_obj_ptr(obj_id->buf);
+    return obj_id->buf->hdr.curr_len;
+}
+
+int tx_trans_kv_update_range(tx_trans_t* trans, void* key_ptr, uint32_t key_len, uint32_t offset, void* src_ptr,
+                             uint32_t len)
+{
+    TX_STATS_TIME_OP(trans->parent, TX_STAT_KV_UPDATE_RANGE);
+    assert(key_ptr != NULL && src_ptr != NULL);
+
+    int obj_id_idx = __tx_trans_kv_open_range(trans, key_ptr, key_len, offset, len);
+    if(obj_id_idx < 0) { return -1; }
+    __tx_trans_state_update(trans, UPDATE); // (before writing the buf, which is in place for read-only txs)
+
+    // items that are already written whole (set / inserted by the tx) are installed whole
+    tx_bufed_obj_id* obj_id = &trans->obj_ids[obj_id_idx];
+    if(obj_id->type != UPDATE || obj_id->deltas != NULL){
+        tx_trans_delta_t* delta = __tx_trans_add_delta(trans, obj_id, offset, len, TX_ADD_NONE);
+        memcpy(delta->data, src_ptr, len);
+        obj_id->type = UPDATE;
+    }
+
+    memmove(obj_id->buf->val + offset, src_ptr, len); // (src may be the buf returned by a get)
+    return 0;
+}
+
+int tx_trans_kv_add(tx_trans_t* trans, void* key_ptr, uint32_t key_len, uint32_t offset, tx_add_type_t add_type,
+                    void* operand_ptr)
+{
+    TX_STATS_TIME_OP(trans->parent, TX_STAT_KV_ADD);
+    assert(key_ptr != NULL && operand_ptr != NULL);
+    uint32_t len = __tx_add_len(add_type);
+    __tx_trans_state_update(trans, ADD);
+
+    int obj_id_idx = __tx_trans_kv_idx(trans, key_ptr, key_len);
+    if(obj_id_idx >= 0 && trans->obj_ids[obj_id_idx].type != ADD){ // already read / written --> update the field
+        uint8_t* val_ptr;
+        if(tx_trans_kv_get_range(trans, key_ptr, key_len, offset, len, (void**) &val_ptr) < 0) { return -1; }
+        uint8_t field[8];
+        memcpy(field, val_ptr + offset, len);
+        __tx_add_apply(field, add_type, operand_ptr);
+        return tx_trans_kv_update_range(trans, key_ptr, key_len, offset, field, len);
+    }
+
+    if(obj_id_idx < 0){
+        tx_internal_obj_val_t* int_obj_ptr = __lookup(trans->parent, key_ptr, key_len);
+        if(int_obj_ptr == NULL || offset + len > int_obj_ptr->hdr.curr_len) { return -1; }
+        obj_id_idx = __tx_trans_add_kv_item(trans, key_ptr, key_len, ADD, 0, int_obj_ptr, 0);
+    }
+    tx_trans_delta_t* delta = __tx_trans_add_delta(trans, &trans->obj_ids[obj_id_idx], offset, len, add_type);
+    memcpy(delta->data, operand_ptr, len);
+    return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////
+/// Range scans
+//////////////////////////////////////////////////////////////////////////
+
+typedef struct
+{
+    tx_trans_t*       trans;
+    tx_trans_range_t* range;
+    uint32_t          max_items;
+    uint32_t          num_visible;   // items not deleted by the tx
+    uint32_t          max_range_items;
+} __tx_trans_scan_state_t;
+
+static inline uint8_t __tx_trans_kv_is_deleted(tx_trans_t* trans, uint8_t* key_ptr, uint32_t key_len)
+{
+    int obj_id_idx = __tx_trans_kv_idx(trans, key_ptr, key_len);
+    return obj_id_idx >= 0 && (trans->obj_ids[obj_id_idx].type == TO_DELETE ||
+                               trans->obj_ids[obj_id_idx].type == DELETED);
+}
+
+// collects the items of the range (the arena array is doubled when full)
+static int __tx_trans_scan_collect(void* key_ptr, uint32_t key_len, tx_internal_obj_val_t* int_obj_ptr, void* cb_arg)
+{
+    __tx_trans_scan_state_t* state = (__tx_trans_scan_state_t *) cb_arg;
+    tx_trans_range_t* range = state->range;
+
+    if(range->num_items == state->max_range_items){
+        state->max_range_items = state->max_range_items == 0 ? 16 : 2 * state->max_range_items;
+        tx_trans_scan_item_t* items = __tx_arena_alloc(&state->trans->arena,
+                                                       state->max_range_items * sizeof(tx_trans_scan_item_t));
+        if(range->num_items > 0) { memcpy(items, range->items, range->num_items * sizeof(tx_trans_scan_item_t)); }
+        range->items = items;
+    }
+    range->items[range->num_items++] = (tx_trans_scan_item_t) { key_ptr, key_len, int_obj_ptr };
+
+    if(!__tx_trans_kv_is_deleted(state->trans, key_ptr, key_len)) { state->num_visible++; }
+    return state->max_items > 0 && state->num_visible == state->max_items;
 }
 
+static tx_trans_range_t* __tx_trans_add_range(tx_trans_t* trans, void* from_key, uint32_t from_len,
+                                              void* to_key, uint32_t to_len)
+{
+    if(trans->num_ranges == trans->max_ranges){
+        trans->max_ranges = trans->max_ranges == 0 ? 4 : 2 * trans->max_ranges;
+        tx_trans_range_t* ranges = __tx_arena_alloc(&trans->arena, trans->max_ranges * sizeof(tx_trans_range_t));
+        if(trans->num_ranges > 0) { memcpy(ranges, trans->ranges, trans->num_ranges * sizeof(tx_trans_range_t)); }
+        trans->ranges = ranges;
+    }
 
+    tx_trans_range_t* range = &trans->ranges[trans->num_ranges++];
+    range->from_key = __tx_arena_alloc(&trans->arena, from_len);
+    memcpy(range->from_key, from_key, from_len);
+    range->from_len = from_len;
+    range->to_key = NULL;
+    range->to_len = 0;
+    if(to_key != NULL){
+        range->to_key = __tx_arena_alloc(&trans->arena, to_len);
+        memcpy(range->to_key, to_key, to_len);
+        range->to_len = to_len;
+    }
+    range->exhausted = 0;
+    range->num_items = 0;
+    range->items = NULL;
+    return range;
+}
 
+int tx_trans_kv_scan(tx_trans_t* trans, void* from_key, uint32_t from_len, void* to_key, uint32_t to_len,
+                     uint32_t max_items, tx_trans_scan_cb cb, void* cb_arg)
+{
+    TX_STATS_TIME_OP(trans->parent, TX_STAT_KV_SCAN);
+    assert(from_key != NULL && from_len <= MAX_KEY_LEN && to_len <= MAX_KEY_LEN);
 
+    tx_trans_range_t* range = __tx_trans_add_range(trans, from_key, from_len, to_key, to_len);
+    __tx_trans_scan_state_t state = { trans, range, max_items, 0, 0 };
+    if(__scan(trans->parent, from_key, from_len, to_key, to_len, __tx_trans_scan_collect, &state) < 0){
+        trans->num_ranges--;
+        return -1;
+    }
+    range->exhausted = max_items == 0 || state.num_visible < max_items;
+    int range_idx = trans->num_ranges - 1; // (cb may scan as well and move the ranges)
+
+    // open the items (as by tx_trans_kv_get) and pass their values to cb
+    int num_passed = 0;
+    uint32_t num_items = range->num_items;
+    for(uint32_t i = 0; i < num_items; ++i){
+        tx_trans_scan_item_t* item = &range->items[i];
+        int obj_id_idx = __tx_trans_kv_in_tx(trans, item->key_ptr, item->key_len);
+        if(obj_id_idx < 0){
+            obj_id_idx = __tx_trans_add_kv_item(trans, item->key_ptr, item->key_len, READ, 0, item->int_obj_ptr, 0);
+        }
+
+        tx_bufed_obj_id* obj_id = &trans->obj_ids[obj_id_idx];
+        if(obj_id->type == TO_DELETE || obj_id->type == DELETED ||
+           (!obj_id->existed_prior_tx && obj_id->type == READ)) // found missing earlier --> the tx fails anyway
+        {
+            continue;
+        }
+
+        num_passed++;
+        tx_internal_obj_val_t* buf = __tx_trans_kv_buf(obj_id);
+        if(cb(item->key_ptr, item->key_len, __internal_obj_ptr_2_obj_ptr(buf), buf->hdr.curr_len, cb_arg))
+        {
+            // stopped by cb --> the range ends at this item
+            range = &trans->ranges[range_idx];
+            range->num_items = i + 1;
+            range->exhausted = 0;
+            break;
+        }
+    }
+    return num_passed;
+}
+
+typedef struct
+{
+    tx_trans_t*       trans;
+    tx_trans_range_t* range;
+    uint32_t          next_item;
+    uint8_t           is_valid;
+} __tx_trans_rescan_state_t;
+
+static int __tx_trans_rescan_cmp(void* key_ptr, uint32_t key_len, tx_internal_obj_val_t* int_obj_ptr, void* cb_arg)
+{
+    __tx_trans_rescan_state_t* state = (__tx_trans_rescan_state_t *) cb_arg;
+    tx_trans_t* trans = state->trans;
+    tx_trans_range_t* range = state->range;
+
+    // skip the (locked) placeholders of the tx's own inserts
+    int obj_id_idx = __tx_trans_kv_idx(trans, key_ptr, key_len);
+    if(obj_id_idx >= 0 && !trans->obj_ids[obj_id_idx].existed_prior_tx &&
+       trans->obj_ids[obj_id_idx].int_obj_ptr == int_obj_ptr)
+    {
+        return 0;
+    }
+
+    if(state->next_item == range->num_items){
+        if(range->exhausted) { state->is_valid = 0; } // phantom
+        return 1;
+    }
+    if(range->items[state->next_item++].int_obj_ptr != int_obj_ptr) { // inserted / removed / replaced
+        state->is_valid = 0;
+        return 1;
+    }
+    return 0;
+}
+
+// (commit) returns non-zero if every range read by the tx still has the same items
+uint8_t __tx_trans_validate_ranges(tx_trans_t* trans)
+{
+    for(int r = 0; r < trans->num_ranges; ++r){
+        tx_trans_range_t* range = &trans->ranges[r];
+        __tx_trans_rescan_state_t state = { trans, range, 0, 1 };
+        __scan(trans->parent, range->from_key, range->from_len, range->to_key, range->to_len,
+               __tx_trans_rescan_cmp, &state);
+        if(!state.is_valid || state.next_item != range->num_items){
+            TX_STATS_CONFLICT(trans->parent, TX_ABORT_PHANTOM, NULL, range->from_key, range->from_len);
+            return 0;
+        }
+    }
+    return 1;
+}
@@ -0,0 +1,81 @@
+//
+// Binary traces (see tx_trace.h)
+//
+
+#include <string.h>
+#include <assert.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "tx_trace.h"
+
+int tx_trace_open(tx_trace_t* trace, const char* path, const char* workload)
+{
+    int fd = open(path, O_RDONLY);
+    if(fd < 0) { return -1; }
+
+    struct stat st;
+    tx_trace_hdr_t hdr;
+    if(fstat(fd, &st) < 0 || st.st_size < (off_t) sizeof(hdr) || pread(fd, &hdr, sizeof(hdr), 0) != sizeof(hdr) ||
+       hdr.magic != TX_TRACE_MAGIC || hdr.version != TX_TRACE_VERSION ||
+       strncmp(hdr.workload, workload, sizeof(hdr.workload)) != 0 ||
+       hdr.hdr_len + hdr.records_len > (uint64_t) st.st_size){
+        close(fd);
+        return -1;
+    }
+
+    void* map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+    close(fd); // (the mapping stays valid)
+    if(map == MAP_FAILED) { return -1; }
+    madvise(map, st.st_size, MADV_SEQUENTIAL);
+
+    trace->hdr = (const tx_trace_hdr_t *) map;
+    trace->records = (const uint8_t *) map + hdr.hdr_len;
+    trace->end = trace->records + hdr.records_len;
+    trace->map_len = st.st_size;
+    return 0;
+}
+
+void tx_trace_close(tx_trace_t* trace)
+{
+    munmap((void *) trace->hdr, trace->map_len);
+    trace->hdr = NULL;
+    trace->records = trace->end = NULL;
+}
+
+int tx_trace_writer_open(tx_trace_writer_t* writer, const char* path, const char* workload,
+                         const uint32_t* params, int n_params)
+{
+    assert(n_params <= TX_TRACE_PARAMS && strlen(workload) <= sizeof(writer->hdr.workload));
+    writer->out = fopen(path, "wb");
+    if(writer->out == NULL) { return -1; }
+
+    memset(&writer->hdr, 0, sizeof(writer->hdr));
+    writer->hdr.magic = TX_TRACE_MAGIC;
+    writer->hdr.version = TX_TRACE_VERSION;
+    writer->hdr.hdr_len = sizeof(tx_trace_hdr_t);
+    memcpy(writer->hdr.workload, workload, strlen(workload));
+    if(n_params > 0) { memcpy(writer->hdr.params, params, n_params * sizeof(uint32_t)); }
+    fwrite(&writer->hdr, sizeof(writer->hdr), 1, writer->out); // (rewritten on close)
+    return 0;
+}
+
+void tx_trace_writer_append(tx_trace_writer_t* writer, const void* rec, uint32_t rec_len)
+{
+    static const uint8_t padding[TX_TRACE_ALIGN] = { 0 };
+    uint32_t len = TX_TRACE_REC_LEN(rec_len);
+    fwrite(rec, rec_len, 1, writer->out);
+    fwrite(padding, len - rec_len, 1, writer->out);
+    writer->hdr.n_records++;
+    writer->hdr.records_len += len;
+}
+
+int tx_trace_writer_close(tx_trace_writer_t* writer)
+{
+    int ret = fseek(writer->out, 0, SEEK_SET) == 0 &&
+              fwrite(&writer->hdr, sizeof(writer->hdr), 1, writer->out) == 1 ? 0 : -1;
+    if(fclose(writer->out) != 0) { ret = -1; }
+    writer->out = NULL;
+    return ret;
+}
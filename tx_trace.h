@@ -0,0 +1,70 @@
+//
+// Binary traces of the benchmark drivers: mmaped and walked in place (i.e., no parsing in the measured window)
+//
+
+/// Layout (in the byte order of the host, as written by tx_trace_writer_* or a generator):
+/// -- tx_trace_hdr_t (64B): magic, version, workload name, the number / bytes of the records that follow it
+///    and up to TX_TRACE_PARAMS workload params (e.g., the UEs and eNodeBs of a handover trace)
+/// -- records: one per tx and of a fixed size per tx type (a multiple of 8B, so records can be cast in place);
+///    the workload defines the records, e.g., its tx input struct truncated to the fields of the type
+/// Traces are mapped read-only and prefaulted (MAP_POPULATE), so replays take no page faults either.
+
+#ifndef TX_TRACE_H
+#define TX_TRACE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TX_TRACE_MAGIC 0x52545854 // "TXTR"
+#define TX_TRACE_VERSION 1
+#define TX_TRACE_PARAMS 8
+#define TX_TRACE_ALIGN 8
+
+typedef struct
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t hdr_len;                  // records start at this offset
+    char     workload[8];              // e.g., "tpcc" / "ho" (NUL-padded)
+    uint64_t n_records;
+    uint64_t records_len;              // in bytes
+    uint32_t params[TX_TRACE_PARAMS];  // (workload-specific)
+} tx_trace_hdr_t;
+
+typedef struct
+{
+    const tx_trace_hdr_t* hdr;
+    const uint8_t* records;
+    const uint8_t* end;
+    size_t map_len;
+} tx_trace_t;
+
+typedef struct
+{
+    FILE* out;
+    tx_trace_hdr_t hdr;
+} tx_trace_writer_t;
+
+// size of a record of rec_len bytes in a trace
+#define TX_TRACE_REC_LEN(rec_len) (((rec_len) + TX_TRACE_ALIGN - 1) & ~(TX_TRACE_ALIGN - 1))
+
+// maps a trace of the workload -- returns -1 if the file is not one (e.g., a text trace) or cannot be mapped
+int  tx_trace_open (tx_trace_t* trace, const char* path, const char* workload);
+void tx_trace_close(tx_trace_t* trace);
+
+// writes the header (w/ n_params params) and then the appended records (rec_len is padded to TX_TRACE_REC_LEN)
+int  tx_trace_writer_open  (tx_trace_writer_t* writer, const char* path, const char* workload,
+                            const uint32_t* params, int n_params);
+void tx_trace_writer_append(tx_trace_writer_t* writer, const void* rec, uint32_t rec_len);
+int  tx_trace_writer_close (tx_trace_writer_t* writer); // (rewrites the header w/ the final counts)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //TX_TRACE_H